@@ -0,0 +1,318 @@
+#include "util/pch.h"
+#include "util/io/logger.h"
+
+#include <numeric>
+
+// Benchmark of the logger, results are written as JSON lines so they can be compared across releases
+//
+//  call_latency        time spent in LOG()/LOG_DEFERRED() on the calling thread (single producer)
+//  end_to_end_latency  time from LOG() until the message reached the main log file (unbuffered, single producer)
+//  throughput          messages per second for 1-64 producers, measured until shutdown() wrote everything to disk
+//
+// usage: benchmarks [--quick] [--messages <count>] [--output <file>]
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+
+    struct format_case {
+        const char*                 name;
+        const char*                 format;
+    };
+
+    // from the cheapest format to the one used by the application (entry_point.cpp) and one that uses every tag
+    const format_case               format_cases[] = {
+        { "message_only",   "$C$Z" },
+        { "application",    "[$B$T:$J$E] [$B$L$X $Q - $I:$P:$G$E] $C$Z" },
+        { "all_tags",       "[$N $T:$J] $L$X [$Q] [$A:$G] [$F] $B$C$E$Z" },
+    };
+
+    const AT::logger::severity      thresholds[] = {
+        AT::logger::severity::Trace, AT::logger::severity::Debug, AT::logger::severity::Info,
+        AT::logger::severity::Warn, AT::logger::severity::Error, AT::logger::severity::Fatal,
+    };
+
+    const char*                     severity_names[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL" };
+    const u32                       producer_counts[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+    enum class log_macro : u8 {
+        log,
+        log_deferred,
+    };
+
+
+    struct settings {
+        u64                         messages = 200000;                  // per call_latency/throughput run
+        u64                         end_to_end_samples = 5000;
+        std::filesystem::path       output = "logger_benchmark.jsonl";
+        std::filesystem::path       log_dir = std::filesystem::temp_directory_path() / "logger_benchmark";
+    };
+
+
+    struct latency_summary {
+        f64                         mean_ns = 0;
+        u64                         p50_ns = 0;
+        u64                         p90_ns = 0;
+        u64                         p99_ns = 0;
+        u64                         p999_ns = 0;
+        u64                         max_ns = 0;
+    };
+
+
+    // sorts [samples]
+    latency_summary summarize(std::vector<u64>& samples) {
+
+        latency_summary summary{};
+        if (samples.empty())
+            return summary;
+
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&samples](const f64 fraction) { return samples[std::min(samples.size() - 1, static_cast<size_t>(fraction * static_cast<f64>(samples.size())))]; };
+        summary.mean_ns = static_cast<f64>(std::accumulate(samples.begin(), samples.end(), u64{0})) / static_cast<f64>(samples.size());
+        summary.p50_ns = percentile(0.5);
+        summary.p90_ns = percentile(0.9);
+        summary.p99_ns = percentile(0.99);
+        summary.p999_ns = percentile(0.999);
+        summary.max_ns = samples.back();
+        return summary;
+    }
+
+
+    u64 elapsed_ns(const clock_type::time_point start, const clock_type::time_point end) { return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()); }
+
+
+    // The workload mixes severities like an application would: 10% Error, 10% Warn, 27% Info, 53% Debug
+    // so every buffering threshold changes how much is written directly
+    void log_message(const log_macro macro, const u64 index, const u32 producer) {
+
+        const f64 value = static_cast<f64>(index) * 0.25;
+        if (macro == log_macro::log) {
+            if (index % 10 == 0)            LOG(Error, "benchmark message [" << index << "] producer [" << producer << "] value [" << value << "]")
+            else if (index % 5 == 0)        LOG(Warn, "benchmark message [" << index << "] producer [" << producer << "] value [" << value << "]")
+            else if (index % 3 == 0)        LOG(Info, "benchmark message [" << index << "] producer [" << producer << "] value [" << value << "]")
+            else                            LOG(Debug, "benchmark message [" << index << "] producer [" << producer << "] value [" << value << "]")
+        } else {
+            if (index % 10 == 0)            LOG_DEFERRED(Error, "benchmark message [{}] producer [{}] value [{}]", index, producer, value)
+            else if (index % 5 == 0)        LOG_DEFERRED(Warn, "benchmark message [{}] producer [{}] value [{}]", index, producer, value)
+            else if (index % 3 == 0)        LOG_DEFERRED(Info, "benchmark message [{}] producer [{}] value [{}]", index, producer, value)
+            else                            LOG_DEFERRED(Debug, "benchmark message [{}] producer [{}] value [{}]", index, producer, value)
+        }
+    }
+
+
+    bool start_logger(const settings& config, const format_case& format, const AT::logger::severity threshold) {
+
+        std::filesystem::remove_all(config.log_dir);
+        if (!AT::logger::init(format.format, false, config.log_dir, "benchmark.log"))
+            return false;
+
+        // the threshold is applied by the worker, wait until a message logged after it was processed so every measured message sees it
+        std::atomic<bool> warmed_up{false};
+        auto warm_up_sink = std::make_shared<AT::logger::callback_sink>([&warmed_up](const AT::logger::sink_entry&) { warmed_up.store(true, std::memory_order_release); });
+        AT::logger::set_buffer_threshold(threshold);
+        AT::logger::add_sink(warm_up_sink);
+        LOG(Fatal, "benchmark warm-up")
+        while (!warmed_up.load(std::memory_order_acquire))
+            std::this_thread::yield();
+
+        AT::logger::remove_sink(warm_up_sink);
+        return true;
+    }
+
+    // ========================================================================================================================
+    // results
+    // ========================================================================================================================
+
+    class result_writer {
+    public:
+
+        explicit result_writer(const std::filesystem::path& path)
+            : m_file(path, std::ios::trunc) {}
+
+        bool is_open() const { return m_file.is_open(); }
+
+        void write_run_info(const settings& config) {
+
+#if defined(DEBUG)
+            const char* build = "Debug";
+#elif defined(RELEASE_WITH_DEBUG_INFO)
+            const char* build = "RelWithDebInfo";
+#else
+            const char* build = "Release";
+#endif
+            const auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            m_file << "{\"type\":\"run\",\"timestamp\":" << timestamp << ",\"build\":\"" << build << "\",\"hardware_threads\":" << std::thread::hardware_concurrency()
+                   << ",\"messages\":" << config.messages << ",\"end_to_end_samples\":" << config.end_to_end_samples << "}\n";
+        }
+
+        void write_latency(const char* benchmark, const log_macro macro, const AT::logger::severity threshold, const format_case& format, const u64 messages, const latency_summary& summary) {
+
+            begin(benchmark, macro, threshold, format, 1, messages);
+            m_file << ",\"mean_ns\":" << summary.mean_ns << ",\"p50_ns\":" << summary.p50_ns << ",\"p90_ns\":" << summary.p90_ns << ",\"p99_ns\":" << summary.p99_ns
+                   << ",\"p999_ns\":" << summary.p999_ns << ",\"max_ns\":" << summary.max_ns << "}\n";
+            m_file.flush();
+
+            std::printf("%-20s %-12s %-6s %-13s p50 %7llu ns  p99 %8llu ns  p99.9 %9llu ns  max %10llu ns\n", benchmark, macro_name(macro), severity_names[static_cast<u8>(threshold)], format.name,
+                static_cast<unsigned long long>(summary.p50_ns), static_cast<unsigned long long>(summary.p99_ns), static_cast<unsigned long long>(summary.p999_ns), static_cast<unsigned long long>(summary.max_ns));
+        }
+
+        void write_throughput(const log_macro macro, const AT::logger::severity threshold, const format_case& format, const u32 producers, const u64 messages, const u64 caller_ns, const u64 total_ns, const AT::logger::file_sink_stats& stats) {
+
+            const f64 caller_rate = static_cast<f64>(messages) * 1e9 / static_cast<f64>(std::max<u64>(caller_ns, 1));
+            const f64 total_rate = static_cast<f64>(messages) * 1e9 / static_cast<f64>(std::max<u64>(total_ns, 1));
+            begin("throughput", macro, threshold, format, producers, messages);
+            m_file << ",\"caller_ns\":" << caller_ns << ",\"total_ns\":" << total_ns << ",\"caller_messages_per_second\":" << static_cast<u64>(caller_rate)
+                   << ",\"messages_per_second\":" << static_cast<u64>(total_rate) << ",\"bytes_written\":" << stats.bytes_written << ",\"write_calls\":" << stats.write_calls << "}\n";
+            m_file.flush();
+
+            std::printf("%-20s %-12s %-6s %-13s producers %2u  %10.0f msg/s (callers %10.0f msg/s)  %8llu writes\n", "throughput", macro_name(macro), severity_names[static_cast<u8>(threshold)], format.name,
+                producers, total_rate, caller_rate, static_cast<unsigned long long>(stats.write_calls));
+        }
+
+    private:
+
+        static const char* macro_name(const log_macro macro) { return (macro == log_macro::log) ? "LOG" : "LOG_DEFERRED"; }
+
+        void begin(const char* benchmark, const log_macro macro, const AT::logger::severity threshold, const format_case& format, const u32 producers, const u64 messages) {
+
+            m_file << "{\"type\":\"result\",\"benchmark\":\"" << benchmark << "\",\"macro\":\"" << macro_name(macro) << "\",\"threshold\":\"" << severity_names[static_cast<u8>(threshold)]
+                   << "\",\"format\":\"" << format.name << "\",\"producers\":" << producers << ",\"messages\":" << messages;
+        }
+
+        std::ofstream               m_file;
+    };
+
+    // ========================================================================================================================
+    // benchmarks
+    // ========================================================================================================================
+
+    // @note includes the cost of one steady_clock::now() per message
+    bool run_call_latency(const settings& config, result_writer& writer, const log_macro macro, const AT::logger::severity threshold, const format_case& format) {
+
+        if (!start_logger(config, format, threshold))
+            return false;
+
+        std::vector<u64> samples(config.messages);
+        for (u64 x = 0; x < config.messages; x++) {
+
+            const auto start = clock_type::now();
+            log_message(macro, x, 0);
+            samples[x] = elapsed_ns(start, clock_type::now());
+        }
+
+        AT::logger::shutdown();
+        writer.write_latency("call_latency", macro, threshold, format, config.messages, summarize(samples));
+        return true;
+    }
+
+
+    // Waits until the bytes of every message reached the file (write(), not fsync()), only meaningful without buffering
+    bool run_end_to_end_latency(const settings& config, result_writer& writer, const format_case& format) {
+
+        if (!start_logger(config, format, AT::logger::severity::Trace))
+            return false;
+
+        std::vector<u64> samples(config.end_to_end_samples);
+        for (u64 x = 0; x < config.end_to_end_samples; x++) {
+
+            const u64 written = AT::logger::get_file_sink_stats().bytes_written;
+            const auto start = clock_type::now();
+            LOG(Info, "benchmark message [" << x << "] value [" << static_cast<f64>(x) * 0.25 << "]")
+            while (AT::logger::get_file_sink_stats().bytes_written == written)
+                std::this_thread::yield();
+
+            samples[x] = elapsed_ns(start, clock_type::now());
+        }
+
+        AT::logger::shutdown();
+        writer.write_latency("end_to_end_latency", log_macro::log, AT::logger::severity::Trace, format, config.end_to_end_samples, summarize(samples));
+        return true;
+    }
+
+
+    bool run_throughput(const settings& config, result_writer& writer, const log_macro macro, const AT::logger::severity threshold, const format_case& format, const u32 producers) {
+
+        if (!start_logger(config, format, threshold))
+            return false;
+
+        const u64 messages_per_producer = std::max<u64>(config.messages / producers, 1);
+        std::atomic<bool> start_flag{false};
+        std::atomic<u32> ready{0};
+        std::vector<std::thread> threads{};
+        threads.reserve(producers);
+        for (u32 x = 0; x < producers; x++) {
+            threads.emplace_back([&, x]() {
+
+                ready.fetch_add(1, std::memory_order_relaxed);
+                while (!start_flag.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+
+                for (u64 y = 0; y < messages_per_producer; y++)
+                    log_message(macro, y, x);
+            });
+        }
+
+        while (ready.load(std::memory_order_relaxed) < producers)
+            std::this_thread::yield();
+
+        const auto start = clock_type::now();
+        start_flag.store(true, std::memory_order_release);
+        for (auto& thread : threads)
+            thread.join();
+
+        const auto callers_done = clock_type::now();
+        AT::logger::shutdown();                                                 // drains the queue and flushes the buffer
+        const auto end = clock_type::now();
+
+        writer.write_throughput(macro, threshold, format, producers, messages_per_producer * producers, elapsed_ns(start, callers_done), elapsed_ns(start, end), AT::logger::get_file_sink_stats());
+        return true;
+    }
+
+}
+
+
+int main(int argc, char* argv[]) {
+
+    settings config{};
+    for (int x = 1; x < argc; x++) {
+
+        const std::string_view argument = argv[x];
+        if (argument == "--quick") {
+            config.messages = 20000;
+            config.end_to_end_samples = 500;
+        } else if (argument == "--messages" && x + 1 < argc)
+            config.messages = std::max<u64>(std::strtoull(argv[++x], nullptr, 10), 1);
+        else if (argument == "--output" && x + 1 < argc)
+            config.output = argv[++x];
+        else {
+            std::printf("usage: %s [--quick] [--messages <count>] [--output <file>]\n", argv[0]);
+            return (argument == "--help") ? 0 : 1;
+        }
+    }
+
+    result_writer writer(config.output);
+    if (!writer.is_open()) {
+        std::fprintf(stderr, "could not open [%s]\n", config.output.string().c_str());
+        return 1;
+    }
+
+    writer.write_run_info(config);
+    bool success = true;
+    for (const auto macro : { log_macro::log, log_macro::log_deferred })
+        for (const auto threshold : thresholds)
+            for (const auto& format : format_cases)
+                success &= run_call_latency(config, writer, macro, threshold, format);
+
+    for (const auto& format : format_cases)
+        success &= run_end_to_end_latency(config, writer, format);
+
+    for (const auto macro : { log_macro::log, log_macro::log_deferred })
+        for (const auto threshold : thresholds)
+            for (const auto& format : format_cases)
+                for (const u32 producers : producer_counts)
+                    success &= run_throughput(config, writer, macro, threshold, format, producers);
+
+    std::filesystem::remove_all(config.log_dir);
+    std::printf("results written to [%s]\n", config.output.string().c_str());
+    return (success) ? 0 : 1;
+}
@@ -281,6 +281,7 @@ group "tests"
             "src/util/io/io.cpp",
             "src/util/io/config.cpp",
             "src/util/io/logger.cpp",
+            "src/util/io/log_reader.cpp",
             "src/util/io/serializer_data.h",
             "src/util/io/serializer_yaml.h",
             "src/util/io/serializer_yaml.cpp",
@@ -410,4 +411,189 @@ group "tests"
             runtime "Release"
             symbols "off"
             optimize "on"
+
+
+    project "benchmarks"                -- logger throughput/latency, writes JSON lines (run with --help for options)
+        kind "ConsoleApp"
+        language "C++"
+        cppdialect "C++20"
+        staticruntime "on"
+
+        targetdir ("%{wks.location}/bin/" .. outputs .. "/%{prj.name}")
+        objdir ("%{wks.location}/bin-int/" .. outputs .. "/%{prj.name}")
+
+        files
+        {
+            "benchmarks/**.h",
+            "benchmarks/**.cpp",
+
+            "src/util/timing/**.cpp",               -- the profiling macros in system.cpp need the instrumentor
+
+            "src/util/io/io.cpp",
+            "src/util/io/logger.cpp",
+            "src/util/io/log_reader.cpp",
+            "src/util/data_structures/string_manipulation.cpp",
+            "src/util/system.cpp",
+        }
+
+        defines
+        {
+            "PROFILE_ALLOCATIONS=0",                -- keep the default operator new, the logger numbers should not include the allocation tracking
+        }
+
+        includedirs
+        {
+            "src",
+            "%{IncludeDir.glm}",
+            "%{IncludeDir.glew}",
+            "%{IncludeDir.glfw}/include",
+            "%{IncludeDir.ImGui}",
+            "%{IncludeDir.ImGui}/backends/",
+            "%{IncludeDir.implot}",
+        }
+
+        links
+        {
+            "ImGui",
+        }
+
+        libdirs 
+        {
+            "vendor/imgui/bin/" .. outputs .. "/imgui",
+        }
+
+        filter "system:linux"
+            systemversion "latest"
+            defines "PLATFORM_LINUX"
+            links { 
+                "pthread",
+                "Qt5Core",
+                "Qt5Widgets",
+                "Qt5Gui",
+            }
+
+            buildoptions
+            {
+                "-msse4.1",
+                "-fPIC",
+                "-Wall",
+                "-Wno-dangling-else"
+            }
+            
+            externalincludedirs
+            {
+                "/usr/include/x86_64-linux-gnu/qt5",
+                "/usr/include/x86_64-linux-gnu/qt5/QtCore",
+                "/usr/include/x86_64-linux-gnu/qt5/QtWidgets",
+                "/usr/include/x86_64-linux-gnu/qt5/QtGui",
+            }
+
+        filter "system:windows"
+            systemversion "latest"
+            defines
+            {
+                "PLATFORM_WINDOWS",
+                "UNICODE",
+                "_UNICODE",
+            }
+
+            links
+            {
+                "ImGui",
+                "glfw",
+                "glew32s",
+                "opengl32",
+                "gdi32",
+                "user32",
+                "comdlg32",
+                "shell32",
+            }
+
+            libdirs
+            {
+                "%{wks.location}/vendor/glfw/lib-vc2022",
+                "%{vendor_path.glew}/lib/Release/x64",
+            }
+
+        filter "configurations:Debug"
+            defines "DEBUG"
+            runtime "Debug"
+            symbols "on"
+
+        filter "configurations:RelWithDebInfo"
+            defines "RELEASE_WITH_DEBUG_INFO"
+            runtime "Release"
+            symbols "on"
+            optimize "on"
+
+        filter "configurations:Release"
+            defines "RELEASE"
+            runtime "Release"
+            symbols "off"
+            optimize "on"
+group ""
+
+
+group "tools"
+    project "trace_converter"           -- converts binary profiler traces (.attrace) into Chrome trace JSON
+        kind "ConsoleApp"
+        language "C++"
+        cppdialect "C++20"
+        staticruntime "on"
+
+        targetdir ("%{wks.location}/bin/" .. outputs .. "/%{prj.name}")
+        objdir ("%{wks.location}/bin-int/" .. outputs .. "/%{prj.name}")
+
+        files
+        {
+            "tools/trace_converter.cpp",
+
+            "src/util/timing/perf_counters.h",
+            "src/util/timing/trace_format.h",
+            "src/util/timing/trace_format.cpp",
+        }
+
+        includedirs
+        {
+            "src",
+            "%{IncludeDir.glm}",
+        }
+
+        filter "system:linux"
+            systemversion "latest"
+            defines "PLATFORM_LINUX"
+
+            buildoptions
+            {
+                "-msse4.1",
+                "-fPIC",
+                "-Wall",
+                "-Wno-dangling-else"
+            }
+
+        filter "system:windows"
+            systemversion "latest"
+            defines
+            {
+                "PLATFORM_WINDOWS",
+                "UNICODE",
+                "_UNICODE",
+            }
+
+        filter "configurations:Debug"
+            defines "DEBUG"
+            runtime "Debug"
+            symbols "on"
+
+        filter "configurations:RelWithDebInfo"
+            defines "RELEASE_WITH_DEBUG_INFO"
+            runtime "Release"
+            symbols "on"
+            optimize "on"
+
+        filter "configurations:Release"
+            defines "RELEASE"
+            runtime "Release"
+            symbols "off"
+            optimize "on"
 group ""
@@ -86,7 +86,7 @@ namespace AT {
 		AT::serializer::yaml(config::get_filepath_from_configtype(util::get_executable_path(), config::file::app_settings), "general_settings", AT::serializer::option::load_from_file)
 			.entry(KEY_VALUE(long_startup_process));
 
-        LOG(Info, "long_startup_process [" << util::to_string(long_startup_process) << "]")
+        LOG_CATEGORY(app, Info, "long_startup_process [" << util::to_string(long_startup_process) << "]")
 
         s_running = true;
         m_renderer->set_state(system_state::active);
@@ -140,7 +140,7 @@ namespace AT {
     
         {
             PROFILE_APPLICATION_SCOPE("Exiting main loop");
-            LOG(Trace, "Exiting main run loop")
+            LOG_CATEGORY(app, Trace, "Exiting main run loop")
             m_dashboard->shutdown();
         }
 
@@ -191,6 +191,12 @@ namespace AT {
         m_absolute_time += m_delta_time;
         m_last_frame_time = time;
         m_fps = static_cast<u32>(1.0 / (m_work_time + (m_sleep_time * 0.001)) + 0.5); // Round to nearest integer
+
+        render::general_performance_metrik& metrik = m_renderer->get_general_performance_metrik_ref();
+        metrik.work_time_history[metrik.current_index] = m_work_time * 1000;
+        metrik.waiting_idle_time[metrik.current_index] = m_sleep_time;
+        metrik.next_iteration();
+        PROFILER_FRAME_END(std::chrono::duration<f32>(m_work_time));
     }
 
     // -----------------------------------------------------------------------------------------------------------------
@@ -205,6 +211,7 @@ namespace AT {
         dispatcher.dispatch<window_resize_event>(BIND_FUNCTION(application::on_window_resize));
         dispatcher.dispatch<window_refresh_event>(BIND_FUNCTION(application::on_window_refresh));
         dispatcher.dispatch<window_focus_event>(BIND_FUNCTION(application::on_window_focus));
+        dispatcher.dispatch<key_event>(BIND_FUNCTION(application::on_key));
     
         // none application events
         m_dashboard->on_event(event);
@@ -242,5 +249,14 @@ namespace AT {
     
         return true;
     }
+    
+
+    bool application::on_key(key_event& event) {
+    
+        if (event.get_keycode() == key_code::PROFILE_DUMP_TRACE_KEY && event.m_key_state == key_state::press)
+            PROFILER_DUMP_TRACE("hotkey");
+
+        return false;                                       // the dashboard still receives the key
+    }
 
 }
@@ -12,6 +12,7 @@ namespace AT {
     class window_close_event;
     class window_refresh_event;
     class window_focus_event;
+    class key_event;
     class dashboard;
     namespace UI        { class imgui_config; }
     namespace render    { class renderer; }
@@ -134,6 +135,12 @@ namespace AT {
         // @return Always returns true.
         bool on_window_focus(window_focus_event& event);
 
+
+        // Requests a trace of the rolling profiler window when PROFILE_DUMP_TRACE_KEY is pressed.
+        // @param event The key event object.
+        // @return Always returns false, so the key is still passed on.
+        bool on_key(key_event& event);
+
         // ---------------------- FPS Management ----------------------
 
         // Starts measuring frame times for FPS calculations.
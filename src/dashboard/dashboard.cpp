@@ -92,8 +92,7 @@ namespace AT {
         }
 
         // main content
-        ImGui::ShowDemoWindow();
-        ImPlot::ShowDemoWindow();
+        m_profiler_panel.draw();
 
     }
 
@@ -1,6 +1,7 @@
 
 #pragma once
 
+#include "util/ui/profiler_panel.h"
 
 namespace AT {
 
@@ -46,7 +47,7 @@ namespace AT {
 
 
         // Draws the main dashboard UI each frame.
-        // Responsible for rendering ImGui's main dockspace, panels, and demo windows.
+        // Responsible for rendering ImGui's main dockspace and panels (built in: the profiler panel).
         //
         // @param delta_time Time elapsed since the last frame, in seconds.
         void draw(f32 delta_time);
@@ -89,7 +90,7 @@ namespace AT {
 
     private:
 
-        // No private data members yet.
         // You may want to add: persistent UI state, ImGui configuration, cached panel data, ...
+        UI::profiler_panel          m_profiler_panel{};     // frame times, flame graph of the latest frame and per-scope statistics
     };
 }
@@ -20,7 +20,7 @@
     int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow)
 #endif
     {
-        PROFILER_SESSION_BEGIN("application", AT::util::get_executable_path() / "profiler", "application.json");
+        PROFILER_SESSION_BEGIN_ROLLING("application", AT::util::get_executable_path() / "profiler", "application.json", PROFILE_ROLLING_WINDOW_SECONDS);
         {
 
             PROFILE_SCOPE("sub-systems startup");
@@ -42,6 +42,7 @@ namespace AT {
             f32 renderer_draw_time[GENERAL_PERFORMANCE_METRIK_ARRAY_SIZE] = {};
             f32 draw_geometry_time[GENERAL_PERFORMANCE_METRIK_ARRAY_SIZE] = {};
             f32 waiting_idle_time[GENERAL_PERFORMANCE_METRIK_ARRAY_SIZE] = {};
+            f32 work_time_history[GENERAL_PERFORMANCE_METRIK_ARRAY_SIZE] = {};     // [work_time] of the previous iterations, all arrays in milliseconds
             u16 current_index = 0;
 
             void next_iteration() {
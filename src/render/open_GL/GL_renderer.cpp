@@ -39,10 +39,10 @@ namespace AT::render::open_GL {
         ASSERT(err == GLEW_OK, "", "Failed to initialize GLEW: " << glewGetErrorString(err))
         ASSERT(GLEW_VERSION_4_6, "", "OpenGL 4.6 not supported!")
         
-        LOG(Trace, "OpenGL Version: " << glGetString(GL_VERSION));
-        LOG(Trace, "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION));
-        LOG(Trace, "Vendor: " << glGetString(GL_VENDOR));
-        LOG(Trace, "Renderer: " << glGetString(GL_RENDERER));
+        LOG_CATEGORY(renderer, Trace, "OpenGL Version: " << glGetString(GL_VERSION));
+        LOG_CATEGORY(renderer, Trace, "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION));
+        LOG_CATEGORY(renderer, Trace, "Vendor: " << glGetString(GL_VENDOR));
+        LOG_CATEGORY(renderer, Trace, "Renderer: " << glGetString(GL_RENDERER));
     
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -71,6 +71,8 @@ namespace AT::render::open_GL {
         if (m_state != system_state::active)
             return;
 
+        util::stopwatch loc_stopwatch(&m_general_performance_metrik.renderer_draw_time[m_general_performance_metrik.current_index]);
+
         // execute_pending_commands();              // DISABLED: dont need custom shaders yet
         
         glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
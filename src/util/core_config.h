@@ -13,11 +13,73 @@
 #define PROFILE_APPLICATION                     1
 #define PROFILE_RENDERER                        0
 
+// events buffered per thread until the instrumentor writer thread collects them (power of two), further events are dropped and counted
+#define PROFILE_THREAD_BUFFER_SIZE              8192
+// replaces the global operator new to count the allocations of every thread, every profiled scope records the allocations made while it was open
+// (including nested scopes) in the trace and the frame statistics, 0 = default operator new and no allocation data
+// (follows PROFILE, can be set per project, the benchmarks build without it so they do not measure the tracking)
+#ifndef PROFILE_ALLOCATIONS
+    #define PROFILE_ALLOCATIONS                 PROFILE
+#endif
+// PROFILE_SCOPE_COUNTERS() records perf counters (cycles, instructions, cache misses, context switches) with perf_event_open, 0 = plain PROFILE_SCOPE()
+#define PROFILE_PERF_COUNTERS                   1
+// events with perf counters buffered per thread (power of two), only allocated for threads that use PROFILE_SCOPE_COUNTERS()
+#define PROFILE_COUNTER_BUFFER_SIZE             1024
+// how often the instrumentor writer thread collects the thread buffers (milliseconds), a half full buffer wakes it earlier
+#define PROFILE_WRITE_INTERVAL_MS               50
+// the session started in entry_point.cpp keeps the events of the last n seconds in memory and only writes a trace on request
+// (PROFILER_DUMP_TRACE(), PROFILE_DUMP_TRACE_KEY or a frame over PROFILE_FRAME_BUDGET_MS), 0 = stream every event of the whole run
+#define PROFILE_ROLLING_WINDOW_SECONDS          30
+// upper limit of events kept for the rolling window (48 bytes each, allocated when the session begins)
+#define PROFILE_ROLLING_MAX_EVENTS              (1 << 18)
+// upper limit of events with perf counters kept for the rolling window (112 bytes each)
+#define PROFILE_ROLLING_MAX_COUNTER_EVENTS      (1 << 14)
+// frames with a longer work time are flagged in the frame statistics and request a trace of the rolling window (at most one per window), 0 = disabled
+#define PROFILE_FRAME_BUDGET_MS                 100
+// number of frames (PROFILER_FRAME_END()) the per-scope min/avg/max/p99 of the instrumentor are computed over
+#define PROFILE_FRAME_STATS_WINDOW              300
+// key that requests a trace of the rolling window (member of AT::key_code)
+#define PROFILE_DUMP_TRACE_KEY                  key_F9
+// default format of profiler traces (member of AT::trace_format): binary (small, convert with the trace_converter tool) or json (Chrome trace)
+#define PROFILE_TRACE_FORMAT                    binary
+
+// default encoding of sections written by serializer::binary (member of AT::serializer::binary::encoding), set_encoding() overrides it per section:
+// raw (integers at full width, vectors as one block) or compact (varints, zig-zag for signed values, deltas for sorted integer vectors)
+#define SERIALIZER_BINARY_ENCODING              raw
+
 // log assert and validation behaviour?
 // NOTE - expr in assert/validation will still be executed
 #define ENABLE_LOGGING_FOR_ASSERTS              1
 #define ENABLE_LOGGING_FOR_VALIDATION           1
 
+// logger queueing behaviour
+// 1 = every producer thread writes into its own lock-free ring buffer (no shared lock on the LOG() path)
+// 0 = all threads push into one mutex-guarded queue
+#define LOGGER_USE_THREAD_RING_BUFFERS          1
+
+// arguments of a LOG_DEFERRED() call up to this size (in bytes) are stored inside the queued message without an allocation
+#define LOGGER_DEFERRED_INLINE_ARG_SIZE         64
+
+// maximum number of queued (not yet processed) log messages, 0 = unbounded (can be changed with logger::set_queue_limit())
+#define LOGGER_QUEUE_LIMIT                      65536
+// with overflow_policy::sample only every n-th message is kept once the queue is 75% full
+#define LOGGER_SAMPLE_RATE                      16
+// maximum number of messages queued for a log sink with its own thread (see logger::add_sink()), Error and Fatal are never dropped
+#define LOGGER_SINK_QUEUE_LIMIT                 8192
+
+// the last n messages are copied into a pre-allocated ring at the call site, crash_handler writes it to the log file with plain write() calls
+// 0 = disabled
+#define LOGGER_CRASH_RING_SIZE                  256
+// bytes of the message text kept per crash ring entry, longer messages are cut off
+#define LOGGER_CRASH_RECORD_SIZE                240
+
+// compile-time log level per logger category, messages below it are removed from the build (see LOG_CATEGORY() in logger.h)
+//  0 = FATAL + ERROR, 1 = + WARN, 2 = + INFO, 3 = + DEBUG, 4 = + TRACE
+#define LOG_LEVEL_APP                           4
+#define LOG_LEVEL_RENDERER                      4
+#define LOG_LEVEL_SERIALIZER                    4
+#define LOG_LEVEL_IO                            4
+
 
 #define ASSET_EXTENTION			    ".atasset"      // Extension for asset files
 #define PROJECT_EXTENTION    		".atproj"       // Extension for project files
@@ -98,6 +98,7 @@ namespace AT::crash_handler {
 
 	void signal_handler(const int signal) {
 
+		logger::dump_crash_ring();	// first, only uses write() and does not depend on the state of the logger
 		std::cout << "signal caught => terminating" << std::endl;
 		LOG(Fatal, "crash_handler caught signal [" << signal << "]")
 		execute_user_functions();
@@ -156,6 +157,7 @@ namespace AT::crash_handler {
 
 	LONG WINAPI vectored_exception_handler(_EXCEPTION_POINTERS* ExceptionInfo) {
 		if (ExceptionInfo->ExceptionRecord->ExceptionCode == EXCEPTION_BREAKPOINT) {
+			logger::dump_crash_ring();
 			execute_user_functions();
 			TerminateProcess(GetCurrentProcess(), 1);  // Skip CRT cleanup
 			return EXCEPTION_EXECUTE_HANDLER;
@@ -165,6 +167,7 @@ namespace AT::crash_handler {
 
 	LONG WINAPI exception_filter(_EXCEPTION_POINTERS* ExceptionInfo) {
 
+		logger::dump_crash_ring();
 		execute_user_functions();
 
 		// Save the old filter and detach the crash handler
@@ -27,7 +27,7 @@ namespace AT::config {
         PROFILE_FUNCTION();
 
         io::create_directory(dir / CONFIG_DIR);
-        LOG(Trace, "Checking Engine config files at: " << dir / CONFIG_DIR);
+        LOG_CATEGORY(io, Trace, "Checking Engine config files at: " << dir / CONFIG_DIR);
         for (int i = 0; i <= static_cast<int>(file::input); ++i) {
 
             std::filesystem::path file_path = dir / CONFIG_DIR / (config::file_type_to_string(static_cast<file>(i)) + CONFIG_FILE_EXTENSION);
@@ -45,7 +45,7 @@ namespace AT::config {
     void create_config_files_for_project(std::filesystem::path project_dir) {
 
         io::create_directory(project_dir / CONFIG_DIR);
-        LOG(Trace, "Checking project config files at: " << project_dir / CONFIG_DIR);
+        LOG_CATEGORY(io, Trace, "Checking project config files at: " << project_dir / CONFIG_DIR);
         for (int i = 0; i <= static_cast<int>(file::input); ++i) {
 
             std::filesystem::path file_path = project_dir / CONFIG_DIR / (config::file_type_to_string(static_cast<file>(i)) + CONFIG_FILE_EXTENSION);
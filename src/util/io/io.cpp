@@ -7,13 +7,22 @@
 	#include <TlHelp32.h>
 #elif defined(PLATFORM_LINUX)
 	#include <dirent.h>
+	#include <fcntl.h>
 	#include <unistd.h>
+	#include <sys/mman.h>
 	#include <sys/types.h>
 	#include <sys/stat.h>
 #else
 	#error undefined platform
 #endif
 
+#if defined(__x86_64__) || defined(_M_X64)
+	#include <nmmintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#endif
+#endif
+
 #include "io.h"
 
 
@@ -41,7 +50,7 @@ namespace AT::io {
 		file.write(content_buffer.data(), content_buffer.size());
 		file.close();
 
-		LOG(Trace, "Wrote content to file at [" << file_path.generic_string() << "] with length [" << content_buffer.size() << "]");
+		LOG_CATEGORY(io, Trace, "Wrote content to file at [" << file_path.generic_string() << "] with length [" << content_buffer.size() << "]");
 		return true;
 	}
 
@@ -236,6 +245,244 @@ namespace AT::io {
 	}
 
 
+	namespace {
+
+		// CRC-32C (Castagnoli, reflected) one byte at a time, used if the CPU has no crc32 instruction
+		u32 update_crc32c_table(u32 crc, const u8* data, size_t size) {
+
+			static const auto table = []() {
+				std::array<u32, 256> loc_table{};
+				for (u32 x = 0; x < 256; x++) {
+					u32 value = x;
+					for (int bit = 0; bit < 8; bit++)
+						value = (value & 1) ? (0x82F63B78u ^ (value >> 1)) : (value >> 1);
+					loc_table[x] = value;
+				}
+				return loc_table;
+			}();
+
+			for (; size > 0; size--, data++)
+				crc = table[(crc ^ *data) & 0xFF] ^ (crc >> 8);
+			return crc;
+		}
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+		bool cpu_has_sse42() {
+	#if defined(_MSC_VER)
+			int info[4]{};
+			__cpuid(info, 1);
+			return (info[2] & (1 << 20)) != 0;
+	#else
+			return __builtin_cpu_supports("sse4.2");
+	#endif
+		}
+
+		// eight bytes per instruction, compiled for SSE4.2 independent of the flags of the build and only called after the CPU check
+	#if defined(__GNUC__)
+		__attribute__((target("sse4.2")))
+	#endif
+		u32 update_crc32c_sse42(u32 crc, const u8* data, size_t size) {
+
+			u64 loc_crc = crc;
+			for (; size >= sizeof(u64); size -= sizeof(u64), data += sizeof(u64)) {
+				u64 chunk;
+				std::memcpy(&chunk, data, sizeof(chunk));
+				loc_crc = _mm_crc32_u64(loc_crc, chunk);
+			}
+
+			crc = static_cast<u32>(loc_crc);
+			for (; size > 0; size--, data++)
+				crc = _mm_crc32_u8(crc, *data);
+			return crc;
+		}
+
+#endif
+
+	}
+
+
+	u32 crc32c(u32 crc, const void* data, const size_t size) {
+
+		const u8* bytes = static_cast<const u8*>(data);
+#if defined(__x86_64__) || defined(_M_X64)
+		static const bool hardware = cpu_has_sse42();
+		if (hardware)
+			return ~update_crc32c_sse42(~crc, bytes, size);
+#endif
+		return ~update_crc32c_table(~crc, bytes, size);
+	}
+
+
+	bool write_file_atomic(const std::filesystem::path& path, const char* data, const size_t size, const sync_policy policy) {
+
+		// the temporary file is created by the OS under a unique name in the target directory (the rename must not cross file systems),
+		// so concurrent saves from any thread or process never write into the same temporary file
+		std::filesystem::path temp_path{};
+		constexpr size_t max_write_size = 1ull << 30;
+
+#if defined(PLATFORM_WINDOWS)
+
+		const std::filesystem::path directory = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+		wchar_t temp_name[MAX_PATH];
+		VALIDATE(GetTempFileNameW(directory.c_str(), L"tmp", 0, temp_name) != 0, return false, "", "Failed to create a temporary file in [" << directory.generic_string() << "] error [" << GetLastError() << "]");
+		temp_path = temp_name;
+
+		HANDLE file = CreateFileW(temp_path.c_str(), GENERIC_WRITE, 0, NULL, TRUNCATE_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			LOG(Error, "Failed to open file [" << temp_path.generic_string() << "] error [" << GetLastError() << "]");
+			std::error_code error{};
+			std::filesystem::remove(temp_path, error);
+			return false;
+		}
+
+		bool success = true;
+		for (size_t offset = 0; success && offset < size;) {
+			DWORD written = 0;
+			success = WriteFile(file, data + offset, static_cast<DWORD>(std::min(size - offset, max_write_size)), &written, NULL) && written > 0;
+			offset += written;
+		}
+		if (success && policy != sync_policy::none)
+			success = FlushFileBuffers(file);
+		CloseHandle(file);
+
+		if (success)
+			success = MoveFileExW(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | (policy != sync_policy::none ? MOVEFILE_WRITE_THROUGH : 0));
+
+#elif defined(PLATFORM_LINUX)
+
+		std::string temp_name = path.string() + ".tmpXXXXXX";
+		const int file = mkostemp(temp_name.data(), O_CLOEXEC);
+		VALIDATE(file >= 0, return false, "", "Failed to create file [" << temp_name << "] error [" << std::strerror(errno) << "]");
+		temp_path = temp_name;
+
+		// mkostemp() creates the file with 0600, the replacement keeps the permissions of the file it replaces
+		struct stat target_stat{};
+		const mode_t mode = (stat(path.c_str(), &target_stat) == 0) ? (target_stat.st_mode & 07777) : 0644;
+		if (fchmod(file, mode) != 0)
+			LOG(Warn, "Failed to set the permissions of [" << temp_path.generic_string() << "] error [" << std::strerror(errno) << "]");
+
+		bool success = true;
+		for (size_t offset = 0; success && offset < size;) {
+			const ssize_t written = write(file, data + offset, std::min(size - offset, max_write_size));
+			if (written < 0 && errno == EINTR)
+				continue;
+
+			success = written > 0;
+			offset += success ? static_cast<size_t>(written) : 0;
+		}
+		if (success && policy != sync_policy::none)
+			success = fsync(file) == 0;
+		success = (close(file) == 0) && success;
+
+		if (success)
+			success = rename(temp_path.c_str(), path.c_str()) == 0;
+
+		if (success && policy == sync_policy::file_and_directory) {
+			const std::filesystem::path directory = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+			const int directory_file = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+			if (directory_file >= 0) {
+				fsync(directory_file);
+				close(directory_file);
+			}
+		}
+
+#endif
+
+		if (!success) {
+			LOG(Error, "Failed to write file [" << path.generic_string() << "] through [" << temp_path.generic_string() << "]");
+			std::error_code error{};
+			std::filesystem::remove(temp_path, error);
+		}
+		return success;
+	}
+
+
+	mapped_file::mapped_file(const std::filesystem::path& path) {
+
+#if defined(PLATFORM_WINDOWS)
+
+		HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return;
+
+		LARGE_INTEGER file_size{};
+		if (GetFileSizeEx(file, &file_size) && file_size.QuadPart == 0)
+			m_open = true;														// an empty file can not be mapped
+
+		else if (file_size.QuadPart > 0) {
+
+			// the view keeps the mapping object alive, both handles can be closed right away
+			HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (mapping != NULL) {
+				m_data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+				m_size = static_cast<size_t>(file_size.QuadPart);
+				m_open = m_data != nullptr;
+				CloseHandle(mapping);
+			}
+		}
+		CloseHandle(file);
+
+#elif defined(PLATFORM_LINUX)
+
+		const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (file < 0)
+			return;
+
+		struct stat file_stat{};
+		if (fstat(file, &file_stat) == 0 && file_stat.st_size == 0)
+			m_open = true;														// an empty file can not be mapped
+
+		else if (file_stat.st_size > 0) {
+
+			// the mapping stays valid after the descriptor is closed
+			void* memory = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+			if (memory != MAP_FAILED) {
+				m_data = static_cast<const char*>(memory);
+				m_size = static_cast<size_t>(file_stat.st_size);
+				m_open = true;
+			}
+		}
+		close(file);
+
+#endif
+	}
+
+
+	mapped_file::~mapped_file() { unmap(); }
+
+
+	mapped_file::mapped_file(mapped_file&& other) noexcept
+		: m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)), m_open(std::exchange(other.m_open, false)) {}
+
+
+	mapped_file& mapped_file::operator=(mapped_file&& other) noexcept {
+
+		if (this != &other) {
+			unmap();
+			m_data = std::exchange(other.m_data, nullptr);
+			m_size = std::exchange(other.m_size, 0);
+			m_open = std::exchange(other.m_open, false);
+		}
+		return *this;
+	}
+
+
+	void mapped_file::unmap() {
+
+		if (m_data) {
+#if defined(PLATFORM_WINDOWS)
+			UnmapViewOfFile(m_data);
+#elif defined(PLATFORM_LINUX)
+			munmap(const_cast<char*>(m_data), m_size);
+#endif
+		}
+		m_data = nullptr;
+		m_size = 0;
+		m_open = false;
+	}
+
+
 	bool write_to_file(const char* data, const std::filesystem::path& filename) {
 
 		std::ofstream outStream(filename.string());
@@ -244,5 +491,233 @@ namespace AT::io {
 		outStream.close();
 		return true;
 	}
+
+
+	namespace {
+
+		constexpr size_t DEFLATE_WINDOW_SIZE = 32768;
+		constexpr size_t DEFLATE_MIN_MATCH = 3;
+		constexpr size_t DEFLATE_MAX_MATCH = 258;
+		constexpr size_t DEFLATE_MAX_CHAIN = 32;								// match candidates checked per position
+		constexpr size_t DEFLATE_HASH_SIZE = 1 << 15;
+		constexpr size_t DEFLATE_BLOCK_SIZE = 1 << 20;							// bytes read from the source file at once
+
+		constexpr u16 length_base[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		constexpr u8 length_extra[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		constexpr u16 distance_base[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		constexpr u8 distance_extra[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		// CRC-32 (IEEE, reflected) as required by the gzip trailer
+		u32 update_crc32(u32 crc, const u8* data, const size_t size) {
+
+			static const auto table = []() {
+				std::array<u32, 256> loc_table{};
+				for (u32 x = 0; x < 256; x++) {
+					u32 value = x;
+					for (int bit = 0; bit < 8; bit++)
+						value = (value & 1) ? (0xEDB88320u ^ (value >> 1)) : (value >> 1);
+					loc_table[x] = value;
+				}
+				return loc_table;
+			}();
+
+			crc = ~crc;
+			for (size_t x = 0; x < size; x++)
+				crc = table[(crc ^ data[x]) & 0xFF] ^ (crc >> 8);
+			return ~crc;
+		}
+
+		// Collects DEFLATE bits (LSB first) and writes full bytes to the target stream
+		class deflate_bit_writer {
+		public:
+
+			explicit deflate_bit_writer(std::ofstream& stream) : m_stream(stream) { m_bytes.reserve(1 << 16); }
+
+			void write_bits(const u32 value, const u32 count) {
+
+				m_bit_buffer |= static_cast<u64>(value) << m_bit_count;
+				m_bit_count += count;
+				while (m_bit_count >= 8) {
+					m_bytes.push_back(static_cast<u8>(m_bit_buffer & 0xFF));
+					m_bit_buffer >>= 8;
+					m_bit_count -= 8;
+				}
+
+				if (m_bytes.size() >= (1 << 16))
+					flush_bytes();
+			}
+
+			// Huffman codes are defined MSB first
+			void write_code(const u32 code, const u32 length) {
+
+				u32 reversed = 0;
+				for (u32 x = 0; x < length; x++)
+					reversed |= ((code >> x) & 1) << (length - 1 - x);
+				write_bits(reversed, length);
+			}
+
+			void finish() {
+
+				if (m_bit_count > 0)
+					m_bytes.push_back(static_cast<u8>(m_bit_buffer & 0xFF));
+				m_bit_buffer = 0;
+				m_bit_count = 0;
+				flush_bytes();
+			}
+
+		private:
+
+			void flush_bytes() {
+
+				m_stream.write(reinterpret_cast<const char*>(m_bytes.data()), static_cast<std::streamsize>(m_bytes.size()));
+				m_bytes.clear();
+			}
+
+			std::ofstream&				m_stream;
+			std::vector<u8>				m_bytes{};
+			u64							m_bit_buffer = 0;
+			u32							m_bit_count = 0;
+		};
+
+		// literal/length symbols of the fixed Huffman table (RFC 1951, 3.2.6)
+		void write_literal_length_symbol(deflate_bit_writer& writer, const u32 symbol) {
+
+			if (symbol <= 143)			writer.write_code(0x30 + symbol, 8);
+			else if (symbol <= 255)		writer.write_code(0x190 + (symbol - 144), 9);
+			else if (symbol <= 279)		writer.write_code(symbol - 256, 7);
+			else						writer.write_code(0xC0 + (symbol - 280), 8);
+		}
+
+		void write_match(deflate_bit_writer& writer, const u32 length, const u32 distance) {
+
+			u32 length_code = 28;
+			while (length_base[length_code] > length)
+				length_code--;
+			write_literal_length_symbol(writer, 257 + length_code);
+			writer.write_bits(length - length_base[length_code], length_extra[length_code]);
+
+			u32 distance_code = 29;
+			while (distance_base[distance_code] > distance)
+				distance_code--;
+			writer.write_code(distance_code, 5);
+			writer.write_bits(distance - distance_base[distance_code], distance_extra[distance_code]);
+		}
+
+		inline u32 hash_bytes(const u8* data) { return ((static_cast<u32>(data[0]) << 16 | static_cast<u32>(data[1]) << 8 | data[2]) * 2654435761u) >> (32 - 15); }
+	}
+
+
+	bool compress_file_gzip(const std::filesystem::path& source, const std::filesystem::path& target) {
+
+		std::ifstream input(source, std::ios::binary);
+		VALIDATE(input.is_open(), return false, "", "Failed to open file for compression: " << source.generic_string());
+
+		std::ofstream output(target, std::ios::binary | std::ios::trunc);
+		VALIDATE(output.is_open(), return false, "", "Failed to create compressed file: " << target.generic_string());
+
+		const u8 gzip_header[10] = { 0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF };		// deflate, no flags, no mtime, unknown OS
+		output.write(reinterpret_cast<const char*>(gzip_header), sizeof(gzip_header));
+
+		deflate_bit_writer writer(output);
+		writer.write_bits(1, 1);												// final block
+		writer.write_bits(1, 2);												// fixed Huffman codes
+
+		std::vector<int64> head(DEFLATE_HASH_SIZE, -1);						// newest position per hash, positions are absolute in the source file
+		std::vector<int64> previous(DEFLATE_WINDOW_SIZE, -1);				// older positions with the same hash
+		std::vector<u8> buffer{};												// [window history] + [unprocessed input]
+		int64 buffer_start = 0;													// absolute position of buffer[0]
+		int64 position = 0;														// next absolute position to encode
+		u32 crc = 0;
+		u64 total_size = 0;
+		bool end_of_file = false;
+
+		auto insert_hash = [&](const int64 pos) {
+			const u32 hash = hash_bytes(&buffer[static_cast<size_t>(pos - buffer_start)]);
+			previous[static_cast<size_t>(pos) & (DEFLATE_WINDOW_SIZE - 1)] = head[hash];
+			head[hash] = pos;
+		};
+
+		while (!end_of_file || position < buffer_start + static_cast<int64>(buffer.size())) {
+
+			if (!end_of_file) {															// refill, keep one window of history for back references
+				const int64 history_start = std::max<int64>(buffer_start, position - static_cast<int64>(DEFLATE_WINDOW_SIZE));
+				buffer.erase(buffer.begin(), buffer.begin() + static_cast<ptrdiff_t>(history_start - buffer_start));
+				buffer_start = history_start;
+
+				const size_t old_size = buffer.size();
+				buffer.resize(old_size + DEFLATE_BLOCK_SIZE);
+				input.read(reinterpret_cast<char*>(buffer.data() + old_size), DEFLATE_BLOCK_SIZE);
+				const size_t read = static_cast<size_t>(input.gcount());
+				buffer.resize(old_size + read);
+				crc = update_crc32(crc, buffer.data() + old_size, read);
+				total_size += read;
+				end_of_file = (read < DEFLATE_BLOCK_SIZE);
+			}
+
+			const int64 buffer_end = buffer_start + static_cast<int64>(buffer.size());
+			const int64 encode_end = end_of_file ? buffer_end : buffer_end - static_cast<int64>(DEFLATE_MAX_MATCH);		// keep lookahead for the next refill
+			while (position < encode_end) {
+
+				const size_t offset = static_cast<size_t>(position - buffer_start);
+				const size_t available = static_cast<size_t>(buffer_end - position);
+				size_t best_length = 0;
+				int64 best_distance = 0;
+
+				if (available >= DEFLATE_MIN_MATCH) {
+
+					const size_t max_length = std::min(available, DEFLATE_MAX_MATCH);
+					int64 candidate = head[hash_bytes(&buffer[offset])];
+					for (size_t chain = 0; chain < DEFLATE_MAX_CHAIN && candidate >= buffer_start && position - candidate <= static_cast<int64>(DEFLATE_WINDOW_SIZE); chain++) {
+
+						const u8* match = &buffer[static_cast<size_t>(candidate - buffer_start)];
+						size_t length = 0;
+						while (length < max_length && match[length] == buffer[offset + length])
+							length++;
+
+						if (length > best_length) {
+							best_length = length;
+							best_distance = position - candidate;
+							if (length == max_length)
+								break;
+						}
+
+						const int64 next = previous[static_cast<size_t>(candidate) & (DEFLATE_WINDOW_SIZE - 1)];
+						if (next >= candidate)											// slot was reused by a newer position
+							break;
+						candidate = next;
+					}
+					insert_hash(position);
+				}
+
+				if (best_length >= DEFLATE_MIN_MATCH) {
+
+					write_match(writer, static_cast<u32>(best_length), static_cast<u32>(best_distance));
+					for (size_t x = 1; x < best_length; x++)
+						if (static_cast<size_t>(buffer_end - (position + x)) >= DEFLATE_MIN_MATCH)
+							insert_hash(position + static_cast<int64>(x));
+					position += static_cast<int64>(best_length);
+
+				} else {
+
+					write_literal_length_symbol(writer, buffer[offset]);
+					position++;
+				}
+			}
+		}
+
+		write_literal_length_symbol(writer, 256);								// end of block
+		writer.finish();
+
+		const u32 trailer[2] = { crc, static_cast<u32>(total_size & 0xFFFFFFFF) };		// little endian on all supported platforms
+		output.write(reinterpret_cast<const char*>(trailer), sizeof(trailer));
+		output.close();
+
+		if (input.bad() || !output) {
+			std::error_code error{};
+			std::filesystem::remove(target, error);
+			return false;
+		}
+		return true;
+	}
 	
 }
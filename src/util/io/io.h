@@ -14,6 +14,26 @@ namespace AT::io {
 	// @return true if the file is successfully written, false otherwise.
 	bool write_file(const std::filesystem::path& file_path, const std::vector<char>& content_buffer);
 
+	// CRC-32C (Castagnoli) of [size] bytes, continues [crc] so a checksum can be computed in parts (start with 0).
+	// Uses the SSE4.2 crc32 instruction when the CPU supports it, a lookup table otherwise.
+	// @return The checksum of all bytes passed so far.
+	u32 crc32c(u32 crc, const void* data, const size_t size);
+
+	// How much write_file_atomic() waits for the data to reach the disk.
+	enum class sync_policy : u8 {
+		none,					// the OS writes the file back eventually, a crash shortly after can lose the new file (never leaves a torn one)
+		file,					// fsync the data before the rename, after a crash the target is the complete old or the complete new file
+		file_and_directory,		// also fsync the directory so the rename itself survives a power loss (same as [file] on Windows)
+	};
+
+	// Writes [size] bytes to a temporary file next to [path] with a single write call (split only beyond 1 GiB) and renames it over [path],
+	// so readers and a crash never see a partially written file. The temporary file gets a unique name from the OS and the permissions of
+	// the file it replaces (0644 for a new file).
+	// @param policy fsync calls before and after the rename, see sync_policy
+	// @note on Windows this fails while [path] is mapped (see mapped_file)
+	// @return true if [path] holds the new content, false otherwise (the temporary file is removed and [path] is unchanged)
+	bool write_file_atomic(const std::filesystem::path& path, const char* data, const size_t size, const sync_policy policy = sync_policy::none);
+
 	// Copies a file to the specified target directory. Creates the target directory if it does not exist.
 	// @param full_path_to_file The full path to the source file to copy.
 	// @param target_directory The directory to which the file will be copied.
@@ -67,5 +87,44 @@ namespace AT::io {
 	// @return True if the write operation succeeds, false otherwise.
 	bool write_to_file(const char* data, const std::filesystem::path& filename);
 
+	// Compresses [source] into a gzip file at [target] (DEFLATE with fixed Huffman codes and LZ77 matches).
+	// The file is streamed in blocks, so the memory use does not depend on the file size.
+	// @param source The file to compress.
+	// @param target The path of the .gz file to create, an existing file is overwritten.
+	// @return True if the complete file was compressed, false otherwise (a partial target file is removed).
+	bool compress_file_gzip(const std::filesystem::path& source, const std::filesystem::path& target);
+
+
+	// Read-only memory mapping of a whole file, pages are only loaded from disk when they are first accessed.
+	// On Linux the file can be replaced (rename, write_file_atomic()) while it is mapped, the mapping keeps the old content.
+	// On Windows a file with a live view can not be replaced, write_file_atomic() fails and leaves it unchanged until the mapping is released.
+	class mapped_file {
+	public:
+
+		mapped_file() = default;
+
+		// Maps [path], check is_open() for the result (an empty file is open with size 0).
+		explicit mapped_file(const std::filesystem::path& path);
+
+		~mapped_file();
+
+		mapped_file(mapped_file&& other) noexcept;
+		mapped_file& operator=(mapped_file&& other) noexcept;
+		mapped_file(const mapped_file&) = delete;
+		mapped_file& operator=(const mapped_file&) = delete;
+
+		bool is_open() const										{ return m_open; }
+		const char* data() const									{ return m_data; }
+		size_t size() const											{ return m_size; }
+
+	private:
+
+		void unmap();
+
+		const char* 				m_data = nullptr;
+		size_t 						m_size = 0;
+		bool 						m_open = false;
+	};
+
 
 }
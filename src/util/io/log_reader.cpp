@@ -0,0 +1,356 @@
+#include <util/pch.h>
+
+#include "log_reader.h"
+
+
+namespace AT::logger {
+
+    #define READ_BLOCK_SIZE                                     (4 * 1024 * 1024)   // bytes read from the file at once
+
+    static const std::string_view                               severity_names[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"};
+
+
+    static bool matches_filter(const log_record& record, const log_filter& filter) {
+
+        if (record.msg_sev < filter.min_severity || record.timestamp < filter.begin_timestamp || record.timestamp >= filter.end_timestamp)
+            return false;
+
+        if (!filter.thread.empty() && record.thread != filter.thread)
+            return false;
+
+        if (!filter.file_contains.empty() && record.file_name.find(filter.file_contains) == std::string_view::npos)
+            return false;
+
+        return filter.message_contains.empty() || record.message.find(filter.message_contains) != std::string_view::npos;
+    }
+
+    // ========================================================================================================================
+    // JSON lines
+    // ========================================================================================================================
+
+    static void skip_whitespace(const char*& cursor, const char* end) {
+
+        while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r'))
+            cursor++;
+    }
+
+
+    static void append_utf8(std::string& output, const u32 code_point) {
+
+        if (code_point < 0x80)
+            output.push_back(static_cast<char>(code_point));
+        else if (code_point < 0x800) {
+            output.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+            output.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        } else {
+            output.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+            output.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        }
+    }
+
+
+    // Parses a string starting at [cursor] (on the opening quote), strings without escapes are not copied
+    static bool parse_json_string(const char*& cursor, const char* end, std::string_view& result, std::string& scratch) {
+
+        if (cursor >= end || *cursor != '"')
+            return false;
+
+        const char* begin = ++cursor;
+        while (cursor < end && *cursor != '"' && *cursor != '\\')
+            cursor++;
+
+        if (cursor >= end)
+            return false;
+
+        if (*cursor == '"') {
+            result = std::string_view(begin, static_cast<size_t>(cursor - begin));
+            cursor++;
+            return true;
+        }
+
+        scratch.assign(begin, cursor);
+        while (cursor < end && *cursor != '"') {
+
+            if (*cursor != '\\') {
+                scratch.push_back(*cursor++);
+                continue;
+            }
+
+            if (++cursor >= end)
+                return false;
+
+            switch (*cursor++) {
+                case '"':   scratch.push_back('"'); break;
+                case '\\':  scratch.push_back('\\'); break;
+                case '/':   scratch.push_back('/'); break;
+                case 'b':   scratch.push_back('\b'); break;
+                case 'f':   scratch.push_back('\f'); break;
+                case 'n':   scratch.push_back('\n'); break;
+                case 'r':   scratch.push_back('\r'); break;
+                case 't':   scratch.push_back('\t'); break;
+                case 'u': {
+                    u32 code_point = 0;
+                    if (end - cursor < 4 || std::from_chars(cursor, cursor + 4, code_point, 16).ptr != cursor + 4)
+                        return false;
+
+                    append_utf8(scratch, code_point);
+                    cursor += 4;
+                } break;
+                default:    return false;
+            }
+        }
+
+        if (cursor >= end)
+            return false;
+
+        cursor++;
+        result = scratch;
+        return true;
+    }
+
+
+    template<typename T>
+    static bool parse_json_number(const char*& cursor, const char* end, T& result) {
+
+        const auto [ptr, error] = std::from_chars(cursor, end, result);
+        if (error != std::errc())
+            return false;
+
+        cursor = ptr;
+        return true;
+    }
+
+
+    // Skips a value of an unknown key (written by a newer version of the logger)
+    static bool skip_json_value(const char*& cursor, const char* end, std::string& scratch) {
+
+        if (cursor < end && *cursor == '"') {
+            std::string_view ignored{};
+            return parse_json_string(cursor, end, ignored, scratch);
+        }
+
+        while (cursor < end && *cursor != ',' && *cursor != '}')
+            cursor++;
+
+        return cursor < end;
+    }
+
+
+    // Parses one line written by the json_lines sink, every string field has its own [scratch] buffer for unescaped text
+    static bool parse_json_line(const std::string_view line, log_record& record, std::string (&scratch)[5]) {
+
+        const char* cursor = line.data();
+        const char* end = line.data() + line.size();
+        record = log_record{};
+
+        skip_whitespace(cursor, end);
+        if (cursor >= end || *cursor++ != '{')
+            return false;
+
+        while (true) {
+
+            skip_whitespace(cursor, end);
+            std::string_view key{};
+            if (!parse_json_string(cursor, end, key, scratch[4]))
+                return false;
+
+            skip_whitespace(cursor, end);
+            if (cursor >= end || *cursor++ != ':')
+                return false;
+
+            skip_whitespace(cursor, end);
+            bool valid = true;
+            if (key == "timestamp")
+                valid = parse_json_number(cursor, end, record.timestamp);
+            else if (key == "line")
+                valid = parse_json_number(cursor, end, record.line);
+            else if (key == "file")
+                valid = parse_json_string(cursor, end, record.file_name, scratch[0]);
+            else if (key == "function")
+                valid = parse_json_string(cursor, end, record.function_name, scratch[1]);
+            else if (key == "thread")
+                valid = parse_json_string(cursor, end, record.thread, scratch[2]);
+            else if (key == "message")
+                valid = parse_json_string(cursor, end, record.message, scratch[3]);
+            else if (key == "severity") {
+                std::string_view name{};
+                valid = parse_json_string(cursor, end, name, scratch[4]);
+                const auto found = std::find(std::begin(severity_names), std::end(severity_names), name);
+                valid = valid && found != std::end(severity_names);
+                if (valid)
+                    record.msg_sev = static_cast<severity>(found - std::begin(severity_names));
+            } else
+                valid = skip_json_value(cursor, end, scratch[4]);
+
+            if (!valid)
+                return false;
+
+            skip_whitespace(cursor, end);
+            if (cursor >= end)
+                return false;
+
+            const char separator = *cursor++;
+            if (separator == '}')
+                return true;
+
+            if (separator != ',')
+                return false;
+        }
+    }
+
+
+    // Parses every complete line in [data], returns the number of consumed bytes or std::nullopt for an invalid line
+    static std::optional<size_t> read_json_lines(const std::string_view data, const bool is_end_of_file, const log_filter& filter, const std::function<bool(const log_record&)>& callback, bool& stop) {
+
+        log_record record{};
+        std::string scratch[5]{};
+        size_t offset = 0;
+        while (offset < data.size() && !stop) {
+
+            const void* line_end = std::memchr(data.data() + offset, '\n', data.size() - offset);
+            size_t line_length = (line_end) ? static_cast<size_t>(static_cast<const char*>(line_end) - (data.data() + offset)) : data.size() - offset;
+            if (!line_end && !is_end_of_file)
+                break;                                                                      // incomplete line, wait for the next block
+
+            const std::string_view line = data.substr(offset, line_length);
+            offset += line_length + ((line_end) ? 1 : 0);
+            if (line.find_first_not_of(" \t\r") == std::string_view::npos)
+                continue;
+
+            if (!parse_json_line(line, record, scratch)) {
+                if (!line_end)
+                    break;                                                                  // last line was cut off
+
+                return std::nullopt;
+            }
+
+            if (matches_filter(record, filter))
+                stop = !callback(record);
+        }
+        return offset;
+    }
+
+    // ========================================================================================================================
+    // binary
+    // ========================================================================================================================
+
+    // Parses every complete record in [data], returns the number of consumed bytes or std::nullopt for an invalid record
+    // @param required_size set to the size of a record that does not fit into [data]
+    static std::optional<size_t> read_binary_records(const std::string_view data, const log_filter& filter, const std::function<bool(const log_record&)>& callback, bool& stop, size_t& required_size) {
+
+        log_record record{};
+        size_t offset = 0;
+        while (!stop && data.size() - offset >= sizeof(u32)) {
+
+            u32 record_size = 0;
+            std::memcpy(&record_size, data.data() + offset, sizeof(record_size));
+            if (record_size < structured_record_fixed_size)
+                return std::nullopt;
+
+            if (data.size() - offset - sizeof(u32) < record_size) {
+                required_size = sizeof(u32) + record_size;
+                break;
+            }
+
+            const char* cursor = data.data() + offset + sizeof(u32);
+            u8 msg_sev = 0;
+            int32 line = 0;
+            u16 file_length = 0, function_length = 0, thread_length = 0;
+            u32 message_length = 0;
+            auto read_raw = [&cursor](auto& value) { std::memcpy(&value, cursor, sizeof(value)); cursor += sizeof(value); };
+            read_raw(msg_sev);
+            read_raw(record.timestamp);
+            read_raw(line);
+            read_raw(file_length);
+            read_raw(function_length);
+            read_raw(thread_length);
+            read_raw(message_length);
+
+            if (msg_sev > static_cast<u8>(severity::Fatal) || static_cast<u64>(structured_record_fixed_size) + file_length + function_length + thread_length + message_length != record_size)
+                return std::nullopt;
+
+            record.msg_sev = static_cast<severity>(msg_sev);
+            record.line = line;
+            record.file_name = std::string_view(cursor, file_length);
+            cursor += file_length;
+            record.function_name = std::string_view(cursor, function_length);
+            cursor += function_length;
+            record.thread = std::string_view(cursor, thread_length);
+            cursor += thread_length;
+            record.message = std::string_view(cursor, message_length);
+
+            offset += sizeof(u32) + record_size;
+            if (matches_filter(record, filter))
+                stop = !callback(record);
+        }
+        return offset;
+    }
+
+    // ========================================================================================================================
+    // reader
+    // ========================================================================================================================
+
+    bool read_structured_log(const std::filesystem::path& path, const log_filter& filter, const std::function<bool(const log_record&)>& callback) {
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        std::vector<char> buffer(READ_BLOCK_SIZE);
+        size_t begin = 0;                                                                   // first unprocessed byte in [buffer]
+        size_t filled = 0;
+        bool is_end_of_file = false;
+
+        auto read_block = [&]() {
+
+            if (begin > 0) {                                                                // keep the incomplete record at the front
+                std::memmove(buffer.data(), buffer.data() + begin, filled - begin);
+                filled -= begin;
+                begin = 0;
+            }
+
+            file.read(buffer.data() + filled, static_cast<std::streamsize>(buffer.size() - filled));
+            filled += static_cast<size_t>(file.gcount());
+            is_end_of_file = !file;
+        };
+
+        read_block();
+        constexpr size_t header_size = sizeof(structured_log_magic) + sizeof(structured_log_version);
+        const bool is_binary = filled >= sizeof(structured_log_magic) && std::memcmp(buffer.data(), structured_log_magic, sizeof(structured_log_magic)) == 0;
+        if (is_binary) {
+
+            u32 version = 0;
+            if (filled < header_size)
+                return false;
+
+            std::memcpy(&version, buffer.data() + sizeof(structured_log_magic), sizeof(version));
+            if (version != structured_log_version)
+                return false;
+
+            begin = header_size;
+        }
+
+        bool stop = false;
+        while (!stop) {
+
+            const std::string_view data(buffer.data() + begin, filled - begin);
+            size_t required_size = 0;
+            const auto consumed = (is_binary) ? read_binary_records(data, filter, callback, stop, required_size) : read_json_lines(data, is_end_of_file, filter, callback, stop);
+            if (!consumed)
+                return false;
+
+            begin += *consumed;
+            if (stop || is_end_of_file)
+                break;
+
+            const size_t needed_size = std::max(required_size, filled - begin + 1);        // a single record/line can be bigger than the buffer
+            if (needed_size > buffer.size())
+                buffer.resize(std::max(buffer.size() * 2, needed_size));
+            read_block();
+        }
+
+        return true;
+    }
+
+}
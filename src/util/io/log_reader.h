@@ -0,0 +1,51 @@
+#pragma once
+
+#include "util/pch.h"
+#include "util/io/logger.h"
+
+// Reading back the files written by the structured log sink (see logger::open_structured_sink())
+namespace AT::logger {
+
+    // Binary layout
+    //  file header:    "ATLOGBIN" (8 bytes) + u32 version
+    //  every record:   u32 size of the record without this field
+    //                  u8 severity, int64 timestamp (microseconds since the unix epoch), int32 line,
+    //                  u16 file name length, u16 function name length, u16 thread length, u32 message length,
+    //                  followed by the four strings (not null terminated)
+    // @note all numbers are stored in the byte order of the machine that wrote the log
+    constexpr char                  structured_log_magic[8] = { 'A', 'T', 'L', 'O', 'G', 'B', 'I', 'N' };
+    constexpr u32                   structured_log_version = 1;
+    constexpr size_t                structured_record_fixed_size = sizeof(u8) + sizeof(int64) + sizeof(int32) + 3 * sizeof(u16) + sizeof(u32);
+
+
+    // One message of a structured log
+    // @note the strings point into the buffer of the reader and are only valid inside the callback
+    struct log_record {
+        severity                    msg_sev = severity::Trace;
+        int64                       timestamp = 0;                  // microseconds since the unix epoch
+        int                         line = 0;
+        std::string_view            file_name{};
+        std::string_view            function_name{};
+        std::string_view            thread{};                       // thread label or thread id
+        std::string_view            message{};
+    };
+
+
+    // Records that don't match every set condition are skipped before the callback is called
+    struct log_filter {
+        severity                    min_severity = severity::Trace;
+        int64                       begin_timestamp = std::numeric_limits<int64>::min();     // microseconds since the unix epoch, inclusive
+        int64                       end_timestamp = std::numeric_limits<int64>::max();       // microseconds since the unix epoch, exclusive
+        std::string                 thread{};                       // exact thread label/id, empty = all threads
+        std::string                 file_contains{};                // part of the file name, empty = all files
+        std::string                 message_contains{};             // part of the message, empty = all messages
+    };
+
+
+    // Reads a log written by the structured sink (the format is detected from the file header) in large blocks
+    // and calls [callback] for every record matching [filter], the callback can return false to stop reading.
+    // @note a record that was cut off at the end of the file (e.g. after a crash) is ignored
+    // @return false if the file could not be opened or contains an invalid record
+    bool read_structured_log(const std::filesystem::path& path, const log_filter& filter, const std::function<bool(const log_record&)>& callback);
+
+}
@@ -1,6 +1,20 @@
 #include <util/pch.h>
 #include "util/util.h"
 
+#if defined(PLATFORM_WINDOWS)
+    #include <Windows.h>
+    #include <io.h>
+    #include <fcntl.h>
+#elif defined(PLATFORM_LINUX)
+    #include <fcntl.h>
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+#include "util/io/io.h"
+#include "util/io/log_reader.h"
+
 #include "logger.h"
 
 
@@ -8,7 +22,6 @@
 namespace AT::logger {
 
     
-    #define SETW(width)                                         std::setw(width) << std::setfill('0')
     // #define INTERNAL_LOG(message)                               { std::ostringstream oss{}; oss << message; log_string(std::move(oss.str())); }
 
     #define LOGGER_UPDATE_FORMAT                                "LOGGER update format"
@@ -23,23 +36,26 @@ namespace AT::logger {
     #define QUEUE_MAX_SIZE                                      512
 #endif
 
-    #define OPEN_FILE                                           s_main_file = std::ofstream(s_main_log_file_path, std::ios::app);                       \
-                                                                if (!s_main_file.is_open()) {                                                         \
-                                                                    std::cerr << "Failed to open main log file path: [" << s_main_log_file_path << "]" << std::endl;                      \
-                                                                    std::quick_exit(1);                                                             \
-                                                                }
+    #define LOGGER_CHANGE_FLUSH_INTERVAL                        "LOGGER change flush interval"
+    #define LOGGER_CHANGE_ROTATION                              "LOGGER change rotation"
+    #define LOGGER_CHANGE_STRUCTURED_SINK                       "LOGGER change structured sink"
+    #define LOGGER_CHANGE_SINKS                                 "LOGGER change sinks"
+    #define LOGGER_RELEASE_THREAD_NAME                          "LOGGER release thread name"
+
+    #define WRITE_TO_FILE(message)                              { std::ostringstream loc_oss{}; loc_oss << message; s_main_file.write(loc_oss.str(), false); }
 
-    #define CLOSE_FILE                                          if (s_main_file.is_open()) { s_main_file.close(); }
-    #define WRITE_TO_FILE(message)                              { OPEN_FILE s_main_file << message; CLOSE_FILE}
+    #define RING_BUFFER_CAPACITY                                1024            // slots per producer thread, needs to be a power of 2
+
+    #define DROP_REPORT_INTERVAL                                std::chrono::seconds(1)
+
+    #define CRASH_THREAD_NAME_SIZE                              48              // bytes of the thread name copied into a crash record
 
     static bool                                                 s_is_init = false;
-    static bool                                                 s_write_log_to_console = false;
     static std::string                                          s_format_current = "";
     static std::string                                          s_format_prev = "";
 
-    static severity                                             s_severity_level_buffering_threshold = severity::Trace;
-    static size_t                                               s_buffer_size = 1024;
-    static std::string                                          s_buffered_messages{};
+    static std::atomic<severity>                                s_severity_level_buffering_threshold = severity::Trace;
+    static std::chrono::milliseconds                            s_flush_interval{0};
 
     const std::string                                           severity_names[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"};
     const std::string                                           console_rest = "\x1b[0m";
@@ -53,31 +69,801 @@ namespace AT::logger {
     };
 
     static std::filesystem::path                                s_main_log_dir = "";
+    static std::deque<rotation_settings>                        s_pending_rotations{};              // guarded by [s_general_mutex], one entry per queued LOGGER_CHANGE_ROTATION
     static std::filesystem::path                                s_main_log_file_path = "";
-    static std::ofstream                                        s_main_file{};
+
+    // Compresses rotated segments and deletes the ones beyond the retention count on a low priority thread,
+    // so a rotation never waits for the disk. The thread is started with the first job.
+    class segment_compressor {
+    public:
+
+        ~segment_compressor() { stop(); }                                   // file sinks can outlive shutdown()
+
+        struct job {
+            std::filesystem::path                               main_file{};
+            std::filesystem::path                               segment{};
+            bool                                                compress = true;
+            u32                                                 retention_count = 0;
+        };
+
+        void add(job&& new_job) {
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_jobs.push_back(std::move(new_job));
+                if (!m_thread.joinable()) {
+                    m_stop = false;
+                    m_thread = std::thread(&segment_compressor::run, this);
+                }
+            }
+            m_cv.notify_one();
+        }
+
+        // Finishes all queued jobs and stops the thread
+        void stop() {
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_cv.notify_one();
+            if (m_thread.joinable())
+                m_thread.join();
+        }
+
+    private:
+
+        void run() {
+
+#if defined(PLATFORM_WINDOWS)
+            SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(PLATFORM_LINUX)
+            setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);                   // on Linux the nice value is per thread
+#endif
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (true) {
+
+                m_cv.wait(lock, [this] { return !m_jobs.empty() || m_stop; });
+                if (m_jobs.empty())                                         // stopped and nothing left
+                    break;
+
+                const job current = std::move(m_jobs.front());
+                m_jobs.pop_front();
+                lock.unlock();
+
+                std::error_code error{};
+                if (current.compress) {
+                    std::filesystem::path target = current.segment;
+                    target += ".gz";
+                    if (io::compress_file_gzip(current.segment, target))
+                        std::filesystem::remove(current.segment, error);
+                }
+
+                if (current.retention_count > 0)
+                    apply_retention(current.main_file, current.retention_count);
+
+                lock.lock();
+            }
+        }
+
+        // Parses the name of a segment rotate() created: [prefix]YYYY-MM-DD_HH-MM-SS[_N][extension][.gz]
+        // @return the timestamp and the counter of rotations in the same second, nothing for any other file
+        static std::optional<std::pair<std::string, u32>> parse_segment_name(std::string_view name, const std::string& prefix, const std::string& extension) {
+
+            static constexpr std::string_view timestamp_pattern = "0000-00-00_00-00-00";             // 0 = any digit
+            if (name.size() < prefix.size() + timestamp_pattern.size() + extension.size() || name.compare(0, prefix.size(), prefix) != 0)
+                return std::nullopt;
+
+            name.remove_prefix(prefix.size());
+            for (size_t x = 0; x < timestamp_pattern.size(); x++)
+                if ((timestamp_pattern[x] == '0') ? !std::isdigit(static_cast<unsigned char>(name[x])) : (name[x] != timestamp_pattern[x]))
+                    return std::nullopt;
+
+            const std::string timestamp(name.substr(0, timestamp_pattern.size()));
+            name.remove_prefix(timestamp_pattern.size());
+            if (name.ends_with(".gz"))
+                name.remove_suffix(3);
+            if (!name.ends_with(extension))
+                return std::nullopt;
+            name.remove_suffix(extension.size());
+
+            u32 counter = 0;
+            if (!name.empty()) {
+                if (name.size() < 2 || name.front() != '_' || !std::all_of(name.begin() + 1, name.end(), [](const char c) { return std::isdigit(static_cast<unsigned char>(c)); }))
+                    return std::nullopt;
+                if (std::from_chars(name.data() + 1, name.data() + name.size(), counter).ec != std::errc{})
+                    return std::nullopt;
+            }
+            return std::make_pair(timestamp, counter);
+        }
+
+        // Deletes the oldest segments of [main_file] until [retention_count] are left, other files with the same stem are never touched
+        static void apply_retention(const std::filesystem::path& main_file, const u32 retention_count) {
+
+            const std::string prefix = main_file.stem().string() + "_";
+            const std::string extension = main_file.extension().string();
+
+            std::error_code error{};
+            std::vector<std::pair<std::pair<std::string, u32>, std::filesystem::path>> segments{};            // sorted by timestamp, then counter
+            for (const auto& entry : std::filesystem::directory_iterator(main_file.parent_path(), error))
+                if (auto key = parse_segment_name(entry.path().filename().string(), prefix, extension))
+                    segments.emplace_back(std::move(*key), entry.path());
+
+            if (segments.size() <= retention_count)
+                return;
+
+            std::sort(segments.begin(), segments.end());
+            for (size_t x = 0; x < segments.size() - retention_count; x++)
+                std::filesystem::remove(segments[x].second, error);
+        }
+
+        std::mutex                                              m_mutex{};
+        std::condition_variable                                 m_cv{};
+        std::deque<job>                                         m_jobs{};
+        std::thread                                             m_thread{};
+        bool                                                    m_stop = false;
+    };
+
+    static segment_compressor                                   s_segment_compressor{};
+
+    // Keeps the log file open for the whole session and collects messages in its own write buffer.
+    // The buffer is written with a single write call when it is full, when a message at/above the
+    // buffering threshold arrives (Error/Fatal always) or when the flush interval elapsed.
+    // Only used by one thread at a time: the worker thread (and init/shutdown while the worker is not running) or the thread of a file_sink.
+    class log_file {
+    public:
+
+        bool open(const std::filesystem::path& path, const bool append) {
+
+            m_stats.messages_written = 0;
+            m_stats.bytes_written = 0;
+            m_stats.write_calls = 0;
+            m_stats.rotations = 0;
+
+            std::error_code error{};
+            const auto existing_size = std::filesystem::file_size(path, error);
+            m_file_size = (append && !error) ? static_cast<u64>(existing_size) : 0;
+            m_path = path;
+            m_segment_start = std::chrono::steady_clock::now();
+            m_rotation_retry = {};
+
+            m_stream.rdbuf()->pubsetbuf(nullptr, 0);                       // unbuffered, [m_buffer] is the only buffer
+            m_stream.open(path, (append) ? (std::ios::out | std::ios::app) : std::ios::out);
+            m_last_flush = std::chrono::steady_clock::now();
+            return m_stream.is_open();
+        }
+
+        bool is_open() const { return m_stream.is_open(); }
+
+        void close() {
+
+            flush();
+            if (m_stream.is_open())
+                m_stream.close();
+        }
+
+        // Appends [data] to the write buffer, flushes if [force_flush] is set, the buffer would overflow or the file reached its rotation size
+        void write(const std::string_view data, const bool force_flush) {
+
+            m_stats.messages_written.fetch_add(1, std::memory_order_relaxed);
+            m_buffer.append(data);
+            if (force_flush || m_buffer.size() >= m_capacity || is_rotation_size_reached(m_buffer.size()))
+                flush();
+        }
+
+        void flush() {
+
+            if (m_buffer.empty() || !m_stream.is_open())
+                return;
+
+            m_stream.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+            m_stats.bytes_written.fetch_add(m_buffer.size(), std::memory_order_relaxed);
+            m_stats.write_calls.fetch_add(1, std::memory_order_relaxed);
+            m_file_size += m_buffer.size();
+            m_buffer.clear();
+            m_last_flush = std::chrono::steady_clock::now();
+
+            if (is_rotation_size_reached(0))
+                rotate();
+        }
+
+        // Rotates the file if the rotation interval elapsed, called by the worker after every batch
+        void rotate_if_due() {
+
+            if (m_rotation.interval.count() > 0 && std::chrono::steady_clock::now() - m_segment_start >= m_rotation.interval) {
+                flush();
+                if (std::chrono::steady_clock::now() - m_segment_start >= m_rotation.interval)     // flush() might already have rotated by size
+                    rotate();
+            }
+        }
+
+        void set_rotation(const rotation_settings& settings) { m_rotation = settings; }
+
+        // Flushes if the buffer holds data older than [interval], 0 disables time based flushing
+        void flush_if_older_than(const std::chrono::milliseconds interval) {
+
+            if (interval.count() > 0 && !m_buffer.empty() && std::chrono::steady_clock::now() - m_last_flush >= interval)
+                flush();
+        }
+
+        size_t get_capacity() const { return m_capacity; }
+
+        void set_capacity(const size_t capacity) {
+
+            m_capacity = capacity;
+            if (m_buffer.size() >= m_capacity)                              // Handle buffer overflow if the new size is smaller than the current buffer content
+                flush();
+
+            m_buffer.shrink_to_fit();
+            m_buffer.reserve(m_capacity);
+        }
+
+        file_sink_stats get_stats() const {
+
+            file_sink_stats stats{};
+            stats.messages_written = m_stats.messages_written.load(std::memory_order_relaxed);
+            stats.bytes_written = m_stats.bytes_written.load(std::memory_order_relaxed);
+            stats.write_calls = m_stats.write_calls.load(std::memory_order_relaxed);
+            const u64 unbuffered_syscalls = stats.messages_written * 3;     // open + write + close for every message
+            stats.syscalls_avoided = (unbuffered_syscalls > stats.write_calls) ? unbuffered_syscalls - stats.write_calls : 0;
+            stats.rotations = m_stats.rotations.load(std::memory_order_relaxed);
+            return stats;
+        }
+
+    private:
+
+        // After a failed rotation the file grows past its size until the retry
+        bool is_rotation_size_reached(const size_t pending) const {
+
+            return m_rotation.max_file_size > 0 && m_file_size + pending >= m_rotation.max_file_size && std::chrono::steady_clock::now() >= m_rotation_retry;
+        }
+
+        // Moves the current file aside as a timestamped segment and continues in an empty file, the segment is
+        // handed to the background compressor. The buffer is already written at this point.
+        // If the file can not be renamed it is continued and the rotation is retried after [rotation_retry_delay].
+        void rotate() {
+
+            static constexpr auto rotation_retry_delay = std::chrono::seconds(1);
+            if (std::chrono::steady_clock::now() < m_rotation_retry)
+                return;
+
+            m_stream.close();
+
+            const auto now = std::time(nullptr);
+            const auto tm = *std::localtime(&now);
+            std::ostringstream timestamp{};
+            timestamp << std::put_time(&tm, "%Y-%m-%d_%H-%M-%S");
+
+            // more than one rotation in the same second get an increasing counter, never reuse the name of a segment the retention already removed
+            m_rotation_counter = (timestamp.str() == m_last_rotation_timestamp) ? m_rotation_counter + 1 : 0;
+            m_last_rotation_timestamp = timestamp.str();
+
+            std::filesystem::path segment{};
+            std::error_code error{};
+            for (bool first = true; first || std::filesystem::exists(segment, error) || std::filesystem::exists(std::filesystem::path(segment).concat(".gz"), error); first = false) {
+                if (!first)
+                    m_rotation_counter++;
+                std::string name = m_path.stem().string() + "_" + timestamp.str();
+                if (m_rotation_counter > 0)
+                    name += "_" + std::to_string(m_rotation_counter);
+                segment = m_path.parent_path() / (name + m_path.extension().string());
+            }
+
+            std::filesystem::rename(m_path, segment, error);
+            if (error) {
+                m_stream.open(m_path, std::ios::out | std::ios::app);                 // still the current log, keep its content and size
+                m_rotation_retry = std::chrono::steady_clock::now() + rotation_retry_delay;
+                m_buffer.append("[LOGGER] Failed to rotate log file: [" + error.message() + "]\n");
+                return;
+            }
+
+            m_stream.open(m_path, std::ios::out | std::ios::trunc);
+            m_file_size = 0;
+            m_segment_start = std::chrono::steady_clock::now();
+            m_stats.rotations.fetch_add(1, std::memory_order_relaxed);
+
+            m_buffer.append("[LOGGER] Log rotated at [" + timestamp.str() + "], previous segment: [" + segment.filename().string() + "]\n");
+            s_segment_compressor.add({ m_path, segment, m_rotation.compress, m_rotation.retention_count });
+        }
+
+        struct {
+            std::atomic<u64>                                    messages_written = 0;
+            std::atomic<u64>                                    bytes_written = 0;
+            std::atomic<u64>                                    write_calls = 0;
+            std::atomic<u64>                                    rotations = 0;
+        }                                                       m_stats{};
+
+        std::ofstream                                           m_stream{};
+        std::string                                             m_buffer{};
+        size_t                                                  m_capacity = 1024;
+        std::chrono::steady_clock::time_point                   m_last_flush{};
+
+        std::filesystem::path                                   m_path{};
+        u64                                                     m_file_size = 0;
+        rotation_settings                                       m_rotation{};
+        std::chrono::steady_clock::time_point                   m_segment_start{};
+        std::string                                             m_last_rotation_timestamp{};
+        u32                                                     m_rotation_counter = 0;
+        std::chrono::steady_clock::time_point                   m_rotation_retry{};             // rotate() waits until then after a failed rename
+    };
+
+    static log_file                                             s_main_file{};
+
+    // structured sink, see open_structured_sink()
+    struct pending_structured_sink {
+        std::unique_ptr<log_file>                               sink{};             // nullptr closes the current sink
+        structured_format                                       format = structured_format::json_lines;
+    };
+    static std::unique_ptr<log_file>                            s_structured_file{};                // guarded by [s_general_mutex], written by the worker
+    static structured_format                                    s_structured_format = structured_format::json_lines;
+    static std::deque<pending_structured_sink>                  s_pending_structured_sinks{};       // guarded by [s_general_mutex], one entry per queued LOGGER_CHANGE_STRUCTURED_SINK
+    static std::string                                          s_structured_buffer{};              // reused for every record, only touched by the worker
+
+    // Own thread of a sink added with add_sink(.., true), messages are copied into its queue and written in batches
+    class sink_worker {
+    public:
+
+        explicit sink_worker(std::shared_ptr<sink> target)
+            : m_target(std::move(target)) { m_thread = std::thread(&sink_worker::run, this); }
+
+        ~sink_worker() { stop(); }
+
+        // Called by the logger worker, never blocks on the sink
+        void push(const sink_entry& entry) {
+
+            bool was_empty = false;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_queue.size() >= LOGGER_SINK_QUEUE_LIMIT && entry.msg_sev < severity::Error) {
+                    m_target->m_dropped_messages.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+
+                was_empty = m_queue.empty();
+                m_queue.push_back({ entry.msg_sev, entry.timestamp, entry.file_name, entry.function_name, entry.line, std::string(entry.thread), std::string(entry.message), std::string(entry.formatted) });
+            }
+
+            if (was_empty)
+                m_cv.notify_one();
+        }
+
+        // Writes the remaining messages and stops the thread
+        void stop() {
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_cv.notify_one();
+            if (m_thread.joinable())
+                m_thread.join();
+        }
+
+    private:
+
+        struct queued_entry {
+            severity                                            msg_sev;
+            std::chrono::system_clock::time_point               timestamp;
+            const char*                                         file_name;
+            const char*                                         function_name;
+            int                                                 line;
+            std::string                                         thread;             // copied, the interned name can be released
+            std::string                                         message;
+            std::string                                         formatted;
+        };
+
+        void run() {
+
+            std::deque<queued_entry> batch{};
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (true) {
+
+                m_cv.wait_for(lock, std::chrono::milliseconds(100), [this] { return !m_queue.empty() || m_stop; });
+                const bool stop = m_stop;
+                batch.swap(m_queue);
+                lock.unlock();
+
+                for (const queued_entry& queued : batch)
+                    m_target->write({ queued.msg_sev, queued.timestamp, queued.file_name, queued.function_name, queued.line, queued.thread, queued.message, queued.formatted });
+
+                m_target->flush();
+                batch.clear();
+                lock.lock();
+                if (stop && m_queue.empty())
+                    break;
+            }
+        }
+
+        std::shared_ptr<sink>                                   m_target;
+        std::deque<queued_entry>                                m_queue{};
+        std::mutex                                              m_mutex{};
+        std::condition_variable                                 m_cv{};
+        bool                                                    m_stop = false;
+        std::thread                                             m_thread{};
+    };
+
+    // sinks of add_sink(), see LOGGER_CHANGE_SINKS
+    struct sink_slot {
+        std::shared_ptr<sink>                                   target{};
+        std::unique_ptr<sink_worker>                            worker{};           // nullptr = written by the logger worker
+    };
+    struct pending_sink_change {
+        std::shared_ptr<sink>                                   target{};
+        bool                                                    use_own_thread = false;
+        bool                                                    remove = false;
+    };
+    static std::vector<sink_slot>                               s_sinks{};                          // only touched by the worker (and init/shutdown while the worker is not running)
+    static std::deque<pending_sink_change>                      s_pending_sink_changes{};           // guarded by [s_general_mutex], one entry per queued LOGGER_CHANGE_SINKS
+
+    // A log format compiled into a list of ops, so the format string is only parsed when it changes
+    enum class format_op_type : u8 {
+        literal,                    // text between the tags, stored in [format_program::literals]
+        color_begin,                // $B
+        color_end,                  // $E
+        message,                    // $C
+        severity,                   // $L
+        alignment,                  // $X
+        new_line,                   // $Z
+        thread,                     // $Q
+        function_name,              // $F
+        short_function_name,        // $P
+        file_name,                  // $A
+        short_file_name,            // $I
+        line,                       // $G
+        time,                       // $T
+        hour,                       // $H
+        minute,                     // $M
+        second,                     // $S
+        millisecond,                // $J
+        date,                       // $N
+        year,                       // $Y
+        month,                      // $O
+        day,                        // $D
+    };
+
+    struct format_op {
+        format_op_type                                          type = format_op_type::literal;
+        u32                                                     offset = 0;         // only used by literals
+        u32                                                     length = 0;
+    };
+
+    struct format_program {
+        std::string                                             literals{};
+        std::vector<format_op>                                  ops{};
+    };
+
+    static format_program                                       s_format_program{};
+    static std::string                                          s_line_buffer{};                    // reused for every formatted message, only touched by the worker
+
+    // Thread names (the label or the id as text) are interned, every message carries a pointer to the name of its thread from the
+    // call site on, so the worker needs neither a lock nor a hash lookup to print it. Every thread caches the pointer to its own name
+    // until a label changes. The id of a thread is released by the worker after the thread exited and its last message was processed
+    // (LOGGER_RELEASE_THREAD_NAME), labels and ids logged for other threads (log_msg()) are pinned, a label can be in flight anytime.
+    static constexpr u32                                        pinned_thread_name = UINT32_MAX;
+    static std::unordered_map<std::string, u32>                 s_interned_thread_names{};          // name => number of threads owning it, guarded by [s_thread_names_mutex], node based so the addresses stay valid
+    static std::unordered_map<std::thread::id, const std::string*> s_thread_labels{};               // guarded by [s_thread_names_mutex]
+    static std::mutex                                           s_thread_names_mutex{};
+    static std::atomic<u64>                                     s_thread_labels_version = 0;        // increased with every label change, invalidates the cached names
+    static thread_local const std::string*                      t_thread_name = nullptr;
+    static thread_local u64                                     t_thread_labels_version = 0;
+    static const std::string                                    s_unknown_thread_name = "";
+
+    format_program compile_format(const std::string& format) {
+
+        format_program program{};
+        auto add_literal = [&program](const char character) {
+
+            if (program.ops.empty() || program.ops.back().type != format_op_type::literal)
+                program.ops.push_back({format_op_type::literal, static_cast<u32>(program.literals.size()), 0});
+
+            program.literals.push_back(character);
+            program.ops.back().length++;
+        };
+
+        const size_t format_length = format.length();
+        for (size_t x = 0; x < format_length; x++) {
+
+            if (format[x] != '$' || x + 1 >= format_length) {
+                add_literal(format[x]);
+                continue;
+            }
+
+            format_op_type type;
+            switch (format[++x]) {
+                case 'B': type = format_op_type::color_begin; break;
+                case 'E': type = format_op_type::color_end; break;
+                case 'C': type = format_op_type::message; break;
+                case 'L': type = format_op_type::severity; break;
+                case 'X': type = format_op_type::alignment; break;
+                case 'Z': type = format_op_type::new_line; break;
+                case 'Q': type = format_op_type::thread; break;
+                case 'F': type = format_op_type::function_name; break;
+                case 'P': type = format_op_type::short_function_name; break;
+                case 'A': type = format_op_type::file_name; break;
+                case 'I': type = format_op_type::short_file_name; break;
+                case 'G': type = format_op_type::line; break;
+                case 'T': type = format_op_type::time; break;
+                case 'H': type = format_op_type::hour; break;
+                case 'M': type = format_op_type::minute; break;
+                case 'S': type = format_op_type::second; break;
+                case 'J': type = format_op_type::millisecond; break;
+                case 'N': type = format_op_type::date; break;
+                case 'Y': type = format_op_type::year; break;
+                case 'O': type = format_op_type::month; break;
+                case 'D': type = format_op_type::day; break;
+                default: continue;                                          // unknown tags are dropped
+            }
+            program.ops.push_back({type, 0, 0});
+        }
+        return program;
+    }
+
+    // Appends [value] with at least [width] digits (zero padded)
+    inline void append_number(std::string& output, const u64 value, const int width = 0) {
+
+        char digits[24];
+        const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        for (int x = static_cast<int>(result.ptr - digits); x < width; x++)
+            output.push_back('0');
+
+        output.append(digits, result.ptr);
+    }
 
     struct message_format {
-        message_format(const logger::severity msg_sev, const char* file_name, const char* function_name, const int line, std::thread::id thread_id, const std::string& message) 
-            : msg_sev(msg_sev), file_name(file_name), function_name(function_name), line(line), thread_id(thread_id), message(message) {};
-
-        const logger::severity                                  msg_sev;
-        const char*                                             file_name;
-        const char*                                             function_name;
-        const int                                               line;
-        const std::thread::id                                   thread_id;
-        const std::string                                       message;
+        message_format() = default;
+        message_format(const logger::severity msg_sev, const char* file_name, const char* function_name, const int line, std::thread::id thread_id, std::string message)
+            : msg_sev(msg_sev), file_name(file_name), function_name(function_name), line(line), thread_id(thread_id), message(std::move(message)) {};
+
+        logger::severity                                        msg_sev = severity::Trace;
+        const char*                                             file_name = "";
+        const char*                                             function_name = "";
+        int                                                     line = 0;
+        std::thread::id                                         thread_id{};
+        const std::string*                                      thread_name = &s_unknown_thread_name;   // interned label or id, set at the call site
+        std::string                                             message{};
+        u64                                                     sequence = 0;       // global order of all enqueued messages, used to merge the per-thread buffers
+        std::chrono::steady_clock::time_point                   timestamp = std::chrono::steady_clock::now();      // taken at the call site, converted to wall-clock when formatted
+
+        // LOG_DEFERRED() messages, [message] is filled by the worker
+        const char*                                             deferred_format = nullptr;
+        const deferred::arg_type*                               deferred_arg_types = nullptr;
+        u8                                                      deferred_arg_count = 0;
+        u32                                                     deferred_args_size = 0;
+        std::array<u8, LOGGER_DEFERRED_INLINE_ARG_SIZE>         deferred_args{};                        // raw argument bytes, bigger argument packs are stored in [message]
+    };
+
+    // Settings changes, thread labels, ... are queued as messages so they keep their order, they are never dropped
+    inline bool is_control_message(const message_format& message) { return strncmp(message.function_name, "LOGGER ", 7) == 0; }
+
+    // Single-producer/single-consumer ring owned by one logging thread and drained by the worker thread.
+    // The producer only writes [m_head], the consumer only writes [m_tail], so no lock is needed on either side.
+    // When the ring is full, messages go into a per-thread overflow list until the consumer caught up, this keeps the
+    // producer non-blocking and preserves the order of the thread's messages.
+    class thread_ring_buffer {
+    public:
+
+        // Moves the message into the next free slot, or into the overflow list if the ring is full.
+        // @return true if the ring overflowed and the consumer should be woken up.
+        bool push(message_format& message) {
+
+            if (!m_overflow_active.load(std::memory_order_acquire)) {
+
+                const u64 loc_head = m_head.load(std::memory_order_relaxed);
+                if (loc_head - m_tail.load(std::memory_order_acquire) < RING_BUFFER_CAPACITY) {
+
+                    m_slots[loc_head & (RING_BUFFER_CAPACITY - 1)] = std::move(message);
+                    m_head.store(loc_head + 1, std::memory_order_release);
+                    return false;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(m_overflow_mutex);           // once overflowing, every following message has to go here until drained
+            m_overflow.push_back(std::move(message));
+            m_overflow_active.store(true, std::memory_order_release);
+            return true;
+        }
+
+        // Drops the oldest log message of this thread, the newest one is kept (it is the message that was just queued).
+        // The ring is only read here, drain() skips the log messages before [m_drop_end]. Must only be called by the producer.
+        // @return false if there was nothing to drop
+        bool drop_oldest(severity& dropped_severity) {
+
+            std::lock_guard<std::mutex> lock(m_overflow_mutex);           // drain() holds it too, the published slots are stable
+
+            const u64 loc_head = m_head.load(std::memory_order_relaxed);
+            const u64 ring_end = (m_overflow.empty() && loc_head > 0) ? loc_head - 1 : loc_head;
+            for (u64 x = std::max(m_drop_end, m_tail.load(std::memory_order_relaxed)); x < ring_end; x++) {
+
+                const message_format& message = m_slots[x & (RING_BUFFER_CAPACITY - 1)];
+                if (is_control_message(message))
+                    continue;
+
+                dropped_severity = message.msg_sev;
+                m_drop_end = x + 1;
+                return true;
+            }
+
+            if (m_overflow.size() < 2)
+                return false;
+
+            for (auto it = m_overflow.begin(); it != m_overflow.end() - 1; ++it) {
+
+                if (is_control_message(*it))
+                    continue;
+
+                dropped_severity = it->msg_sev;
+                m_overflow.erase(it);
+                return true;
+            }
+            return false;
+        }
+
+        // Moves all published messages into [output]. Must only be called by the consumer.
+        void drain(std::vector<message_format>& output) {
+
+            std::lock_guard<std::mutex> lock(m_overflow_mutex);           // everything in the ring is older than the overflow content
+
+            const u64 loc_tail = m_tail.load(std::memory_order_relaxed);
+            const u64 loc_head = m_head.load(std::memory_order_acquire);
+            for (u64 x = loc_tail; x < loc_head; x++) {
+
+                message_format& message = m_slots[x & (RING_BUFFER_CAPACITY - 1)];
+                if (x < m_drop_end && !is_control_message(message))     // dropped by drop_oldest()
+                    continue;
+                output.push_back(std::move(message));
+            }
+
+            m_tail.store(loc_head, std::memory_order_release);
+
+            if (m_overflow_active.load(std::memory_order_relaxed)) {
+                std::move(m_overflow.begin(), m_overflow.end(), std::back_inserter(output));
+                m_overflow.clear();
+                m_overflow_active.store(false, std::memory_order_release);
+            }
+        }
+
+        size_t size() const { return static_cast<size_t>(m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_relaxed)); }
+
+        std::atomic<bool>                                       orphaned = false;   // set when the owning thread exited, the worker releases the ring once it is empty
+
+    private:
+
+        std::array<message_format, RING_BUFFER_CAPACITY>        m_slots{};
+        alignas(64) std::atomic<u64>                            m_head = 0;
+        alignas(64) std::atomic<u64>                            m_tail = 0;
+
+        std::mutex                                              m_overflow_mutex{};
+        std::deque<message_format>                              m_overflow{};
+        std::atomic<bool>                                       m_overflow_active = false;
+        u64                                                     m_drop_end = 0;             // log messages in the ring before it are dropped, guarded by [m_overflow_mutex]
+    };
+
+    // Thread-local owner of a ring and of the interned id of its thread. When the thread exits the id is released through the queue
+    // and the ring is marked as orphaned, so queued messages are not lost
+    struct thread_ring_buffer_handle {
+        ~thread_ring_buffer_handle();
+
+        std::shared_ptr<thread_ring_buffer>                     buffer{};
+        const std::string*                                      thread_id_name = nullptr;
     };
 
-    static std::queue<message_format>                           s_log_queue{};
-    static std::unordered_map<std::thread::id, std::string>     s_thread_labels{};
+    static std::deque<message_format>                           s_log_queue{};
     static std::mutex                                           s_queue_mutex{};
     static std::mutex                                           s_general_mutex{};
     static std::condition_variable                              s_cv{};
     static std::atomic<bool>                                    s_stop = false;
     static std::thread                                          s_worker_thread{};
 
+    static std::atomic<u64>                                     s_sequence = 0;
+    static std::atomic<bool>                                    s_ring_notified = false;
+    static std::vector<std::shared_ptr<thread_ring_buffer>>     s_ring_buffers{};
+    static std::mutex                                           s_ring_buffers_mutex{};            // only taken once per thread (registration) and by the consumer
+    static thread_local thread_ring_buffer_handle               t_ring_buffer{};
+
+    // bounded queue, see set_queue_limit()
+    static std::atomic<u64>                                     s_pending_messages = 0;             // enqueued but not collected by the worker yet
+    static std::atomic<size_t>                                  s_queue_limit = LOGGER_QUEUE_LIMIT;
+    static std::atomic<overflow_policy>                         s_overflow_policy = overflow_policy::block;
+    static std::atomic<u64>                                     s_dropped_messages[6]{};
+    static std::atomic<u64>                                     s_blocked_producers = 0;
+    static std::atomic<bool>                                    s_worker_running = false;           // producers only block while the worker can make room
+    static std::mutex                                           s_space_mutex{};
+    static std::condition_variable                              s_space_cv{};
+    static thread_local u32                                     t_sample_counter = 0;
+    static u64                                                  s_dropped_reported[6]{};            // only touched by the worker
+    static std::chrono::steady_clock::time_point                s_last_drop_report{};
+
+    // Crash ring, the last messages are copied into pre-allocated slots at the call site so a signal handler can write them
+    // without locks or allocations. Producers never wait for each other, a slot that is still written by another producer is skipped.
+    struct crash_record {
+        std::atomic<u64>                                        sequence = 0;       // 2 * index + 2 when complete, odd while a producer writes it
+        std::chrono::steady_clock::time_point                   timestamp{};
+        severity                                                msg_sev = severity::Trace;
+        const char*                                             file_name = "";
+        int                                                     line = 0;
+        char                                                    thread_name[CRASH_THREAD_NAME_SIZE];        // copied, the interned name can be released
+        u32                                                     thread_name_length = 0;
+        u32                                                     length = 0;
+        char                                                    text[LOGGER_CRASH_RECORD_SIZE];
+    };
+#if LOGGER_CRASH_RING_SIZE > 0
+    static crash_record                                         s_crash_ring[LOGGER_CRASH_RING_SIZE]{};
+    static std::atomic<u64>                                     s_crash_ring_head = 0;
+#endif
+    static char                                                 s_crash_log_path[4096]{};           // main log file, opened with open() by dump_crash_ring()
+
+    // Wall-clock reference for the monotonic message timestamps, refreshed by the worker before every batch
+    static std::chrono::steady_clock::time_point                s_clock_anchor_steady = std::chrono::steady_clock::now();
+    static std::chrono::system_clock::time_point                s_clock_anchor_system = std::chrono::system_clock::now();
+    static std::time_t                                          s_cached_second = -1;               // localtime() is only called when the second changes
+    static system_time                                          s_cached_time{};
+
+    void update_clock_anchor();
+    void enqueue_message(message_format&& message, bool notify);
+    bool admit_message(const severity msg_sev, bool& drop_oldest);
+    void drop_oldest_message();
+    void report_dropped_messages(const bool force);
+    void collect_messages(std::vector<message_format>& output);
     void process_log_message(const message_format&& message);
+    void process_message(message_format&& message);
+    void format_deferred_message(message_format& message);
     void process_queue();
+    void record_for_crash(const message_format& message, const std::string_view text);
+
+
+    // Returns the stored copy of [name] and counts the owning thread, a [pinned] name is never released.
+    // The caller has to hold [s_thread_names_mutex].
+    const std::string* intern_thread_name(const std::string& name, const bool pinned) {
+
+        auto& [stored_name, owners] = *s_interned_thread_names.try_emplace(name, 0).first;
+        if (pinned)
+            owners = pinned_thread_name;
+        else if (owners != pinned_thread_name)
+            owners++;
+        return &stored_name;
+    }
+
+
+    // Called by the worker for LOGGER_RELEASE_THREAD_NAME, every message that could point to [name] is processed
+    void release_thread_name(const std::string* name) {
+
+        std::lock_guard<std::mutex> lock(s_thread_names_mutex);
+        const auto entry = s_interned_thread_names.find(*name);
+        if (entry != s_interned_thread_names.end() && entry->second != pinned_thread_name && --entry->second == 0)
+            s_interned_thread_names.erase(entry);
+    }
+
+
+    // Returns the label of [thread_id] or its id as text, the calling thread only takes a lock when its label changed since the last call
+    const std::string* get_thread_name(const std::thread::id thread_id) {
+
+        const bool is_calling_thread = (thread_id == std::this_thread::get_id());
+        const u64 labels_version = s_thread_labels_version.load(std::memory_order_acquire);
+        if (is_calling_thread && t_thread_name && t_thread_labels_version == labels_version)
+            return t_thread_name;
+
+        std::lock_guard<std::mutex> lock(s_thread_names_mutex);
+        const auto label = s_thread_labels.find(thread_id);
+        const std::string* name = nullptr;
+        if (label != s_thread_labels.end())
+            name = label->second;
+        else if (is_calling_thread && t_ring_buffer.thread_id_name)
+            name = t_ring_buffer.thread_id_name;
+        else {
+            std::ostringstream oss{};
+            oss << thread_id;
+            name = intern_thread_name(oss.str(), !is_calling_thread);
+            if (is_calling_thread)
+                t_ring_buffer.thread_id_name = name;
+        }
+
+        if (is_calling_thread) {
+            t_thread_name = name;
+            t_thread_labels_version = labels_version;
+        }
+        return name;
+    }
 
 
     inline const char* get_filename(const char* filepath) {
@@ -105,32 +891,44 @@ namespace AT::logger {
 
         s_format_current = format;
         s_format_prev = format;
-        s_write_log_to_console = log_to_console;
+        s_format_program = compile_format(format);
 
         s_main_log_dir = std::filesystem::absolute(log_dir);
         s_main_log_file_path = s_main_log_dir / main_log_file_name;
 
+        const std::string crash_log_path = s_main_log_file_path.string();
+        if (crash_log_path.size() < sizeof(s_crash_log_path))
+            std::memcpy(s_crash_log_path, crash_log_path.c_str(), crash_log_path.size() + 1);
+
         if (!std::filesystem::is_directory(s_main_log_dir))
             if (!std::filesystem::create_directory(s_main_log_dir)) {
                 std::cerr << "Failed to create the directory for log files" << std::endl;
                 std::quick_exit(1);
             }
 
-        s_main_file = std::ofstream(s_main_log_file_path, (use_append_mode) ? std::ios::app : std::ios::out);
-        if (!s_main_file.is_open()) {
+        if (!s_main_file.open(s_main_log_file_path, use_append_mode)) {
             std::cerr << "Failed to open main log file path: [" << s_main_log_file_path << "]" << std::endl;
             std::quick_exit(1);
         }
-        s_main_file << "\n================================================================================================\n";
+
         auto now = std::time(nullptr);
         auto tm = *std::localtime(&now);
-        s_main_file << "Log initalized at [" << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << "]\n";
-        s_main_file << "------------------------------------------------------------------------------------------------\n";
-        CLOSE_FILE
-
-        s_buffered_messages.reserve(s_buffer_size);
-
+        WRITE_TO_FILE("\n================================================================================================\n"
+            << "Log initalized at [" << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << "]\n"
+            << "------------------------------------------------------------------------------------------------\n");
+        s_main_file.flush();
+
+        update_clock_anchor();
+        s_cached_second = -1;
+        s_stop = false;
         s_is_init = true;
+        s_last_drop_report = std::chrono::steady_clock::now();
+        s_worker_running.store(true, std::memory_order_release);
+
+        if (log_to_console) {                                                                                 // a slow terminal should not stall the log file
+            auto console = std::make_shared<console_sink>();
+            s_sinks.push_back({ console, std::make_unique<sink_worker>(console) });
+        }
 
         s_worker_thread = std::thread(&process_queue);                                                        // start after inital write to avoid using mutex
 
@@ -145,35 +943,41 @@ namespace AT::logger {
             std::quick_exit(1);
         }
 
+        s_worker_running.store(false, std::memory_order_release);
+        s_space_cv.notify_all();                                                                        // release blocked producers, the queue is drained below
         s_stop = true;
         s_cv.notify_all();
         if (s_worker_thread.joinable())
             s_worker_thread.join();
 
         // Process any remaining messages in the queue after worker thread has stopped
-        std::queue<message_format> remaining_messages;
-        {
-            std::lock_guard<std::mutex> lock(s_queue_mutex);
-            remaining_messages = std::move(s_log_queue); // Take all remaining messages
-        }
+        std::vector<message_format> remaining_messages;
+        collect_messages(remaining_messages);
+        for (auto& message : remaining_messages)
+            process_message(std::move(message));
+
+        report_dropped_messages(true);
 
-        while (!remaining_messages.empty()) {
-            message_format msg = std::move(remaining_messages.front());
-            remaining_messages.pop();
-            process_log_message(std::move(msg)); // Process each message
+        for (auto& slot : s_sinks) {                                                                    // write everything that is still queued for the sinks
+            if (slot.worker)
+                slot.worker->stop();
+            else
+                slot.target->flush();
         }
+        s_sinks.clear();
 
-        if ( !s_buffered_messages.empty()) {
-            
-            auto now = std::time(nullptr);
-            auto tm = *std::localtime(&now);
-            
-            OPEN_FILE
-            s_main_file << s_buffered_messages;
-            s_main_file << "------------------------------------------------------------------------------------------------\n";
-            s_main_file << "Log shutdown at [" << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << "]\n";
-            s_main_file << "================================================================================================\n";
-            CLOSE_FILE
+        const file_sink_stats stats = s_main_file.get_stats();
+        auto now = std::time(nullptr);
+        auto tm = *std::localtime(&now);
+        WRITE_TO_FILE("------------------------------------------------------------------------------------------------\n"
+            << "[LOGGER] file writes: [" << stats.write_calls << "] for [" << stats.messages_written << "] messages, syscalls avoided: [" << stats.syscalls_avoided << "]\n"
+            << "Log shutdown at [" << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << "]\n"
+            << "================================================================================================\n");
+        s_main_file.close();
+        s_segment_compressor.stop();                                                                    // finish compressing rotated segments
+        if (s_structured_file) {
+            s_structured_file->close();
+            s_structured_file.reset();
         }
 
         s_is_init = false;
@@ -193,28 +997,36 @@ namespace AT::logger {
             return;
         }
         
-        std::lock_guard<std::mutex> lock(s_queue_mutex);
-        s_log_queue.emplace(severity::Trace, "", LOGGER_UPDATE_FORMAT, 0, std::thread::id(), new_format.c_str());
-        s_cv.notify_all();
+        enqueue_message(message_format(severity::Trace, "", LOGGER_UPDATE_FORMAT, 0, std::thread::id(), new_format.c_str()), true);
     }
 
 
     void use_previous_format() {
         
-        std::lock_guard<std::mutex> lock(s_queue_mutex);
-        s_log_queue.emplace(severity::Trace, "", LOGGER_REVERSE_FORMAT, 0, std::thread::id(), "");
-        s_cv.notify_all();
+        enqueue_message(message_format(severity::Trace, "", LOGGER_REVERSE_FORMAT, 0, std::thread::id(), ""), true);
     }
 
 
     const std::string get_format() { return s_format_current; }
 
 
+    // Labels take effect immediately for messages logged afterwards, only the note in the log file goes through the queue
     void register_label_for_thread(const std::string& thread_label, std::thread::id thread_id) {
 
-        std::lock_guard<std::mutex> lock(s_queue_mutex);
-        s_log_queue.emplace(severity::Trace, "", LOGGER_REGISTER_THREAD_LABEL, 0, thread_id, thread_label);
-        s_cv.notify_all();
+        std::ostringstream loc_oss{};
+        {
+            std::lock_guard<std::mutex> lock(s_thread_names_mutex);
+            const auto existing = s_thread_labels.find(thread_id);
+            if (existing != s_thread_labels.end())
+                loc_oss << "[LOGGER] Thread with ID: [" << thread_id << "] already has label [" << *existing->second << "] registered. Overriding with the label: [" << thread_label << "]";
+            else
+                loc_oss << "[LOGGER] Registering Thread-ID: [" << thread_id << "] with the label: [" << thread_label << "]";
+
+            s_thread_labels[thread_id] = intern_thread_name(thread_label, true);
+            s_thread_labels_version.fetch_add(1, std::memory_order_release);
+        }
+
+        enqueue_message(message_format(severity::Trace, "", LOGGER_REGISTER_THREAD_LABEL, 0, thread_id, std::move(loc_oss.str())), true);
     }
 
 
@@ -222,220 +1034,1012 @@ namespace AT::logger {
 
         std::ostringstream loc_oss{};
         {
-            std::lock_guard<std::mutex> lock(s_general_mutex);
-            if (s_thread_labels.find(thread_id) == s_thread_labels.end())
+            std::lock_guard<std::mutex> lock(s_thread_names_mutex);
+            if (s_thread_labels.erase(thread_id) == 0)
                 loc_oss << "[LOGGER] Tried to unregister label for unknown thread with ID: [" << thread_id << "]. IGNORED";
+            else
+                s_thread_labels_version.fetch_add(1, std::memory_order_release);
         }
 
-        std::lock_guard<std::mutex> lock(s_queue_mutex);
-        s_log_queue.emplace(severity::Trace, "", LOGGER_UNREGISTER_THREAD_LABEL, 0, thread_id, std::move(loc_oss.str()));
-        s_cv.notify_all();
+        enqueue_message(message_format(severity::Trace, "", LOGGER_UNREGISTER_THREAD_LABEL, 0, thread_id, std::move(loc_oss.str())), true);
     }
 
 
     void set_buffer_threshold(const severity new_threshold) {
 
-        std::lock_guard<std::mutex> lock(s_queue_mutex);
-        s_log_queue.emplace(new_threshold, "", LOGGER_CHANGE_THRESHOLD, 0, std::thread::id(), "[LOGGER] Changed buffering threshold to [" + severity_names[static_cast<u8>(s_severity_level_buffering_threshold)] + "]");
-        s_cv.notify_all();
+        enqueue_message(message_format(new_threshold, "", LOGGER_CHANGE_THRESHOLD, 0, std::thread::id(), "[LOGGER] Changed buffering threshold to [" + severity_names[static_cast<u8>(new_threshold)] + "]"), true);
     }
 
 
     void set_buffer_size(const size_t new_size) {
 
-        std::lock_guard<std::mutex> lock(s_queue_mutex);
-        s_log_queue.emplace(severity::Trace, "", LOGGER_CHANGE_BUFFER_SIZE, static_cast<int>(new_size), std::thread::id(), "[LOGGER] Changed buffer size to [" + std::to_string(new_size) + "]");
-        s_cv.notify_all();
+        enqueue_message(message_format(severity::Trace, "", LOGGER_CHANGE_BUFFER_SIZE, static_cast<int>(new_size), std::thread::id(), "[LOGGER] Changed buffer size to [" + std::to_string(new_size) + "]"), true);
     }
 
 
-    // ========================================================================================================================
-    // message queue
-    // ========================================================================================================================
+    void set_flush_interval(const std::chrono::milliseconds interval) {
 
-    void process_queue() {
+        enqueue_message(message_format(severity::Trace, "", LOGGER_CHANGE_FLUSH_INTERVAL, static_cast<int>(interval.count()), std::thread::id(), "[LOGGER] Changed flush interval to [" + std::to_string(interval.count()) + " ms]"), true);
+    }
 
-        std::unique_lock<std::mutex> lock(s_queue_mutex);
-        while (!s_stop) {
 
-            s_cv.wait_for(lock, std::chrono::milliseconds(100), [] { return !s_log_queue.empty() || s_stop; });
-            
-            if (s_stop) break;
-        
+    file_sink_stats get_file_sink_stats() { return s_main_file.get_stats(); }
 
-            std::queue<message_format> local_queue;
-            while (!s_log_queue.empty()) {                                    // Move all current messages to a local queue
-                local_queue.push(std::move(s_log_queue.front()));
-                s_log_queue.pop();
-            }
-            lock.unlock();                                                  // Unlock while processing messages
 
-            // Process each message from the local queue
-            while (!local_queue.empty()) {
-                message_format message = std::move(local_queue.front());
-                local_queue.pop();
-                // Process control messages and log messages
+    void set_rotation(const rotation_settings& settings) {
+
+        {
+            std::lock_guard<std::mutex> lock(s_general_mutex);
+            s_pending_rotations.push_back(settings);
+        }
 
-                if (strcmp(message.function_name, LOGGER_UPDATE_FORMAT) == 0) {
+        std::ostringstream loc_oss{};
+        loc_oss << "[LOGGER] Changed rotation to max size [" << settings.max_file_size << " bytes], interval [" << settings.interval.count() << " s], retention [" << settings.retention_count << "], compression [" << (settings.compress ? "true" : "false") << "]";
+        enqueue_message(message_format(severity::Trace, "", LOGGER_CHANGE_ROTATION, 0, std::thread::id(), loc_oss.str()), true);
+    }
 
-                    std::lock_guard<std::mutex> lock(s_general_mutex);
-                    s_format_prev = s_format_current;
-                    s_format_current = static_cast<std::string>(message.message);
 
-                    WRITE_TO_FILE("[LOGGER] Changing log-format. From [" << s_format_prev << "] to [" << s_format_current << "]\n");
-                
-                } else if (strcmp(message.function_name, LOGGER_REVERSE_FORMAT) == 0) {
-                    
-                    std::lock_guard<std::mutex> lock(s_general_mutex);
-                    const std::string buffer = s_format_current;
-                    s_format_current = s_format_prev;
-                    s_format_prev = buffer;
+    bool open_structured_sink(const std::filesystem::path& path, const structured_format format, const bool use_append_mode) {
 
-                } else if (strcmp(message.function_name, LOGGER_CHANGE_THRESHOLD) == 0) {
+        if (!s_is_init) {
+            std::cerr << "Tried to open a structured log sink befor logger was initalized" << std::endl;
+            return false;
+        }
 
-                    std::lock_guard<std::mutex> lock(s_general_mutex);
-                    s_severity_level_buffering_threshold = static_cast<severity>(std::min(static_cast<u8>(message.msg_sev), static_cast<u8>(severity::Error)));   
+        std::error_code error{};
+        if (path.has_parent_path())
+            std::filesystem::create_directories(path.parent_path(), error);
 
-                }
-                else if (strcmp(message.function_name, LOGGER_CHANGE_BUFFER_SIZE) == 0) {
-
-                    std::lock_guard<std::mutex> lock(s_general_mutex);
-                    s_buffer_size = static_cast<size_t>(message.line);
-
-                    OPEN_FILE
-                    s_main_file << message.message;                    
-                    if (s_is_init && s_buffered_messages.size() >= s_buffer_size) {                   // Handle buffer overflow if the new size is smaller than the current buffer content
-                        
-                        s_main_file << s_buffered_messages;
-                        // if (s_write_log_to_console)
-                        // std::cout << s_buffered_messages;
-                        
-                        s_buffered_messages.clear();
-                    }
-                    CLOSE_FILE
-                
-                    s_buffered_messages.shrink_to_fit();
-                    s_buffered_messages.reserve(s_buffer_size);
-                
-                } else if (strcmp(message.function_name, LOGGER_REGISTER_THREAD_LABEL) == 0) {            // process_reverse_in_msg_format();
-
-                    std::lock_guard<std::mutex> lock(s_general_mutex);
-                    
-                    if (s_thread_labels.find(message.thread_id) != s_thread_labels.end())
-                    WRITE_TO_FILE("[LOGGER] Thread with ID: [" << message.thread_id << "] already has label [" << s_thread_labels[message.thread_id] << "] registered. Overriding with the label: [" << message.message << "]\n")
-                    else
-                    WRITE_TO_FILE("[LOGGER] Registering Thread-ID: [" << message.thread_id << "] with the label: [" << message.message << "]\n")
-
-                    s_thread_labels[message.thread_id] = message.message;
-                
-                } else if (strcmp(message.function_name, LOGGER_UNREGISTER_THREAD_LABEL) == 0) {
-
-                    std::lock_guard<std::mutex> lock(s_general_mutex);
-                    s_thread_labels.erase(message.thread_id);
-                }
+        const bool is_empty = !std::filesystem::exists(path, error) || std::filesystem::file_size(path, error) == 0;
+        auto sink = std::make_unique<log_file>();
+        if (!sink->open(path, use_append_mode))
+            return false;
 
-                else
-                    process_log_message(std::move(message));
-            }
+        if (format == structured_format::binary && (!use_append_mode || is_empty)) {            // the stream is opened by the calling thread, the worker only sees it after the control message
+            std::string header(structured_log_magic, sizeof(structured_log_magic));
+            header.append(reinterpret_cast<const char*>(&structured_log_version), sizeof(structured_log_version));
+            sink->write(header, true);
+        }
 
-            // Re-lock before next iteration
-            lock.lock();
+        {
+            std::lock_guard<std::mutex> lock(s_general_mutex);
+            s_pending_structured_sinks.push_back({ std::move(sink), format });
         }
+
+        const char* format_name = (format == structured_format::binary) ? "binary" : "json lines";
+        enqueue_message(message_format(severity::Trace, "", LOGGER_CHANGE_STRUCTURED_SINK, 0, std::thread::id(), "[LOGGER] Opened structured log [" + path.generic_string() + "] (" + format_name + ")"), true);
+        return true;
     }
 
 
-    // ========================================================================================================================
-    // handle message
-    // ========================================================================================================================
+    void add_sink(std::shared_ptr<sink> new_sink, const bool use_own_thread) {
 
-    void log_msg(const severity msg_sev, const char* file_name, const char* function_name, const int line, std::thread::id thread_id, std::string&& message) {
+        if (!s_is_init) {
+            std::cerr << "Tried to add a log sink befor logger was initalized" << std::endl;
+            return;
+        }
 
-        if (message.empty())
+        {
+            std::lock_guard<std::mutex> lock(s_general_mutex);
+            s_pending_sink_changes.push_back({ std::move(new_sink), use_own_thread, false });
+        }
+
+        enqueue_message(message_format(severity::Trace, "", LOGGER_CHANGE_SINKS, 0, std::thread::id(), ""), true);
+    }
+
+
+    void remove_sink(const std::shared_ptr<sink>& existing_sink) {
+
+        if (!s_is_init)
             return;
 
+        {
+            std::lock_guard<std::mutex> lock(s_general_mutex);
+            s_pending_sink_changes.push_back({ existing_sink, false, true });
+        }
+
+        enqueue_message(message_format(severity::Trace, "", LOGGER_CHANGE_SINKS, 0, std::thread::id(), ""), true);
+    }
+
+
+    void close_structured_sink() {
+
+        {
+            std::lock_guard<std::mutex> lock(s_general_mutex);
+            s_pending_structured_sinks.push_back({});
+        }
+
+        enqueue_message(message_format(severity::Trace, "", LOGGER_CHANGE_STRUCTURED_SINK, 0, std::thread::id(), "[LOGGER] Closed structured log"), true);
+    }
+
+
+    void set_queue_limit(const size_t max_messages, const overflow_policy policy) {
+
+        s_overflow_policy.store(policy, std::memory_order_relaxed);
+        s_queue_limit.store(max_messages, std::memory_order_relaxed);
+        s_space_cv.notify_all();                                                                        // blocked producers might be allowed to continue
+    }
+
+
+    queue_stats get_queue_stats() {
+
+        queue_stats stats{};
+        stats.pending = s_pending_messages.load(std::memory_order_relaxed);
+        for (u8 x = 0; x < 6; x++)
+            stats.dropped[x] = s_dropped_messages[x].load(std::memory_order_relaxed);
+
+        stats.blocked = s_blocked_producers.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+
+    void set_category_level(const category log_category, const severity new_level) {
+
+        const severity level = static_cast<severity>(std::min(static_cast<u8>(new_level), static_cast<u8>(severity::Error)));      // Error and Fatal are always logged
+        g_category_levels[static_cast<u8>(log_category)].store(level, std::memory_order_relaxed);
+    }
+
+
+    severity get_category_level(const category log_category) { return g_category_levels[static_cast<u8>(log_category)].load(std::memory_order_relaxed); }
+
+
+    // ========================================================================================================================
+    // message queue
+    // ========================================================================================================================
+
+    // Queued behind the last message of the thread, so the worker releases the name once nothing can point to it anymore
+    thread_ring_buffer_handle::~thread_ring_buffer_handle() {
+
+        if (thread_id_name) {
+            message_format message(severity::Trace, "", LOGGER_RELEASE_THREAD_NAME, 0, std::this_thread::get_id(), "");
+            message.thread_name = thread_id_name;
+            enqueue_message(std::move(message), false);
+        }
+
+        if (buffer)
+            buffer->orphaned.store(true, std::memory_order_release);
+    }
+
+
+    void enqueue_message(message_format&& message, bool notify) {
+
+#if LOGGER_USE_THREAD_RING_BUFFERS
+        if (!t_ring_buffer.buffer) {                                        // first message of this thread => register its ring with the consumer
+            t_ring_buffer.buffer = std::make_shared<thread_ring_buffer>();
+            std::lock_guard<std::mutex> lock(s_ring_buffers_mutex);
+            s_ring_buffers.push_back(t_ring_buffer.buffer);
+        }
+
+        s_pending_messages.fetch_add(1, std::memory_order_relaxed);
+        message.sequence = s_sequence.fetch_add(1, std::memory_order_relaxed);
+        if (t_ring_buffer.buffer->push(message))                            // ring is full => wake the worker instead of blocking the caller
+            notify = true;
+
+        if (notify || t_ring_buffer.buffer->size() >= QUEUE_MAX_SIZE) {
+            s_ring_notified.store(true, std::memory_order_release);
+            s_cv.notify_all();
+        }
+#else
         std::lock_guard<std::mutex> lock(s_queue_mutex);
-        s_log_queue.emplace(msg_sev, file_name, function_name, line, thread_id, message);
+        s_pending_messages.fetch_add(1, std::memory_order_relaxed);
+        message.sequence = s_sequence.fetch_add(1, std::memory_order_relaxed);
+        s_log_queue.push_back(std::move(message));
 
-        if (static_cast<u8>(msg_sev) >= static_cast<u8>(s_severity_level_buffering_threshold) || s_log_queue.size() >= QUEUE_MAX_SIZE)           // check if thread should be notified
+        if (notify || s_log_queue.size() >= QUEUE_MAX_SIZE)                 // check if thread should be notified
             s_cv.notify_all();
+#endif
     }
 
 
-    void process_log_message(const message_format&& message) {
+    // Moves every pending message into [output], ordered by their sequence number.
+    void collect_messages(std::vector<message_format>& output) {
 
-    #define SHORTEN_FUNC_NAME(text)                                 (strstr(text, "::") ? strstr(text, "::") + 2 : text)
+#if LOGGER_USE_THREAD_RING_BUFFERS
+        {
+            std::lock_guard<std::mutex> lock(s_ring_buffers_mutex);
+            for (auto it = s_ring_buffers.begin(); it != s_ring_buffers.end(); ) {
 
-        // create helper vars
-        std::ostringstream format_filled{};
-        format_filled.flush();
-        char format_command{};
-        system_time loc_sys_time = util::get_system_time();
+                const bool orphaned = (*it)->orphaned.load(std::memory_order_acquire);
+                (*it)->drain(output);
+                if (orphaned)                                               // owning thread is gone and will never push again
+                    it = s_ring_buffers.erase(it);
+                else
+                    ++it;
+            }
+        }
 
-        // loop over format string and build final message
-        std::unique_lock<std::mutex> lock(s_general_mutex);
-        int format_length = static_cast<int>(s_format_current.length());
-        for (int x = 0; x < format_length; x++) {
-
-            if (s_format_current[x] == '$' && x+1 < format_length) {          // detected a format specifier prefix
-
-                format_command = s_format_current[x + 1];
-                switch (format_command) {
-
-                // ------------------------ Basic info ------------------------
-                case 'B': format_filled << console_color_table[(u8)message.msg_sev]; break;                                             // Color start
-                case 'E': format_filled << console_rest; break;                                                                         // Color end
-                case 'C': format_filled << message.message; break;                                                                      // input text (message)
-                case 'L': format_filled << severity_names[(u8)message.msg_sev]; break;                                                  // log severity
-                case 'X': if(message.msg_sev == severity::Info || message.msg_sev == severity::Warn) {format_filled << " "; } break;    // alignment
-                case 'Z': format_filled << "\n"; break;                                                                                 // line brake
-                
-                // ------------------------ Basic info ------------------------
-                case 'Q':   if (s_thread_labels.find(message.thread_id) != s_thread_labels.end()) {format_filled << s_thread_labels[message.thread_id]; } 
-                            else { format_filled << message.thread_id; } break;                                                         // Thread id or associated label
-                case 'F': format_filled << message.function_name; break;                                                                // function name
-                case 'P': format_filled << SHORTEN_FUNC_NAME(message.function_name); break;                                             // short function name
-                case 'A': format_filled << message.file_name; break;                                                                    // file name
-                case 'I': format_filled << get_filename(message.file_name); break;                                                      // short file name
-                case 'G': format_filled << message.line; break;                                                                         // line
-                
-                // ------------------------ time ------------------------
-                case 'T': format_filled << SETW(2) << (u16)loc_sys_time.hour << ":" << SETW(2) << (u16)loc_sys_time.minute << ":" << SETW(2) << (u16)loc_sys_time.secund; break;    // formatted time
-                case 'H': format_filled << SETW(2) << (u16)loc_sys_time.hour; break;                                                                                                // hour
-                case 'M': format_filled << SETW(2) << (u16)loc_sys_time.minute; break;                                                                                              // minute
-                case 'S': format_filled << SETW(2) << (u16)loc_sys_time.secund; break;                                                                                              // second
-                case 'J': format_filled << SETW(3) << (u16)loc_sys_time.millisecend; break;                                                                                         // miliseconds
-
-                // ------------------------ data ------------------------
-                case 'N': format_filled << SETW(4) << (u16)loc_sys_time.year << "/" << SETW(2) << (u16)loc_sys_time.month << "/" << SETW(2) << (u16)loc_sys_time.day; break;        // data yy/mm/dd
-                case 'Y': format_filled << SETW(4) << (u16)loc_sys_time.year; break;                                                                                                // year
-                case 'O': format_filled << SETW(2) << (u16)loc_sys_time.month; break;                                                                                               // month
-                case 'D': format_filled << SETW(2) << (u16)loc_sys_time.day; break;                                                                                                 // day
-
-                default: break;
+        std::sort(output.begin(), output.end(), [](const message_format& a, const message_format& b) { return a.sequence < b.sequence; });
+#else
+        {
+            std::lock_guard<std::mutex> lock(s_queue_mutex);
+            std::move(s_log_queue.begin(), s_log_queue.end(), std::back_inserter(output));
+            s_log_queue.clear();
+        }
+#endif
+
+        s_pending_messages.fetch_sub(output.size(), std::memory_order_relaxed);
+        s_space_cv.notify_all();
+    }
+
+
+    // Applies the overflow policy before a message is queued, Error and Fatal are never dropped or blocked
+    // @param drop_oldest set if the caller has to drop its oldest queued message after queuing the new one
+    // @return false if the new message has to be dropped
+    bool admit_message(const severity msg_sev, bool& drop_oldest) {
+
+        drop_oldest = false;
+        const size_t limit = s_queue_limit.load(std::memory_order_relaxed);
+        if (limit == 0 || static_cast<u8>(msg_sev) >= static_cast<u8>(severity::Error))
+            return true;
+
+        const u64 pending = s_pending_messages.load(std::memory_order_relaxed);
+        switch (s_overflow_policy.load(std::memory_order_relaxed)) {
+
+            case overflow_policy::block:
+                if (pending >= limit && s_worker_running.load(std::memory_order_acquire)) {
+
+                    s_blocked_producers.fetch_add(1, std::memory_order_relaxed);
+                    s_ring_notified.store(true, std::memory_order_release);
+                    s_cv.notify_all();
+
+                    std::unique_lock<std::mutex> lock(s_space_mutex);
+                    while (s_pending_messages.load(std::memory_order_relaxed) >= s_queue_limit.load(std::memory_order_relaxed) && s_worker_running.load(std::memory_order_acquire))
+                        s_space_cv.wait_for(lock, std::chrono::milliseconds(10));
                 }
+                return true;
+
+            case overflow_policy::drop_oldest:
+                drop_oldest = (pending >= limit);
+                return true;
+
+            case overflow_policy::sample:
+                if (pending < limit - limit / 4)
+                    return true;
+                if (pending < limit && (t_sample_counter++ % LOGGER_SAMPLE_RATE) == 0)              // under pressure only every n-th message is kept
+                    return true;
+                break;
+
+            case overflow_policy::drop_newest:
+                if (pending < limit)
+                    return true;
+                break;
+        }
+
+        s_dropped_messages[static_cast<u8>(msg_sev)].fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+
+    void drop_oldest_message() {
+
+        severity dropped_severity = severity::Trace;
+#if LOGGER_USE_THREAD_RING_BUFFERS
+        if (!t_ring_buffer.buffer || !t_ring_buffer.buffer->drop_oldest(dropped_severity))
+            return;
+#else
+        {
+            std::lock_guard<std::mutex> lock(s_queue_mutex);
+            if (s_log_queue.size() < 2)                                     // never drop the message that was just queued
+                return;
+
+            const auto oldest = std::find_if(s_log_queue.begin(), s_log_queue.end() - 1, [](const message_format& message) { return !is_control_message(message); });
+            if (oldest == s_log_queue.end() - 1)
+                return;
+
+            dropped_severity = oldest->msg_sev;
+            s_log_queue.erase(oldest);
+        }
+#endif
+        s_pending_messages.fetch_sub(1, std::memory_order_relaxed);
+        s_dropped_messages[static_cast<u8>(dropped_severity)].fetch_add(1, std::memory_order_relaxed);
+    }
+
 
-                x++;
+    // Writes the number of messages dropped since the last report, at most once per DROP_REPORT_INTERVAL unless [force] is set
+    void report_dropped_messages(const bool force) {
+
+        const auto now = std::chrono::steady_clock::now();
+        if (!force && now - s_last_drop_report < DROP_REPORT_INTERVAL)
+            return;
+
+        s_last_drop_report = now;
+        std::ostringstream dropped_counts{};
+        for (u8 x = 0; x < 6; x++) {
+
+            const u64 dropped = s_dropped_messages[x].load(std::memory_order_relaxed) - s_dropped_reported[x];
+            if (dropped == 0)
+                continue;
+
+            dropped_counts << " " << severity_names[x] << " [" << dropped << "]";
+            s_dropped_reported[x] += dropped;
+        }
+
+        if (!dropped_counts.str().empty())
+            WRITE_TO_FILE("[LOGGER] Queue limit reached, dropped messages:" << dropped_counts.str() << "\n");
+    }
+
+
+    void update_clock_anchor() {
+
+        s_clock_anchor_steady = std::chrono::steady_clock::now();
+        s_clock_anchor_system = std::chrono::system_clock::now();
+    }
+
+
+    // Converts a call-site timestamp to local time, only touched by the worker (and init/shutdown while the worker is not running)
+    system_time to_system_time(const std::chrono::steady_clock::time_point timestamp) {
+
+        const auto wall_time = s_clock_anchor_system + std::chrono::duration_cast<std::chrono::system_clock::duration>(timestamp - s_clock_anchor_steady);
+        const int64 milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(wall_time.time_since_epoch()).count();
+        const std::time_t seconds = static_cast<std::time_t>(milliseconds / 1000);
+
+        if (seconds != s_cached_second) {
+
+            std::tm loc_tm{};
+#if defined(PLATFORM_WINDOWS)
+            localtime_s(&loc_tm, &seconds);
+#else
+            localtime_r(&seconds, &loc_tm);
+#endif
+            s_cached_time.year = static_cast<u16>(loc_tm.tm_year + 1900);
+            s_cached_time.month = static_cast<u8>(loc_tm.tm_mon + 1);
+            s_cached_time.day = static_cast<u8>(loc_tm.tm_mday);
+            s_cached_time.day_of_week = static_cast<u8>(loc_tm.tm_wday);
+            s_cached_time.hour = static_cast<u8>(loc_tm.tm_hour);
+            s_cached_time.minute = static_cast<u8>(loc_tm.tm_min);
+            s_cached_time.secund = static_cast<u8>(loc_tm.tm_sec);
+            s_cached_second = seconds;
+        }
+
+        system_time loc_system_time = s_cached_time;
+        loc_system_time.millisecend = static_cast<u16>(milliseconds % 1000);
+        return loc_system_time;
+    }
+
+
+    void process_queue() {
+
+        std::vector<message_format> local_messages;
+        std::unique_lock<std::mutex> lock(s_queue_mutex);
+        while (!s_stop) {
+
+            s_cv.wait_for(lock, std::chrono::milliseconds(100), [] { return !s_log_queue.empty() || s_ring_notified.load(std::memory_order_acquire) || s_stop; });
+            
+            if (s_stop) break;
+        
+            lock.unlock();                                                  // Unlock while processing messages
+            s_ring_notified.store(false, std::memory_order_relaxed);
+
+            collect_messages(local_messages);
+            update_clock_anchor();                                          // keeps up with adjustments of the system clock
+            for (auto& message : local_messages)
+                process_message(std::move(message));
+
+            local_messages.clear();
+            report_dropped_messages(false);
+            s_main_file.flush_if_older_than(s_flush_interval);
+            s_main_file.rotate_if_due();
+            for (auto& slot : s_sinks)                                      // sinks with an own thread flush after their own batches
+                if (!slot.worker)
+                    slot.target->flush();
+            {
+                std::lock_guard<std::mutex> structured_lock(s_general_mutex);
+                if (s_structured_file)
+                    s_structured_file->flush_if_older_than(s_flush_interval);
             }
+
+            // Re-lock before next iteration
+            lock.lock();
+        }
+    }
+
+
+    // Process control messages and log messages
+    void process_message(message_format&& message) {
+
+        if (strcmp(message.function_name, LOGGER_UPDATE_FORMAT) == 0) {
+
+            std::lock_guard<std::mutex> lock(s_general_mutex);
+            s_format_prev = s_format_current;
+            s_format_current = static_cast<std::string>(message.message);
+            s_format_program = compile_format(s_format_current);
+
+            WRITE_TO_FILE("[LOGGER] Changing log-format. From [" << s_format_prev << "] to [" << s_format_current << "]\n");
+        
+        } else if (strcmp(message.function_name, LOGGER_REVERSE_FORMAT) == 0) {
             
+            std::lock_guard<std::mutex> lock(s_general_mutex);
+            const std::string buffer = s_format_current;
+            s_format_current = s_format_prev;
+            s_format_prev = buffer;
+            s_format_program = compile_format(s_format_current);
+
+        } else if (strcmp(message.function_name, LOGGER_CHANGE_THRESHOLD) == 0) {
+
+            std::lock_guard<std::mutex> lock(s_general_mutex);
+            s_severity_level_buffering_threshold = static_cast<severity>(std::min(static_cast<u8>(message.msg_sev), static_cast<u8>(severity::Error)));   
+
+        }
+        else if (strcmp(message.function_name, LOGGER_CHANGE_BUFFER_SIZE) == 0) {
+
+            std::lock_guard<std::mutex> lock(s_general_mutex);
+            WRITE_TO_FILE(message.message << "\n");
+            s_main_file.set_capacity(static_cast<size_t>(message.line));
+            if (s_structured_file)
+                s_structured_file->set_capacity(static_cast<size_t>(message.line));
+
+        } else if (strcmp(message.function_name, LOGGER_CHANGE_ROTATION) == 0) {
+
+            std::lock_guard<std::mutex> lock(s_general_mutex);
+            s_main_file.set_rotation(s_pending_rotations.front());
+            s_pending_rotations.pop_front();
+            WRITE_TO_FILE(message.message << "\n");
+
+        } else if (strcmp(message.function_name, LOGGER_CHANGE_STRUCTURED_SINK) == 0) {
+
+            std::lock_guard<std::mutex> lock(s_general_mutex);
+            if (s_structured_file)
+                s_structured_file->close();
+
+            s_structured_file = std::move(s_pending_structured_sinks.front().sink);
+            s_structured_format = s_pending_structured_sinks.front().format;
+            s_pending_structured_sinks.pop_front();
+            if (s_structured_file)
+                s_structured_file->set_capacity(s_main_file.get_capacity());
+
+            WRITE_TO_FILE(message.message << "\n");
+
+        } else if (strcmp(message.function_name, LOGGER_CHANGE_SINKS) == 0) {
+
+            pending_sink_change change{};
+            {
+                std::lock_guard<std::mutex> lock(s_general_mutex);
+                change = std::move(s_pending_sink_changes.front());
+                s_pending_sink_changes.pop_front();
+            }
+
+            if (!change.remove) {
+                auto worker = (change.use_own_thread) ? std::make_unique<sink_worker>(change.target) : nullptr;
+                s_sinks.push_back({ std::move(change.target), std::move(worker) });
+
+            } else {
+
+                const auto found = std::find_if(s_sinks.begin(), s_sinks.end(), [&change](const sink_slot& slot) { return slot.target == change.target; });
+                if (found == s_sinks.end()) {
+                    WRITE_TO_FILE("[LOGGER] Tried to remove a sink that was not added. IGNORED\n");
+                    return;
+                }
+
+                if (found->worker)
+                    found->worker->stop();                                  // writes the messages that are still queued
+                else
+                    found->target->flush();
+                s_sinks.erase(found);
+            }
+
+        } else if (strcmp(message.function_name, LOGGER_CHANGE_FLUSH_INTERVAL) == 0) {
+
+            std::lock_guard<std::mutex> lock(s_general_mutex);
+            s_flush_interval = std::chrono::milliseconds(message.line);
+            WRITE_TO_FILE(message.message << "\n");
+
+        } else if (strcmp(message.function_name, LOGGER_REGISTER_THREAD_LABEL) == 0 || strcmp(message.function_name, LOGGER_UNREGISTER_THREAD_LABEL) == 0) {
+
+            if (!message.message.empty())                                                            // the label table was already updated by the calling thread
+                WRITE_TO_FILE(message.message << "\n");
+
+        } else if (strcmp(message.function_name, LOGGER_RELEASE_THREAD_NAME) == 0) {
+
+            release_thread_name(message.thread_name);
+        }
+
+        else {
+
+            if (message.deferred_format)
+                format_deferred_message(message);
+
+            process_log_message(std::move(message));
+        }
+    }
+
+
+    // ========================================================================================================================
+    // handle message
+    // ========================================================================================================================
+
+    void log_msg(const severity msg_sev, const char* file_name, const char* function_name, const int line, std::thread::id thread_id, std::string&& message) {
+
+        if (message.empty())
+            return;
+
+        bool drop_oldest = false;
+        if (!admit_message(msg_sev, drop_oldest))
+            return;
+
+        message_format loc_message(msg_sev, file_name, function_name, line, thread_id, std::move(message));
+        loc_message.thread_name = get_thread_name(thread_id);
+        record_for_crash(loc_message, loc_message.message);
+
+        const bool notify = static_cast<u8>(msg_sev) >= static_cast<u8>(s_severity_level_buffering_threshold.load(std::memory_order_relaxed));
+        enqueue_message(std::move(loc_message), notify);
+        if (drop_oldest)
+            drop_oldest_message();
+    }
+
+
+    namespace deferred {
+
+        void log_binary(const call_site& site, const char* format, const arg_type* arg_types, const u8 arg_count, const u8* args, const size_t args_size) {
+
+            bool drop_oldest = false;
+            if (format[0] == '\0' || !admit_message(site.msg_sev, drop_oldest))
+                return;
+
+            message_format message{};
+            message.msg_sev = site.msg_sev;
+            message.file_name = site.file_name;
+            message.function_name = site.function_name;
+            message.line = site.line;
+            message.thread_id = std::this_thread::get_id();
+            message.thread_name = get_thread_name(message.thread_id);
+            record_for_crash(message, format);                                  // the arguments are only formatted by the worker
+            message.deferred_format = format;
+            message.deferred_arg_types = arg_types;
+            message.deferred_arg_count = arg_count;
+            message.deferred_args_size = static_cast<u32>(args_size);
+            if (args_size <= LOGGER_DEFERRED_INLINE_ARG_SIZE)
+                std::memcpy(message.deferred_args.data(), args, args_size);
             else
-                format_filled << s_format_current[x];
+                message.message.assign(reinterpret_cast<const char*>(args), args_size);
+
+            const bool notify = static_cast<u8>(site.msg_sev) >= static_cast<u8>(s_severity_level_buffering_threshold.load(std::memory_order_relaxed));
+            enqueue_message(std::move(message), notify);
+            if (drop_oldest)
+                drop_oldest_message();
+        }
+
+    }
+
+
+    template<typename T>
+    T read_deferred_arg(const u8*& cursor) {
+
+        T value;
+        std::memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return value;
+    }
+
+
+    // Decodes one argument written by deferred::encode() and appends its text
+    void append_deferred_arg(std::string& output, const deferred::arg_type type, const u8*& cursor) {
+
+        char digits[32];
+        switch (type) {
+        case deferred::arg_type::boolean:           output.append(read_deferred_arg<u8>(cursor) ? "true" : "false"); break;
+        case deferred::arg_type::character:         output.push_back(static_cast<char>(read_deferred_arg<u8>(cursor))); break;
+        case deferred::arg_type::unsigned_integer:  append_number(output, read_deferred_arg<u64>(cursor)); break;
+        case deferred::arg_type::signed_integer: {
+            const auto result = std::to_chars(digits, digits + sizeof(digits), read_deferred_arg<int64>(cursor));
+            output.append(digits, result.ptr);
+        } break;
+        case deferred::arg_type::floating_point: {
+            const auto result = std::to_chars(digits, digits + sizeof(digits), read_deferred_arg<f64>(cursor));
+            output.append(digits, result.ptr);
+        } break;
+        case deferred::arg_type::pointer: {
+            const auto result = std::to_chars(digits, digits + sizeof(digits), read_deferred_arg<u64>(cursor), 16);
+            output.append("0x");
+            output.append(digits, result.ptr);
+        } break;
+        case deferred::arg_type::string: {
+            const u32 length = read_deferred_arg<u32>(cursor);
+            output.append(reinterpret_cast<const char*>(cursor), length);
+            cursor += length;
+        } break;
+        }
+    }
+
+
+    // Replaces the "{}" placeholders of a LOG_DEFERRED() format with the captured arguments
+    void format_deferred_message(message_format& message) {
+
+        std::string args_storage{};
+        const u8* args = message.deferred_args.data();
+        if (message.deferred_args_size > LOGGER_DEFERRED_INLINE_ARG_SIZE) {
+            args_storage = std::move(message.message);
+            args = reinterpret_cast<const u8*>(args_storage.data());
         }
 
-        std::string log_str = format_filled.str();
-        if (s_write_log_to_console)                               // write to console befor checking for file write conditions
-            std::cout << log_str;
+        std::string output{};
+        u8 next_arg = 0;
+        for (const char* cursor = message.deferred_format; *cursor != '\0'; cursor++) {
 
-        if (!((static_cast<u8>(message.msg_sev) >= static_cast<u8>(s_severity_level_buffering_threshold)) || (s_buffered_messages.capacity() - s_buffered_messages.size()) <= log_str.size())) {
+            if ((cursor[0] == '{' && cursor[1] == '{') || (cursor[0] == '}' && cursor[1] == '}')) {         // escaped brace
+                output.push_back(*cursor++);
+                continue;
+            }
+
+            if (cursor[0] == '{' && cursor[1] == '}' && next_arg < message.deferred_arg_count) {
+                append_deferred_arg(output, message.deferred_arg_types[next_arg++], args);
+                cursor++;
+                continue;
+            }
 
-            s_buffered_messages.append(log_str);
+            output.push_back(*cursor);
+        }
+        message.message = std::move(output);
+    }
+
+
+    // Converts a call-site timestamp to wall-clock time, only touched by the worker
+    std::chrono::system_clock::time_point to_system_clock(const std::chrono::steady_clock::time_point timestamp) {
+
+        return s_clock_anchor_system + std::chrono::duration_cast<std::chrono::system_clock::duration>(timestamp - s_clock_anchor_steady);
+    }
+
+
+    // Converts a call-site timestamp to microseconds since the unix epoch, only touched by the worker
+    int64 to_unix_microseconds(const std::chrono::steady_clock::time_point timestamp) {
+
+        return std::chrono::duration_cast<std::chrono::microseconds>(to_system_clock(timestamp).time_since_epoch()).count();
+    }
+
+
+    void append_json_string(std::string& output, const std::string_view text) {
+
+        static constexpr char hex_digits[] = "0123456789abcdef";
+        output.push_back('"');
+        for (const char character : text) {
+            switch (character) {
+                case '"':   output.append("\\\""); break;
+                case '\\':  output.append("\\\\"); break;
+                case '\n':  output.append("\\n"); break;
+                case '\r':  output.append("\\r"); break;
+                case '\t':  output.append("\\t"); break;
+                default:
+                    if (static_cast<u8>(character) < 0x20) {                                    // remaining control characters (e.g. console colors)
+                        output.append("\\u00");
+                        output.push_back(hex_digits[static_cast<u8>(character) >> 4]);
+                        output.push_back(hex_digits[static_cast<u8>(character) & 0xF]);
+                    } else
+                        output.push_back(character);
+                    break;
+            }
+        }
+        output.push_back('"');
+    }
+
+
+    // Serializes [message] for the structured sink, layouts are described at logger::structured_format and in log_reader.h
+    void append_structured_record(std::string& output, const message_format& message, const std::string_view thread_name) {
+
+        const int64 timestamp = to_unix_microseconds(message.timestamp);
+        if (s_structured_format == structured_format::json_lines) {
+
+            output.append("{\"timestamp\":");
+            char digits[24];
+            output.append(digits, std::to_chars(digits, digits + sizeof(digits), timestamp).ptr);
+            output.append(",\"severity\":\"");
+            output.append(severity_names[static_cast<u8>(message.msg_sev)]);
+            output.append("\",\"file\":");
+            append_json_string(output, message.file_name);
+            output.append(",\"function\":");
+            append_json_string(output, message.function_name);
+            output.append(",\"line\":");
+            output.append(digits, std::to_chars(digits, digits + sizeof(digits), message.line).ptr);
+            output.append(",\"thread\":");
+            append_json_string(output, thread_name);
+            output.append(",\"message\":");
+            append_json_string(output, message.message);
+            output.append("}\n");
             return;
         }
-        
-        OPEN_FILE
-        s_main_file << s_buffered_messages << log_str;
-        CLOSE_FILE
 
-        s_buffered_messages.clear();
+        const std::string_view file_name = message.file_name;
+        const std::string_view function_name = message.function_name;
+        const u16 file_length = static_cast<u16>(std::min<size_t>(file_name.size(), UINT16_MAX));
+        const u16 function_length = static_cast<u16>(std::min<size_t>(function_name.size(), UINT16_MAX));
+        const u16 thread_length = static_cast<u16>(std::min<size_t>(thread_name.size(), UINT16_MAX));
+        const u32 message_length = static_cast<u32>(message.message.size());
+        const u32 record_size = static_cast<u32>(structured_record_fixed_size + file_length + function_length + thread_length + message_length);
+        const u8 msg_sev = static_cast<u8>(message.msg_sev);
+        const int32 line = static_cast<int32>(message.line);
+
+        auto append_raw = [&output](const auto& value) { output.append(reinterpret_cast<const char*>(&value), sizeof(value)); };
+        append_raw(record_size);
+        append_raw(msg_sev);
+        append_raw(timestamp);
+        append_raw(line);
+        append_raw(file_length);
+        append_raw(function_length);
+        append_raw(thread_length);
+        append_raw(message_length);
+        output.append(file_name.data(), file_length);
+        output.append(function_name.data(), function_length);
+        output.append(thread_name.data(), thread_length);
+        output.append(message.message);
+    }
+
+
+    void process_log_message(const message_format&& message) {
+
+    #define SHORTEN_FUNC_NAME(text)                                 (strstr(text, "::") ? strstr(text, "::") + 2 : text)
+
+        const system_time loc_sys_time = to_system_time(message.timestamp);
+        std::string& output = s_line_buffer;
+        output.clear();
+
+        // run the compiled format program
+        std::unique_lock<std::mutex> lock(s_general_mutex);
+        for (const format_op& op : s_format_program.ops) {
+            switch (op.type) {
+
+            case format_op_type::literal:               output.append(s_format_program.literals, op.offset, op.length); break;
+
+            // ------------------------ Basic info ------------------------
+            case format_op_type::color_begin:           output.append(console_color_table[(u8)message.msg_sev]); break;                        // Color start
+            case format_op_type::color_end:             output.append(console_rest); break;                                                    // Color end
+            case format_op_type::message:               output.append(message.message); break;                                                 // input text (message)
+            case format_op_type::severity:              output.append(severity_names[(u8)message.msg_sev]); break;                             // log severity
+            case format_op_type::alignment:             if (message.msg_sev == severity::Info || message.msg_sev == severity::Warn) { output.push_back(' '); } break;  // alignment
+            case format_op_type::new_line:              output.push_back('\n'); break;                                                         // line brake
+
+            // ------------------------ Basic info ------------------------
+            case format_op_type::thread:                output.append(*message.thread_name); break;                                            // Thread id or associated label
+            case format_op_type::function_name:         output.append(message.function_name); break;                                           // function name
+            case format_op_type::short_function_name:   output.append(SHORTEN_FUNC_NAME(message.function_name)); break;                        // short function name
+            case format_op_type::file_name:             output.append(message.file_name); break;                                               // file name
+            case format_op_type::short_file_name:       output.append(get_filename(message.file_name)); break;                                 // short file name
+            case format_op_type::line:                  append_number(output, static_cast<u64>(message.line)); break;                          // line
+
+            // ------------------------ time ------------------------
+            case format_op_type::time:                                                                                                          // formatted time
+                append_number(output, loc_sys_time.hour, 2);
+                output.push_back(':');
+                append_number(output, loc_sys_time.minute, 2);
+                output.push_back(':');
+                append_number(output, loc_sys_time.secund, 2);
+                break;
+            case format_op_type::hour:                  append_number(output, loc_sys_time.hour, 2); break;                                    // hour
+            case format_op_type::minute:                append_number(output, loc_sys_time.minute, 2); break;                                  // minute
+            case format_op_type::second:                append_number(output, loc_sys_time.secund, 2); break;                                  // second
+            case format_op_type::millisecond:           append_number(output, loc_sys_time.millisecend, 3); break;                             // miliseconds
+
+            // ------------------------ data ------------------------
+            case format_op_type::date:                                                                                                          // data yy/mm/dd
+                append_number(output, loc_sys_time.year, 4);
+                output.push_back('/');
+                append_number(output, loc_sys_time.month, 2);
+                output.push_back('/');
+                append_number(output, loc_sys_time.day, 2);
+                break;
+            case format_op_type::year:                  append_number(output, loc_sys_time.year, 4); break;                                    // year
+            case format_op_type::month:                 append_number(output, loc_sys_time.month, 2); break;                                   // month
+            case format_op_type::day:                   append_number(output, loc_sys_time.day, 2); break;                                     // day
+            }
+        }
+
+        const bool flush = static_cast<u8>(message.msg_sev) >= static_cast<u8>(s_severity_level_buffering_threshold.load(std::memory_order_relaxed))
+                        || static_cast<u8>(message.msg_sev) >= static_cast<u8>(severity::Error);          // Error and Fatal are never buffered
+
+        if (s_structured_file) {                                  // machine readable copy of the message
+            s_structured_buffer.clear();
+            append_structured_record(s_structured_buffer, message, *message.thread_name);
+            s_structured_file->write(s_structured_buffer, flush);
+        }
+        lock.unlock();
+
+        if (!s_sinks.empty()) {
+            const sink_entry entry{ message.msg_sev, to_system_clock(message.timestamp), message.file_name, message.function_name, message.line, *message.thread_name, message.message, output };
+            for (auto& slot : s_sinks) {
+                if (message.msg_sev < slot.target->get_min_severity())
+                    continue;
+
+                if (slot.worker)
+                    slot.worker->push(entry);
+                else
+                    slot.target->write(entry);
+            }
+        }
+
+        s_main_file.write(output, flush);
+    }
+
+
+    // ========================================================================================================================
+    // sinks
+    // ========================================================================================================================
+
+    void console_sink::write(const sink_entry& entry) { std::cout.write(entry.formatted.data(), static_cast<std::streamsize>(entry.formatted.size())); }
+
+    void console_sink::flush() { std::cout.flush(); }
+
+
+    file_sink::file_sink(const std::filesystem::path& path, const bool use_append_mode, const rotation_settings& rotation)
+        : m_file(std::make_unique<log_file>()) {
+
+        std::error_code error{};
+        if (path.has_parent_path())
+            std::filesystem::create_directories(path.parent_path(), error);
+
+        if (m_file->open(path, use_append_mode)) {
+            m_file->set_capacity(16 * 1024);                                // the buffer is written at the end of every batch anyway
+            m_file->set_rotation(rotation);
+        }
+    }
+
+    file_sink::~file_sink() { m_file->close(); }
+
+    bool file_sink::is_open() const { return m_file->is_open(); }
+
+    file_sink_stats file_sink::get_stats() const { return m_file->get_stats(); }
+
+    void file_sink::write(const sink_entry& entry) {
+
+        if (m_file->is_open())
+            m_file->write(entry.formatted, false);
+    }
+
+    void file_sink::flush() {
+
+        m_file->flush();
+        m_file->rotate_if_due();
+    }
+
+
+    memory_sink::memory_sink(const size_t capacity)
+        : m_messages(std::max<size_t>(capacity, 1)) {}
+
+    void memory_sink::write(const sink_entry& entry) {
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_messages[m_next].assign(entry.formatted);
+        m_next = (m_next + 1) % m_messages.size();
+        m_count = std::min(m_count + 1, m_messages.size());
+    }
+
+    std::vector<std::string> memory_sink::get_messages() const {
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<std::string> messages{};
+        messages.reserve(m_count);
+        for (size_t x = 0; x < m_count; x++)
+            messages.push_back(m_messages[(m_next + m_messages.size() - m_count + x) % m_messages.size()]);
+        return messages;
+    }
+
+    void memory_sink::clear() {
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_next = 0;
+        m_count = 0;
+    }
+
+
+    // ========================================================================================================================
+    // crash ring
+    // ========================================================================================================================
+
+    void record_for_crash([[maybe_unused]] const message_format& message, [[maybe_unused]] const std::string_view text) {
+
+#if LOGGER_CRASH_RING_SIZE > 0
+        const u64 index = s_crash_ring_head.fetch_add(1, std::memory_order_relaxed);
+        crash_record& record = s_crash_ring[index % LOGGER_CRASH_RING_SIZE];
+        u64 sequence = record.sequence.load(std::memory_order_relaxed);
+        if ((sequence & 1) || sequence > 2 * index || !record.sequence.compare_exchange_strong(sequence, 2 * index + 1, std::memory_order_acquire))
+            return;                                                         // another producer writes this slot or already wrote a newer message into it
+
+        record.timestamp = message.timestamp;
+        record.msg_sev = message.msg_sev;
+        record.file_name = message.file_name;
+        record.line = message.line;
+        record.thread_name_length = static_cast<u32>(std::min<size_t>(message.thread_name->size(), CRASH_THREAD_NAME_SIZE));
+        std::memcpy(record.thread_name, message.thread_name->data(), record.thread_name_length);
+        record.length = static_cast<u32>(std::min<size_t>(text.size(), LOGGER_CRASH_RECORD_SIZE));
+        std::memcpy(record.text, text.data(), record.length);
+        record.sequence.store(2 * index + 2, std::memory_order_release);
+#endif
+    }
+
+
+    // write() until everything is written, only uses async-signal-safe calls
+    static void write_to_descriptor(const int file_descriptor, const char* data, size_t size) {
+
+        while (size > 0) {
+#if defined(PLATFORM_WINDOWS)
+            const int written = _write(file_descriptor, data, static_cast<unsigned int>(size));
+#else
+            const ssize_t written = ::write(file_descriptor, data, size);
+            if (written < 0 && errno == EINTR)
+                continue;
+#endif
+            if (written <= 0)
+                return;
+
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+
+
+    void write_crash_ring([[maybe_unused]] const int file_descriptor) {
+
+#if LOGGER_CRASH_RING_SIZE > 0
+        char line[LOGGER_CRASH_RECORD_SIZE + 512];
+        auto append = [&line](size_t& length, const char* text, const size_t text_length) {
+            const size_t count = std::min(text_length, sizeof(line) - 1 - length);          // always keep room for the new line
+            std::memcpy(line + length, text, count);
+            length += count;
+        };
+        auto append_number = [&line](size_t& length, const u64 value, const int width) {
+            char digits[24];
+            const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+            for (int x = static_cast<int>(result.ptr - digits); x < width && length < sizeof(line) - 1; x++)
+                line[length++] = '0';
+            const size_t count = std::min(static_cast<size_t>(result.ptr - digits), sizeof(line) - 1 - length);
+            std::memcpy(line + length, digits, count);
+            length += count;
+        };
+
+        static constexpr char header[] = "[LOGGER] ------------------------------------ crash ring, the last messages before the crash ------------------------------------\n";
+        static constexpr char footer[] = "[LOGGER] ------------------------------------ end of crash ring ------------------------------------\n";
+        write_to_descriptor(file_descriptor, header, sizeof(header) - 1);
+
+        const auto now = std::chrono::steady_clock::now();
+        const u64 head = s_crash_ring_head.load(std::memory_order_acquire);
+        for (u64 index = (head > LOGGER_CRASH_RING_SIZE) ? head - LOGGER_CRASH_RING_SIZE : 0; index < head; index++) {
+
+            const crash_record& record = s_crash_ring[index % LOGGER_CRASH_RING_SIZE];
+            if (record.sequence.load(std::memory_order_acquire) != 2 * index + 2)
+                continue;                                                   // still written or already replaced
+
+            // [-1.234567 s] [SEVERITY] [thread] file.cpp:42 message
+            size_t length = 0;
+            const int64 age = std::max<int64>(0, std::chrono::duration_cast<std::chrono::microseconds>(now - record.timestamp).count());
+            append(length, "[-", 2);
+            append_number(length, static_cast<u64>(age / 1000000), 0);
+            append(length, ".", 1);
+            append_number(length, static_cast<u64>(age % 1000000), 6);
+            append(length, " s] [", 5);
+            const std::string& name = severity_names[static_cast<u8>(record.msg_sev)];
+            append(length, name.data(), name.size());
+            append(length, "] [", 3);
+            append(length, record.thread_name, record.thread_name_length);
+            append(length, "] ", 2);
+            const char* file_name = get_filename(record.file_name);
+            append(length, file_name, strlen(file_name));
+            append(length, ":", 1);
+            append_number(length, static_cast<u64>(record.line), 0);
+            append(length, " ", 1);
+            append(length, record.text, record.length);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (record.sequence.load(std::memory_order_relaxed) != 2 * index + 2)
+                continue;                                                   // replaced while it was copied
+
+            line[length++] = '\n';
+            write_to_descriptor(file_descriptor, line, length);
+        }
+
+        write_to_descriptor(file_descriptor, footer, sizeof(footer) - 1);
+#endif
+    }
+
+
+    void dump_crash_ring() {
+
+#if defined(PLATFORM_WINDOWS)
+        const int file_descriptor = (s_crash_log_path[0] != '\0') ? _open(s_crash_log_path, _O_WRONLY | _O_APPEND | _O_BINARY) : -1;
+        write_crash_ring((file_descriptor >= 0) ? file_descriptor : 2);
+        if (file_descriptor >= 0)
+            _close(file_descriptor);
+#else
+        const int file_descriptor = (s_crash_log_path[0] != '\0') ? ::open(s_crash_log_path, O_WRONLY | O_APPEND | O_CLOEXEC) : -1;
+        write_crash_ring((file_descriptor >= 0) ? file_descriptor : STDERR_FILENO);
+        if (file_descriptor >= 0)
+            ::close(file_descriptor);
+#endif
     }
 
 }
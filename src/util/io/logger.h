@@ -29,6 +29,40 @@ namespace AT::logger {
     };
 
 
+    // Named log categories, every category has a compile-time level (LOG_LEVEL_<CATEGORY> in core_config.h)
+    // and a runtime level (set_category_level()) that is checked before a message is formatted
+    // @note general is used by LOG() and LOG_DEFERRED(), its compile-time level is LOG_LEVEL_ENABLED
+    enum class category : u8 {
+        general = 0,
+        app,
+        renderer,
+        serializer,
+        io,
+        count
+    };
+
+
+    // THIS SHOULD NEVER BE DIRECTLY ACCESSED, use set_category_level() / get_category_level()
+    inline std::atomic<severity> g_category_levels[static_cast<u8>(category::count)]{};
+
+
+    // Returns true if a message of [msg_sev] in [log_category] passes the runtime level
+    // @note costs one relaxed atomic load, used by the LOG macros before any formatting happens
+    inline bool is_enabled(const category log_category, const severity msg_sev) {
+
+        return static_cast<u8>(msg_sev) >= static_cast<u8>(g_category_levels[static_cast<u8>(log_category)].load(std::memory_order_relaxed));
+    }
+
+
+    // Messages of [log_category] below [new_level] are dropped at the call site (nothing is formatted or queued)
+    // @note Error and Fatal can not be filtered, a higher level is clamped to Error
+    void set_category_level(const category log_category, const severity new_level);
+
+
+    // Returns the current runtime level of [log_category]
+    severity get_category_level(const category log_category);
+
+
     // Initialize the logging system
     // @param format The inital log message foeman
     // @param log_to_console should the log message be written to std::cout?
@@ -103,10 +137,215 @@ namespace AT::logger {
 
 
     // set the size of the buffer.
-    // @note for messages that are not directly logged
+    // @note for messages that are not directly logged, the buffer is written to the log file with a single write call once it is full
     void set_buffer_size(const size_t new_size);
 
 
+    // Write buffered messages to the log file if they have been waiting for longer than [interval].
+    // @note 0 disables time based flushing (default). The check runs on the worker thread, so the effective
+    //       resolution is the worker wake-up period (100 ms)
+    void set_flush_interval(const std::chrono::milliseconds interval);
+
+
+    // Statistics of the main log file
+    struct file_sink_stats {
+        u64 messages_written = 0;       // messages handed to the file (including logger notes)
+        u64 bytes_written = 0;          // bytes that reached the file
+        u64 write_calls = 0;            // write syscalls issued by the logger
+        u64 syscalls_avoided = 0;       // compared to opening, writing and closing the file for every message
+        u64 rotations = 0;              // how often the file was rotated (see set_rotation())
+    };
+
+    // Returns a snapshot of the main log file statistics, can be called from any thread.
+    // @return The counters of the current session.
+    file_sink_stats get_file_sink_stats();
+
+
+    // Rotation of the main log file, disabled by default
+    struct rotation_settings {
+        u64 max_file_size = 0;                          // rotate once the file reached this size in bytes, 0 = no size limit
+        std::chrono::seconds interval{0};               // rotate after this time, 0 = no time limit
+        u32 retention_count = 10;                       // rotated segments that are kept, older ones are deleted (0 = keep all)
+        bool compress = true;                           // gzip rotated segments on a low priority background thread
+    };
+
+    // Rotated segments are renamed to <file name>_<yyyy-mm-dd_hh-mm-ss>.<extension> next to the main log file (+ .gz when compressed),
+    // the main log file then starts empty. Compression and deleting old segments never block the logger worker.
+    void set_rotation(const rotation_settings& settings);
+
+
+    // Format of the structured sink, a machine readable copy of every log message next to the text log
+    enum class structured_format : u8 {
+        json_lines,             // one object per line: {"timestamp":<us since epoch>,"severity":"INFO","file":"..","function":"..","line":42,"thread":"..","message":".."}
+        binary,                 // file header followed by length-prefixed records, the layout is described in log_reader.h
+    };
+
+    // Writes every following log message (independent of the text format) to [path], a previously opened structured sink is closed.
+    // @note uses the same buffering as the main log file (set_buffer_threshold(), set_buffer_size(), set_flush_interval())
+    // @note read it back with logger::read_structured_log() (log_reader.h)
+    // @return false if the logger is not initialized or the file could not be opened
+    bool open_structured_sink(const std::filesystem::path& path, const structured_format format, const bool use_append_mode = false);
+
+    // Closes the structured sink after every message logged before this call was written, shutdown() also closes it
+    void close_structured_sink();
+
+
+    // A log message as it is handed to a sink
+    // @note the views are only valid during sink::write(), copy what has to be kept
+    struct sink_entry {
+        severity                                msg_sev = severity::Trace;
+        std::chrono::system_clock::time_point   timestamp{};                // taken at the call site
+        const char*                             file_name = "";
+        const char*                             function_name = "";
+        int                                     line = 0;
+        std::string_view                        thread{};                   // thread label or thread id
+        std::string_view                        message{};                  // the logged text
+        std::string_view                        formatted{};                // the message in the current log format (see set_format())
+    };
+
+    class sink_worker;
+
+    // Output for log messages next to the main log file, see add_sink()
+    // @note write() and flush() of one sink are never called concurrently
+    class sink {
+    public:
+
+        virtual ~sink() = default;
+
+        // Called for every message at or above the minimum severity of the sink
+        virtual void write(const sink_entry& entry) = 0;
+
+        // Called after every batch of messages (and at least every 100 ms), buffered output should be written here
+        virtual void flush() {}
+
+        // Messages below [new_min_severity] are not passed to this sink, can be changed from any thread
+        void set_min_severity(const severity new_min_severity) { m_min_severity.store(new_min_severity, std::memory_order_relaxed); }
+        severity get_min_severity() const { return m_min_severity.load(std::memory_order_relaxed); }
+
+        // Messages that were dropped because the queue of the sink's own thread was full (see add_sink())
+        u64 get_dropped_messages() const { return m_dropped_messages.load(std::memory_order_relaxed); }
+
+    private:
+
+        friend class sink_worker;
+
+        std::atomic<severity>                   m_min_severity = severity::Trace;
+        std::atomic<u64>                        m_dropped_messages = 0;
+    };
+
+
+    // Writes the formatted messages to std::cout
+    class console_sink : public sink {
+    public:
+
+        void write(const sink_entry& entry) override;
+        void flush() override;
+    };
+
+
+    class log_file;
+
+    // Writes the formatted messages to a file with a single write call per batch
+    class file_sink : public sink {
+    public:
+
+        // @param use_append_mode keep the content of an existing file
+        // @param rotation optional rotation of the file, see set_rotation()
+        explicit file_sink(const std::filesystem::path& path, const bool use_append_mode = false, const rotation_settings& rotation = {});
+        ~file_sink() override;
+
+        // @return false if the file could not be opened, nothing is written in that case
+        bool is_open() const;
+        file_sink_stats get_stats() const;
+
+        void write(const sink_entry& entry) override;
+        void flush() override;
+
+    private:
+        std::unique_ptr<log_file>               m_file;
+    };
+
+
+    // A file sink that always rotates, segments are named and compressed like the ones of the main log file
+    class rotating_file_sink : public file_sink {
+    public:
+
+        rotating_file_sink(const std::filesystem::path& path, const rotation_settings& rotation, const bool use_append_mode = false)
+            : file_sink(path, use_append_mode, rotation) {}
+    };
+
+
+    // Keeps the last [capacity] formatted messages in memory, e.g. for an in-app log window or a crash report
+    class memory_sink : public sink {
+    public:
+
+        explicit memory_sink(const size_t capacity = 1024);
+
+        void write(const sink_entry& entry) override;
+
+        // @return the stored messages, oldest first
+        std::vector<std::string> get_messages() const;
+        void clear();
+
+    private:
+        mutable std::mutex                      m_mutex{};
+        std::vector<std::string>                m_messages{};
+        size_t                                  m_next = 0;                 // slot of the next message
+        size_t                                  m_count = 0;
+    };
+
+
+    // Passes every message to a function
+    class callback_sink : public sink {
+    public:
+
+        explicit callback_sink(std::function<void(const sink_entry&)> callback)
+            : m_callback(std::move(callback)) {}
+
+        void write(const sink_entry& entry) override { m_callback(entry); }
+
+    private:
+        std::function<void(const sink_entry&)>  m_callback;
+    };
+
+
+    // Adds [new_sink] for all messages logged after this call, the sinks are removed by shutdown()
+    // @param use_own_thread write from a dedicated thread, so a slow sink can not stall the logger and the other sinks.
+    //        Up to LOGGER_SINK_QUEUE_LIMIT messages are queued for it, further messages below Error are dropped and counted.
+    //        Without an own thread the sink is called by the logger worker.
+    // @note logger::init() with [log_to_console] adds a console_sink with its own thread
+    void add_sink(std::shared_ptr<sink> new_sink, const bool use_own_thread = false);
+
+    // Removes [existing_sink] after every message logged before this call was passed to it
+    void remove_sink(const std::shared_ptr<sink>& existing_sink);
+
+
+    // What happens to a new message when the queue already holds the number of messages set with set_queue_limit()
+    // @note Error and Fatal messages are never dropped or blocked
+    enum class overflow_policy : u8 {
+        block,                  // the logging thread waits until the worker made room (default)
+        drop_newest,            // the new message is dropped
+        drop_oldest,            // the oldest queued message of the logging thread is dropped
+        sample,                 // from 75% of the limit only every LOGGER_SAMPLE_RATE-th message is kept, at the limit new messages are dropped
+    };
+
+    // Limits the number of queued (not yet processed) messages, the default limit is LOGGER_QUEUE_LIMIT from core_config.h
+    // @note dropped messages are counted per severity and the counts are written to the log file once per second
+    // @param max_messages 0 disables the limit
+    void set_queue_limit(const size_t max_messages, const overflow_policy policy = overflow_policy::block);
+
+
+    // Statistics of the message queue, counters are accumulated over the lifetime of the process
+    struct queue_stats {
+        u64 pending = 0;                // messages waiting for the worker
+        u64 dropped[6] = {};            // dropped messages per severity
+        u64 blocked = 0;                // how often a logging thread had to wait for the worker (block policy)
+    };
+
+    // Returns a snapshot of the queue statistics, can be called from any thread.
+    queue_stats get_queue_stats();
+
+
     // Registers a label for a specific thread, allowing for easier identification in logs.
     // If a label is already registered for the given thread ID, it will be overridden with the new label.
     // @param thread_label The label to be associated with the thread.
@@ -122,11 +361,139 @@ namespace AT::logger {
     void unregister_label_for_thread(std::thread::id thread_id = std::this_thread::get_id());
     
 
+    // Writes the crash ring (the last LOGGER_CRASH_RING_SIZE messages, copied at the call site) to [file_descriptor].
+    // Only uses write(), so it is safe to call from a signal handler. Messages that were still queued are included.
+    // @note a message that is written to the ring while it is dumped can be missing
+    void write_crash_ring(const int file_descriptor);
+
+    // Appends the crash ring to the main log file (stderr if it can not be opened), async-signal-safe. Called by crash_handler.
+    void dump_crash_ring();
+
+
     // THIS SHOULD NEVER BE DIRECTLY CALLED
     // @note empty log messages will be ignored
     void log_msg(const severity msg_sev, const char* file_name, const char* function_name, const int line, std::thread::id thread_id, std::string&& message);
 
 
+    // Deferred logging used by LOG_DEFERRED(): the call site only copies the raw argument bytes,
+    // the text is formatted by the worker thread
+    namespace deferred {
+
+        // Argument types that can be captured, everything else has to use the normal LOG() macros
+        enum class arg_type : u8 {
+            boolean,                    // stored as 1 byte
+            character,                  // stored as 1 byte
+            signed_integer,             // stored as int64 (also enums with a signed underlying type)
+            unsigned_integer,           // stored as u64 (also enums with an unsigned underlying type)
+            floating_point,             // stored as f64
+            string,                     // stored as u32 length followed by the characters
+            pointer,                    // stored as u64, printed as hex
+        };
+
+        // Static information of one LOG_DEFERRED() call site
+        struct call_site {
+            severity                    msg_sev;
+            const char*                 file_name;
+            const char*                 function_name;
+            int                         line;
+        };
+
+        template<typename T>
+        constexpr arg_type get_arg_type() {
+
+            if constexpr (std::is_same_v<T, bool>)                                                  return arg_type::boolean;
+            else if constexpr (std::is_same_v<T, char>)                                             return arg_type::character;
+            else if constexpr (std::is_enum_v<T>)                                                   return get_arg_type<std::underlying_type_t<T>>();
+            else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)                        return arg_type::signed_integer;
+            else if constexpr (std::is_integral_v<T>)                                               return arg_type::unsigned_integer;
+            else if constexpr (std::is_floating_point_v<T>)                                         return arg_type::floating_point;
+            else if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*> || std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>)
+                                                                                                    return arg_type::string;
+            else if constexpr (std::is_pointer_v<T>)                                                return arg_type::pointer;
+            else static_assert(sizeof(T) == 0, "LOG_DEFERRED() does not support this argument type, use LOG() instead");
+        }
+
+        template<typename T>
+        size_t get_encoded_size(const T& value) {
+
+            constexpr arg_type type = get_arg_type<std::decay_t<T>>();
+            if constexpr (type == arg_type::boolean || type == arg_type::character)                return 1;
+            else if constexpr (type == arg_type::string) {
+                if constexpr (std::is_pointer_v<T>)
+                    return sizeof(u32) + ((value) ? strlen(value) : 0);
+                else
+                    return sizeof(u32) + std::string_view(value).size();
+            }
+            else                                                                                    return 8;
+        }
+
+        template<typename T>
+        void encode(u8*& cursor, const T& value) {
+
+            constexpr arg_type type = get_arg_type<std::decay_t<T>>();
+            if constexpr (type == arg_type::boolean || type == arg_type::character) {
+                *cursor++ = static_cast<u8>(value);
+
+            } else if constexpr (type == arg_type::string) {
+                std::string_view text{};
+                if constexpr (std::is_pointer_v<T>) {
+                    if (value)
+                        text = value;
+                } else
+                    text = value;
+
+                const u32 length = static_cast<u32>(text.size());
+                std::memcpy(cursor, &length, sizeof(length));
+                std::memcpy(cursor + sizeof(length), text.data(), length);
+                cursor += sizeof(length) + length;
+
+            } else {
+                u64 bits = 0;
+                if constexpr (type == arg_type::floating_point) {
+                    const f64 number = static_cast<f64>(value);
+                    std::memcpy(&bits, &number, sizeof(number));
+                } else if constexpr (type == arg_type::pointer)
+                    bits = static_cast<u64>(reinterpret_cast<uintptr_t>(value));
+                else if constexpr (type == arg_type::signed_integer)
+                    bits = static_cast<u64>(static_cast<int64>(value));
+                else
+                    bits = static_cast<u64>(value);
+
+                std::memcpy(cursor, &bits, sizeof(bits));
+                cursor += sizeof(bits);
+            }
+        }
+
+        // THIS SHOULD NEVER BE DIRECTLY CALLED, use LOG_DEFERRED()
+        void log_binary(const call_site& site, const char* format, const arg_type* arg_types, const u8 arg_count, const u8* args, const size_t args_size);
+
+        // Captures [args] and queues them together with the static [site] and [format]
+        // @note [format] has to be a string literal, it is read by the worker thread
+        template<size_t N, typename... Args>
+        void log(const call_site& site, const char (&format)[N], const Args&... args) {
+
+            static_assert(sizeof...(Args) <= 255, "LOG_DEFERRED() supports at most 255 arguments");
+            static constexpr arg_type arg_types[] = { get_arg_type<std::decay_t<Args>>()..., arg_type::boolean };     // last entry only avoids an empty array
+
+            const size_t args_size = (size_t{0} + ... + get_encoded_size(args));
+            if (args_size <= LOGGER_DEFERRED_INLINE_ARG_SIZE) {
+
+                u8 buffer[LOGGER_DEFERRED_INLINE_ARG_SIZE]{};
+                [[maybe_unused]] u8* cursor = buffer;
+                (encode(cursor, args), ...);
+                log_binary(site, format, arg_types, static_cast<u8>(sizeof...(Args)), buffer, args_size);
+
+            } else {
+
+                std::vector<u8> buffer(args_size);
+                [[maybe_unused]] u8* cursor = buffer.data();
+                (encode(cursor, args), ...);
+                log_binary(site, format, arg_types, static_cast<u8>(sizeof...(Args)), buffer.data(), args_size);
+            }
+        }
+    }
+
+
     // An exception type that logs the error message immediately when constructed.
     // The exception stores the provided message and also forwards it to the logger
     // with context (file, function, line, thread).
@@ -168,6 +535,20 @@ namespace AT::logger {
 #define LOG_LEVEL_ENABLED           			4
 
 
+namespace AT::logger {
+
+    // compile-time levels of the categories, same order as [logger::category]
+    constexpr int category_compile_levels[] = { LOG_LEVEL_ENABLED, LOG_LEVEL_APP, LOG_LEVEL_RENDERER, LOG_LEVEL_SERIALIZER, LOG_LEVEL_IO };
+    static_assert(sizeof(category_compile_levels) / sizeof(int) == static_cast<size_t>(category::count), "every logger category needs a compile-time level");
+
+    // Returns true if messages of [msg_sev] in [log_category] are part of the build
+    constexpr bool is_compiled_in(const category log_category, const severity msg_sev) {
+
+        return category_compile_levels[static_cast<u8>(log_category)] + static_cast<int>(msg_sev) >= 4 || msg_sev >= severity::Error;
+    }
+}
+
+
 //  ===================================================================================  Logger calls  ===================================================================================
 
 
@@ -176,26 +557,30 @@ namespace AT::logger {
 #define LOG_Fatal(message)          { std::ostringstream oss{}; oss << message; AT::logger::log_msg(AT::logger::severity::Fatal, __FILE__, __FUNCTION__, __LINE__, std::this_thread::get_id(), std::move(oss.str())); }
 #define LOG_Error(message)          { std::ostringstream oss{}; oss << message; AT::logger::log_msg(AT::logger::severity::Error, __FILE__, __FUNCTION__, __LINE__, std::this_thread::get_id(), std::move(oss.str())); }
 
+// checks the runtime level of the category before the message is formatted
+#define LOG_FILTERED(log_category, level, message)                                                                                      \
+    { if (AT::logger::is_enabled(AT::logger::category::log_category, AT::logger::severity::level)) { std::ostringstream oss{}; oss << message; AT::logger::log_msg(AT::logger::severity::level, __FILE__, __FUNCTION__, __LINE__, std::this_thread::get_id(), std::move(oss.str())); } }
+
 #if LOG_LEVEL_ENABLED > 0
-    #define LOG_Warn(message)       { std::ostringstream oss{}; oss << message; AT::logger::log_msg(AT::logger::severity::Warn, __FILE__, __FUNCTION__, __LINE__, std::this_thread::get_id(), std::move(oss.str())); }
+    #define LOG_Warn(message)       LOG_FILTERED(general, Warn, message)
 #else
     #define LOG_Warn(message)       { }
 #endif
 
 #if LOG_LEVEL_ENABLED > 1
-    #define LOG_Info(message)       { std::ostringstream oss{}; oss << message; AT::logger::log_msg(AT::logger::severity::Info, __FILE__, __FUNCTION__, __LINE__, std::this_thread::get_id(), std::move(oss.str())); }
+    #define LOG_Info(message)       LOG_FILTERED(general, Info, message)
 #else
     #define LOG_Info(message)       { }
 #endif
 
 #if LOG_LEVEL_ENABLED > 2
-    #define LOG_Debug(message)      { std::ostringstream oss{}; oss << message; AT::logger::log_msg(AT::logger::severity::Debug, __FILE__, __FUNCTION__, __LINE__, std::this_thread::get_id(), std::move(oss.str())); }
+    #define LOG_Debug(message)      LOG_FILTERED(general, Debug, message)
 #else
     #define LOG_Debug(message)      { }
 #endif
 
 #if LOG_LEVEL_ENABLED > 3
-    #define LOG_Trace(message)      { std::ostringstream oss{}; oss << message; AT::logger::log_msg(AT::logger::severity::Trace, __FILE__, __FUNCTION__, __LINE__, std::this_thread::get_id(), std::move(oss.str())); }
+    #define LOG_Trace(message)      LOG_FILTERED(general, Trace, message)
 #else
     #define LOG_Trace(message)      { }
 #endif
@@ -204,6 +589,26 @@ namespace AT::logger {
 #define LOG(severity, message)      LOG_##severity(message)
 
 
+// Log into a named category, e.g. LOG_CATEGORY(renderer, Trace, "created buffer [" << id << "]")
+// @note Below the compile-time level of the category (LOG_LEVEL_<CATEGORY> in core_config.h) the statement is removed from the build,
+//       below the runtime level (set_category_level()) it costs one relaxed atomic load
+#define LOG_CATEGORY(log_category, level, message)                                                                                      \
+    { if constexpr (AT::logger::is_compiled_in(AT::logger::category::log_category, AT::logger::severity::level)) LOG_FILTERED(log_category, level, message) }
+
+
+// Deferred variant of LOG(), the arguments are captured as raw bytes and the text is formatted on the worker thread
+// @note The format uses "{}" as placeholder ("{{" and "}}" for braces) and has to be a string literal
+// @note e.g. LOG_DEFERRED(Info, "frame {} took {} ms", frame_index, frame_time)
+#define LOG_DEFERRED(level, ...)                                                                                                        \
+    {                                                                                                                                   \
+        if constexpr (AT::logger::is_compiled_in(AT::logger::category::general, AT::logger::severity::level)) {                          \
+            static constexpr AT::logger::deferred::call_site loc_call_site{AT::logger::severity::level, __FILE__, __FUNCTION__, __LINE__}; \
+            if (AT::logger::is_enabled(AT::logger::category::general, AT::logger::severity::level))                                     \
+                AT::logger::deferred::log(loc_call_site, __VA_ARGS__);                                                                  \
+        }                                                                                                                               \
+    }
+
+
 // ---------------------------------------------------------------------------  Assertion & Validation  ---------------------------------------------------------------------------
 
 #if defined (PLATFORM_WINDOWS)
@@ -5,34 +5,605 @@
 
 namespace AT::serializer {
 
-	binary::binary(const std::filesystem::path filename, const std::string& section_name, option option) 
-	: m_filename(filename), m_name(section_name), m_option(option) {
+	// small sections never grow the buffer
+	static constexpr size_t 			initial_write_buffer_size = 4096;
+
+	namespace {
+
+		struct section_entry {
+			std::string_view 			name;						// into the table
+			u32 						version;
+			binary::encoding 			encoding;
+			u64 						offset;
+			u64 						size;
+			u32 						crc;
+		};
+
+		// Bounds checked reads of the header and the table
+		struct byte_reader {
+
+			template<typename T>
+			bool read(T& value) {
+
+				if (sizeof(T) > size - position)
+					return false;
+				std::memcpy(&value, data + position, sizeof(T));
+				position += sizeof(T);
+				return true;
+			}
+
+			bool read(std::string_view& string) {
+
+				u32 length = 0;
+				if (!read(length) || length > size - position)
+					return false;
+				string = std::string_view(data + position, length);
+				position += length;
+				return true;
+			}
+
+			const char* 				data;
+			size_t 						size;
+			size_t 						position = 0;
+		};
+
+		template<typename T>
+		void append(std::string& output, const T& value) { output.append(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+		size_t align_section(const size_t offset) { return (offset + binary_section_alignment - 1) & ~(binary_section_alignment - 1); }
+
+		bool is_container(const char* header, const size_t size) {
+
+			return size >= binary_container_header_size && std::memcmp(header, binary_container_magic, sizeof(binary_container_magic)) == 0;
+		}
+
+		// Parses the header fields behind the magic.
+		// @return false if the file was written by a newer version
+		bool parse_header(const char* header, u32& version, u32& section_count, u32& table_size, u32& table_crc) {
+
+			byte_reader reader{ header + sizeof(binary_container_magic), binary_container_header_size - sizeof(binary_container_magic) };
+			reader.read(version);
+			reader.read(section_count);
+			reader.read(table_size);
+			reader.read(table_crc);
+			return version <= binary_container_version;
+		}
+
+		// @return false if the table does not match its checksum or can not be parsed
+		bool parse_table(const char* table, const u32 version, const u32 table_size, const u32 table_crc, const u32 section_count, std::vector<section_entry>& sections) {
+
+			static constexpr size_t smallest_entry = sizeof(u32) * 3 + sizeof(u64) * 2;
+			if (section_count > table_size / smallest_entry || io::crc32c(0, table, table_size) != table_crc)
+				return false;
+
+			byte_reader reader{ table, table_size };
+			sections.resize(section_count);
+			for (auto& section : sections) {
+
+				if (!reader.read(section.name) || !reader.read(section.version))
+					return false;
+
+				section.encoding = binary::encoding::raw;
+				if (version >= 2 && (!reader.read(section.encoding) || section.encoding > binary::encoding::compact))
+					return false;
+
+				if (!reader.read(section.offset) || !reader.read(section.size) || !reader.read(section.crc))
+					return false;
+			}
+			return true;
+		}
+
+		bool is_inside(const section_entry& section, const u64 file_size) { return section.offset <= file_size && section.size <= file_size - section.offset; }
+
+		// Set on the threads of parallel_workers, run_parallel() called from a job runs the nested job on the same thread
+		thread_local bool 			t_inside_worker = false;
+
+		// Threads of run_parallel(), created on first use and kept until the program exits so vector() does not start threads per call
+		class parallel_workers {
+		public:
+
+			static parallel_workers& get() {
+
+				static parallel_workers workers{};
+				return workers;
+			}
+
+			size_t get_thread_count() const { return m_threads.size(); }
+
+			void submit(std::function<void()> task) {
+
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_tasks.push_back(std::move(task));
+				}
+				m_condition.notify_one();
+			}
+
+			~parallel_workers() {
+
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_stop = true;
+				}
+				m_condition.notify_all();
+				for (auto& thread : m_threads)
+					thread.join();
+			}
+
+		private:
+
+			// the calling thread of run_parallel() works too
+			parallel_workers() {
+
+				const u32 thread_count = std::max(1u, std::thread::hardware_concurrency()) - 1;
+				m_threads.reserve(thread_count);
+				for (u32 x = 0; x < thread_count; x++)
+					m_threads.emplace_back([this]() { run(); });
+			}
+
+			void run() {
+
+				t_inside_worker = true;
+				while (true) {
+
+					std::function<void()> task{};
+					{
+						std::unique_lock<std::mutex> lock(m_mutex);
+						m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+						if (m_tasks.empty())
+							return;
+						task = std::move(m_tasks.front());
+						m_tasks.pop_front();
+					}
+					task();
+				}
+			}
+
+			std::mutex 								m_mutex{};
+			std::condition_variable 				m_condition{};
+			std::deque<std::function<void()>> 		m_tasks{};
+			bool 									m_stop = false;
+			std::vector<std::thread> 				m_threads{};
+		};
+
+	}
+
+
+	binary::binary(const std::filesystem::path filename, const std::string& section_name, option option, load_mode mode)
+	: m_filename(filename), m_name(section_name), m_option(option), m_load_mode(mode) {
 
 		// ASSERT(std::filesystem::is_regular_file(filename), "", "Provided filepath is not a file [" << filename.generic_string() << "]");
 		if (m_option == option::save_to_file) {
 
-			m_ostream = std::ofstream(m_filename, std::ios::out | std::ios::binary | std::ios::trunc);
-			VALIDATE(m_ostream, return, "", "Failed to save to file: [" << m_filename << "]");
+			m_write_buffer.reserve(initial_write_buffer_size);
+			m_unflushed = true;												// an empty section still creates the file
 
-		} else {
+		} else if (m_load_mode == load_mode::mapped) {
 
-			m_istream = std::ifstream(m_filename, std::ios::in | std::ios::binary);
-			VALIDATE(m_istream, return, "", "Failed to load file: [" << m_filename << "]");
+			m_view_storage = std::make_shared<view_storage>();
+			m_view_storage->mapping = io::mapped_file(m_filename);
+			VALIDATE(m_view_storage->mapping.is_open(), m_reported_end_of_file = true; return, "", "Failed to map file: [" << m_filename << "]");
 
+			std::ifstream no_stream{};
+			open_section(no_stream);
+
+		} else {
+
+			m_view_storage = std::make_shared<view_storage>();
+			std::ifstream stream(m_filename, std::ios::in | std::ios::binary);
+			VALIDATE(stream, m_reported_end_of_file = true; return, "", "Failed to load file: [" << m_filename << "]");
+			open_section(stream);
 		}
 
 	}
 
+	binary::binary(const binary& parent, chunk_tag)
+	: m_filename(parent.m_filename), m_name(parent.m_name), m_option(parent.m_option), m_load_mode(parent.m_load_mode),
+		m_chunk(true), m_section_version(parent.m_section_version), m_encoding(parent.m_encoding) {}
+
+
+	binary::binary(const binary& parent, const std::span<const char> chunk)
+	: m_filename(parent.m_filename), m_name(parent.m_name), m_option(parent.m_option), m_load_mode(parent.m_load_mode),
+		m_chunk(true), m_section_version(parent.m_section_version), m_encoding(parent.m_encoding), m_valid(true),
+		m_view_storage(std::make_shared<view_storage>()), m_section_data(chunk.data()), m_section_size(chunk.size()) {}
+
+
 	binary::~binary() {
 
+		if (m_option != option::save_to_file || !m_unflushed || m_chunk)
+			return;
+
+		VALIDATE(std::uncaught_exceptions() <= m_uncaught_exceptions, return, "", "Serializer of [" << m_filename << "] destroyed by an exception, the incomplete section [" << m_name << "] is not written");
+		flush();
+	}
+
+
+	bool binary::flush() {
+
+		VALIDATE(m_option == option::save_to_file, return false, "", "flush() called on a serializer that loads [" << m_filename << "]");
+		VALIDATE(!m_chunk, return false, "", "flush() called on the serializer of a vector() chunk of [" << m_filename << "]");
+		m_unflushed = false;
+
+		// keep the other sections of the existing file byte for byte (including their checksums)
+		io::mapped_file previous{};
+		std::vector<section_entry> sections{};
+		std::error_code error{};
+		if (std::filesystem::is_regular_file(m_filename, error))
+			previous = io::mapped_file(m_filename);
+
+		if (is_container(previous.data(), previous.size())) {
+
+			u32 version = 0, section_count = 0, table_size = 0, table_crc = 0;
+			const bool valid = parse_header(previous.data(), version, section_count, table_size, table_crc)
+				&& table_size <= previous.size() - binary_container_header_size
+				&& parse_table(previous.data() + binary_container_header_size, version, table_size, table_crc, section_count, sections);
+
+			if (!valid) {
+				LOG_CATEGORY(serializer, Warn, "The section table of [" << m_filename << "] is corrupted or from a newer version, only section [" << m_name << "] is kept")
+				sections.clear();
+			}
+
+			std::erase_if(sections, [&](const section_entry& section) {
+				if (is_inside(section, previous.size()) || section.name == m_name)
+					return false;
+				LOG_CATEGORY(serializer, Warn, "Dropping section [" << section.name << "] of [" << m_filename << "], the file is truncated")
+				return true;
+			});
+		} else if (previous.size() > 0)
+			LOG_CATEGORY(serializer, Trace, "Replacing [" << m_filename << "] written without sections")
+
+		const auto existing = std::find_if(sections.begin(), sections.end(), [&](const section_entry& section) { return section.name == m_name; });
+		const section_entry own{ m_name, m_section_version, m_encoding, 0, m_write_buffer.size(), io::crc32c(0, m_write_buffer.data(), m_write_buffer.size()) };
+		std::vector<const char*> section_data{};
+		for (const auto& section : sections)
+			section_data.push_back(previous.data() + section.offset);
+
+		if (existing != sections.end()) {
+			section_data[existing - sections.begin()] = m_write_buffer.data();
+			*existing = own;
+		} else {
+			sections.push_back(own);
+			section_data.push_back(m_write_buffer.data());
+		}
+
+		// place the sections behind the table
+		u32 table_size = 0;
+		for (const auto& section : sections)
+			table_size += static_cast<u32>(sizeof(u32) + section.name.size() + sizeof(u32) + sizeof(encoding) + sizeof(u64) * 2 + sizeof(u32));
+
+		u64 offset = align_section(binary_container_header_size + table_size);
+		for (auto& section : sections) {
+			section.offset = offset;
+			offset = align_section(offset + section.size);
+		}
+
+		std::string output{};
+		output.reserve(static_cast<size_t>(offset));
+		output.append(binary_container_magic, sizeof(binary_container_magic));
+		append(output, binary_container_version);
+		append(output, static_cast<u32>(sections.size()));
+		append(output, table_size);
+		append(output, u32(0));													// table checksum, set below
+
+		for (const auto& section : sections) {
+			append(output, static_cast<u32>(section.name.size()));
+			output.append(section.name);
+			append(output, section.version);
+			append(output, section.encoding);
+			append(output, section.offset);
+			append(output, section.size);
+			append(output, section.crc);
+		}
+
+		const u32 table_crc = io::crc32c(0, output.data() + binary_container_header_size, table_size);
+		std::memcpy(output.data() + binary_container_header_size - sizeof(u32), &table_crc, sizeof(u32));
+		for (size_t x = 0; x < sections.size(); x++) {
+			output.resize(static_cast<size_t>(sections[x].offset), '\0');
+			output.append(section_data[x], static_cast<size_t>(sections[x].size));
+		}
+
+		previous = {};															// the file is replaced next
+		LOG_CATEGORY(serializer, Trace, "Writing [" << m_write_buffer.size() << "] bytes of section [" << m_name << "] into [" << output.size() << "] bytes of [" << m_filename << "]")
+		VALIDATE(io::write_file_atomic(m_filename, output.data(), output.size(), m_sync_policy), return false, "", "Failed to save to file: [" << m_filename << "]");
+		return true;
+	}
+
+
+	binary& binary::set_encoding(const encoding encoding) {
+
+		VALIDATE(m_option == option::load_from_file || m_write_buffer.empty(), return *this, "", "set_encoding() called after the first entry of section [" << m_name << "] in [" << m_filename << "]");
+		if (m_option == option::save_to_file)
+			m_encoding = encoding;
+		return *this;
+	}
+
+
+	binary& binary::view(std::string_view& string) {
+
 		if (m_option == option::save_to_file) {
 
-			m_ostream.close();
+			write_size(string.size());
+			write_bytes(string.data(), string.size());
 
 		} else {
 
-			m_istream.close();
+			size_t length = 0;
+			const void* data = (read_size(length) && has_remaining(length, 1)) ? view_bytes(length, 1) : nullptr;
+			string = data ? std::string_view(static_cast<const char*>(data), length) : std::string_view{};
 		}
+		return *this;
+	}
+
+
+	void binary::run_parallel(const size_t count, const std::function<void(const size_t index)>& job) {
+
+		std::atomic<size_t> next_index{ 0 };
+		std::exception_ptr exception{};
+		std::mutex exception_mutex{};
+		const auto worker = [&]() {
+
+			// an exception must not leave a std::thread (std::terminate), it is handed to the calling thread
+			try {
+				for (size_t index = next_index++; index < count; index = next_index++)
+					job(index);
+
+			} catch (...) {
+				next_index = count;
+				std::lock_guard<std::mutex> lock(exception_mutex);
+				if (!exception)
+					exception = std::current_exception();
+			}
+		};
+
+		// a nested call (chunked vector() inside a chunk) already runs on a worker, waiting for the others could deadlock the workers
+		if (t_inside_worker || count <= 1) {
+			worker();
+			if (exception)
+				std::rethrow_exception(exception);
+			return;
+		}
+
+		parallel_workers& workers = parallel_workers::get();
+		size_t running = std::min(count - 1, workers.get_thread_count());
+		std::mutex done_mutex{};
+		std::condition_variable done{};
+		for (size_t x = running; x > 0; x--)
+			workers.submit([&]() {
+				worker();
+				std::lock_guard<std::mutex> lock(done_mutex);
+				running--;
+				done.notify_one();											// under the lock, the caller returns (destroying [done]) once [running] is 0
+			});
+
+		worker();
+		{
+			std::unique_lock<std::mutex> lock(done_mutex);
+			done.wait(lock, [&running]() { return running == 0; });
+		}
+
+		if (exception)
+			std::rethrow_exception(exception);
+	}
+
+
+	void binary::write_chunks(const size_t chunk_size, const std::vector<std::string>& chunks) {
+
+		write_size(chunk_size);
+		for (const auto& chunk : chunks) {
+			const u64 chunk_bytes = chunk.size();
+			write_bytes(&chunk_bytes, sizeof(chunk_bytes));
+		}
+		for (const auto& chunk : chunks)
+			write_bytes(chunk.data(), chunk.size());
+	}
+
+
+	bool binary::read_chunks(const size_t count, size_t& chunk_size, std::vector<std::span<const char>>& chunks) {
+
+		if (!read_size(chunk_size) || chunk_size == 0)
+			return false;
+
+		const size_t chunk_count = count / chunk_size + (count % chunk_size != 0);
+		if (!has_remaining(chunk_count, sizeof(u64)))
+			return false;
+
+		std::vector<u64> chunk_bytes(chunk_count);
+		read_bytes(chunk_bytes.data(), chunk_count * sizeof(u64));
+
+		// every element takes at least one byte, the total is checked before the caller resizes its vector
+		u64 total_bytes = 0;
+		for (const u64 bytes : chunk_bytes) {
+			if (bytes > m_section_size - m_read_position - total_bytes) {
+				report_end_of_file(static_cast<size_t>(bytes));
+				return false;
+			}
+			total_bytes += bytes;
+		}
+		if (total_bytes < count) {
+			LOG_CATEGORY(serializer, Error, "Corrupted size [" << count << "] at offset [" << m_read_position << "] of [" << m_filename << "] section [" << m_name << "], the chunks only hold [" << total_bytes << "] bytes")
+			return false;
+		}
+
+		chunks.reserve(chunk_count);
+		for (const u64 bytes : chunk_bytes) {
+			chunks.emplace_back(m_section_data + m_read_position, static_cast<size_t>(bytes));
+			m_read_position += static_cast<size_t>(bytes);
+		}
+		return true;
+	}
+
+
+	void binary::adopt_view_copies(const std::vector<std::shared_ptr<view_storage>>& storages) {
+
+		for (const auto& storage : storages)
+			if (storage)
+				std::move(storage->copies.begin(), storage->copies.end(), std::back_inserter(m_view_storage->copies));
+	}
+
+
+	void binary::open_section(std::ifstream& stream) {
+
+		m_reported_end_of_file = true;											// nothing can be read until the section is verified
+		u64 file_size = m_view_storage->mapping.size();
+		if (m_load_mode == load_mode::stream) {
+			stream.seekg(0, std::ios::end);
+			file_size = static_cast<u64>(stream.tellg());
+		}
+
+		std::array<char, binary_container_header_size> header_copy{};
+		const char* header = nullptr;
+		if (file_size >= binary_container_header_size && m_load_mode == load_mode::mapped)
+			header = m_view_storage->mapping.data();
+		else if (file_size >= binary_container_header_size && stream.seekg(0).read(header_copy.data(), header_copy.size()))
+			header = header_copy.data();
+
+		const char* data = nullptr;
+		if (!header || !is_container(header, binary_container_header_size)) {
+
+			LOG_CATEGORY(serializer, Trace, "[" << m_filename << "] has no section table, reading it as section [" << m_name << "]")
+			data = read_file(stream, 0, file_size);
+			VALIDATE(data || file_size == 0, return, "", "Failed to read file: [" << m_filename << "]");
+			m_section_version = 0;
+			m_encoding = encoding::raw;
+			m_section_size = static_cast<size_t>(file_size);
+
+		} else {
+
+			u32 version = 0, section_count = 0, table_size = 0, table_crc = 0;
+			VALIDATE(parse_header(header, version, section_count, table_size, table_crc) && table_size <= file_size - binary_container_header_size, return, "",
+				"[" << m_filename << "] was written by a newer version or its header is corrupted");
+
+			const char* table = (m_load_mode == load_mode::mapped) ? m_view_storage->mapping.data() + binary_container_header_size : nullptr;
+			std::string table_copy{};
+			if (m_load_mode == load_mode::stream) {
+				table_copy.resize(table_size);
+				table = stream.read(table_copy.data(), table_size) ? table_copy.data() : nullptr;
+			}
+
+			std::vector<section_entry> sections{};
+			VALIDATE(table && parse_table(table, version, table_size, table_crc, section_count, sections), return, "", "The section table of [" << m_filename << "] is corrupted");
+
+			const auto section = std::find_if(sections.begin(), sections.end(), [&](const section_entry& entry) { return entry.name == m_name; });
+			VALIDATE(section != sections.end(), return, "", "[" << m_filename << "] has no section [" << m_name << "]");
+			VALIDATE(is_inside(*section, file_size), return, "", "Section [" << m_name << "] of [" << m_filename << "] is truncated, it needs [" << (section->offset + section->size) << "] of [" << file_size << "] bytes");
+
+			data = read_file(stream, section->offset, section->size);
+			VALIDATE(data || section->size == 0, return, "", "Failed to read section [" << m_name << "] of [" << m_filename << "]");
+			VALIDATE(io::crc32c(0, data, static_cast<size_t>(section->size)) == section->crc, return, "", "Section [" << m_name << "] of [" << m_filename << "] is corrupted (checksum mismatch)");
+			m_section_version = section->version;
+			m_encoding = section->encoding;
+			m_section_size = static_cast<size_t>(section->size);
+		}
+
+		m_section_data = data;
+		m_valid = true;
+		m_reported_end_of_file = false;
+	}
+
+
+	const char* binary::read_file(std::ifstream& stream, const u64 offset, const u64 size) {
+
+		if (size == 0)
+			return nullptr;
+
+		if (m_load_mode == load_mode::mapped)
+			return m_view_storage->mapping.data() + offset;
+
+		// one read for the whole section, aligned like the mapping so view() can point into it
+		char* data = static_cast<char*>(allocate_view_copy(static_cast<size_t>(size)));
+		stream.clear();
+		stream.seekg(static_cast<std::streamoff>(offset));
+		if (!stream.read(data, static_cast<std::streamsize>(size))) {
+			m_view_storage->copies.pop_back();
+			return nullptr;
+		}
+		return data;
+	}
+
+
+	bool binary::read_bytes(void* destination, const size_t size) {
+
+		if (size > m_section_size - m_read_position) {
+			report_end_of_file(size);
+			return false;
+		}
+
+		std::memcpy(destination, m_section_data + m_read_position, size);
+		m_read_position += size;
+		return true;
+	}
+
+
+	const void* binary::view_bytes(const size_t size, const size_t alignment) {
+
+		if (size > m_section_size - m_read_position) {
+			report_end_of_file(size);
+			return nullptr;
+		}
+
+		const char* data = m_section_data + m_read_position;
+		if (reinterpret_cast<uintptr_t>(data) % alignment == 0) {
+			m_read_position += size;
+			return data;
+		}
+
+		LOG_CATEGORY(serializer, Trace, "Copying [" << size << "] unaligned bytes at offset [" << m_read_position << "] of [" << m_filename << "] section [" << m_name << "]")
+		void* copy = allocate_view_copy(size);
+		read_bytes(copy, size);
+		return copy;
+	}
+
+
+	void* binary::allocate_view_copy(const size_t size) {
+
+		return m_view_storage->copies.emplace_back(std::make_unique<std::max_align_t[]>((size + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t))).get();
+	}
+
+
+	bool binary::read_varint(u64& value) {
+
+		value = 0;
+		for (u32 shift = 0; shift < 64 && m_read_position < m_section_size; shift += 7) {
+
+			const u8 byte = static_cast<u8>(m_section_data[m_read_position++]);
+			value |= static_cast<u64>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+				return true;
+		}
+
+		if (m_read_position < m_section_size)
+			return report_corrupted_value(value);
+
+		report_end_of_file(1);
+		return false;
+	}
+
+
+	bool binary::report_corrupted_value(const u64 value) {
+
+		LOG_CATEGORY(serializer, Error, "Corrupted value [" << value << "] before offset [" << m_read_position << "] of [" << m_filename << "] section [" << m_name << "]")
+		return false;
+	}
+
+
+	bool binary::has_remaining(const size_t count, const size_t element_size) {
+
+		if (count <= (m_section_size - m_read_position) / element_size)
+			return true;
+
+		LOG_CATEGORY(serializer, Error, "Corrupted size [" << count << "] at offset [" << m_read_position << "] of [" << m_filename << "] section [" << m_name << "], only [" << (m_section_size - m_read_position) << "] bytes left")
+		m_reported_end_of_file = true;
+		return false;
+	}
+
+
+	void binary::report_end_of_file(const size_t size) {
+
+		if (m_reported_end_of_file)
+			return;
+
+		m_reported_end_of_file = true;
+		LOG_CATEGORY(serializer, Error, "Unexpected end of section [" << m_name << "] in [" << m_filename << "], [" << size << "] bytes requested at offset [" << m_read_position << "] of [" << m_section_size << "]")
 	}
 
 }
@@ -1,14 +1,54 @@
 #pragma once
 
+#include "util/io/io.h"
 #include "serializer_data.h"
 
 namespace AT::serializer {
 
+	// Container layout, every file holds any number of named sections that are read and replaced independently
+	//  header:     "ATBINARY" (8 bytes) + u32 container version + u32 section count + u32 table size + u32 CRC-32C of the table
+	//  table:      per section [u32 name length][name][u32 section version][u8 encoding][u64 offset][u64 size][u32 CRC-32C of the data]
+	//              (container version 1 has no encoding field, its sections are raw)
+	//  data:       the sections, each starts at a multiple of [binary_section_alignment] bytes from the start of the file
+	// A section is only loaded if the table and its own checksum match, a reader only touches the header, the table and its section.
+	// Files without the magic (written before the container existed) are read as a single section of version 0.
+	// @note all fields are written in the byte order of the machine that wrote the file, like the section data
+	constexpr char 							binary_container_magic[8] = { 'A', 'T', 'B', 'I', 'N', 'A', 'R', 'Y' };
+	constexpr u32 							binary_container_version = 2;
+	constexpr size_t 						binary_container_header_size = 24;
+	constexpr size_t 						binary_section_alignment = 16;
+
+	// Integers the compact encoding stores as varints, single bytes (and bool) are always written as they are
+	template<typename T>
+	concept binary_compact_integer = (std::is_integral_v<T> || std::is_enum_v<T>) && !std::is_same_v<T, bool> && sizeof(T) > 1;
+
 	class binary {
 	public:
 
 		DELETE_COPY_MOVE_CONSTRUCTOR(binary);
 
+		// How a section stores integers and sizes, recorded in the section table so a loader always decodes the section correctly.
+		enum class encoding : u8 {
+			raw,					// sizes as size_t, integers at full width, vectors of trivially copyable types as one block
+			compact,				// sizes and integers as LEB128 varints (signed zig-zag), sorted integer vectors as deltas
+		};
+
+		static constexpr encoding 				default_encoding = encoding::SERIALIZER_BINARY_ENCODING;
+
+		// How a file is read when loading.
+		enum class load_mode : u8 {
+			stream,					// std::ifstream, the section is read with a single call into the view storage
+			mapped,					// the whole file is mapped (io::mapped_file), entry() copies out of the mapping and view() points into it
+									// (on Windows the file can not be saved again while the view storage is alive)
+		};
+
+		// Memory the views of a load point into (the mapping and copies of data that could not be viewed in place).
+		// Views stay valid as long as the serializer or a pointer returned by get_view_storage() exists.
+		struct view_storage {
+			io::mapped_file 						mapping{};
+			std::deque<std::unique_ptr<std::max_align_t[]>> 	copies{};
+		};
+
 		// Declares a default getter for the serialization option member.
 		// The macro will expand to a function that returns the current option.
 		// @return The current serialization option.
@@ -16,25 +56,61 @@ namespace AT::serializer {
 
 
 		// Constructs a binary serializer/deserializer for the given file and section.
-		// When [option] is save_to_file the object opens the file for binary output;
-		// otherwise it opens the file for binary input.
+		// When [option] is save_to_file every entry is collected in memory and written to the file with a single call by flush()
+		// or the destructor, the file is replaced atomically (io::write_file_atomic()) and the other sections of it are kept;
+		// otherwise it finds the section in the file and verifies its checksum, see is_valid().
+		// @note sections of the same file must not be saved concurrently, the last flush() would drop the section of the other
 		// @param filename The path to the file to read from or write to.
 		// @param section_name A human-readable name for the section being (de)serialized.
 		// @param option Controls whether the instance is used to save to or load from file.
+		// @param mode How the file is read when loading, load_mode::mapped makes view() zero-copy.
 		// @return Constructs a binary object ready to perform (de)serialization.
-		binary(const std::filesystem::path filename, const std::string& section_name, option option);
+		binary(const std::filesystem::path filename, const std::string& section_name, option option, load_mode mode = load_mode::stream);
 
 
 		// Destroys the binary (de)serializer and closes any open file streams.
-		// If the object opened an output stream it will be closed; likewise for input streams.
+		// When saving, everything serialized since the last flush() is written to the file, unless the serializer is destroyed
+		// by an exception (stack unwinding): the section is incomplete then and the previous file is kept.
 		// @return None.
 		~binary();
 
 
+		// Sets how long flush() waits for the file to reach the disk, the default io::sync_policy::none only relies on the atomic rename.
+		// @return A reference to *this to allow chaining.
+		binary& set_sync_policy(const io::sync_policy policy) { m_sync_policy = policy; return *this; }
+
+
+		// Sets the encoding of the section when saving, has to be called before the first entry. Loading uses the encoding of the file.
+		// @return A reference to *this to allow chaining.
+		binary& set_encoding(const encoding encoding);
+
+		encoding get_encoding() const { return m_encoding; }
+
+
+		// Sets the version stored with the section when saving, a loader can read it with get_section_version() to handle older layouts.
+		// @return A reference to *this to allow chaining.
+		binary& set_section_version(const u32 version) { m_section_version = version; return *this; }
+
+
+		// When loading: the version the section was saved with, 0 for files written before the container existed.
+		// When saving: the version set by set_section_version().
+		u32 get_section_version() const { return m_section_version; }
+
+
+		// When loading: false if the file is missing, the section does not exist or a checksum does not match, every entry is left unchanged then.
+		bool is_valid() const { return m_valid; }
+
+
+		// Writes everything serialized so far to the file (not only the part since the previous flush), call it to get the result of the save.
+		// @return true if the file holds the serialized data, false if it could not be written (the previous file stays unchanged)
+		bool flush();
+
+
 		// Serializes or deserializes a single value depending on the configured option.
 		// If saving:
 		//   - For std::filesystem::path: converts to a string and serializes that string.
-		//   - For std::string: writes a length (size_t) followed by the raw characters.
+		//   - For std::string: writes a length (size_t, varint with encoding::compact) followed by the raw characters.
+		//   - For integers and enums with encoding::compact: writes a varint, zig-zag encoded if signed.
 		//   - For other types: writes raw bytes of sizeof(T).
 		// If loading:
 		//   - For std::filesystem::path: reads a string and constructs the path from it.
@@ -55,12 +131,18 @@ namespace AT::serializer {
 
 				} else if constexpr (std::is_same_v<T, std::string>) {
 
-					size_t length = value.size();
-					m_ostream.write(reinterpret_cast<const char*>(&length), sizeof(length));
-					m_ostream.write(reinterpret_cast<const char*>(value.data()), length);
+					write_size(value.size());
+					write_bytes(value.data(), value.size());
+
+				} else if constexpr (binary_compact_integer<T>) {
+
+					if (m_encoding == encoding::compact)
+						write_integer(value);
+					else
+						write_bytes(&value, sizeof(T));
 
 				} else
-					m_ostream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+					write_bytes(&value, sizeof(T));
 
 			} else {
 
@@ -73,15 +155,23 @@ namespace AT::serializer {
 				} else if constexpr (std::is_same_v<T, std::string>) {
 
 					size_t length = 0;
-					m_istream.read(reinterpret_cast<char*>(&length), sizeof(length));
+					if (!read_size(length))
+						return *this;
 					
 					ASSERT(length < 65565, "", "Corrupted path length")
 
 					value.resize(length);
-					m_istream.read(value.data(), length);
+					read_bytes(value.data(), length);
+
+				} else if constexpr (binary_compact_integer<T>) {
+
+					if (m_encoding == encoding::compact)
+						read_integer(value);
+					else
+						read_bytes(&value, sizeof(T));
 
 				} else
-					m_istream.read(reinterpret_cast<char*>(&value), sizeof(T));
+					read_bytes(&value, sizeof(T));
 			}
 
 			return *this;
@@ -91,7 +181,8 @@ namespace AT::serializer {
 		// Serializes or deserializes a contiguous std::vector<T>.
 		// If saving: writes the vector's size (size_t) followed by the raw element bytes (sizeof(T) * size).
 		// If loading: reads the size, resizes the vector, then reads raw element bytes into vector.data().
-		// NOTE: This assumes T is trivially copyable / safely writable as raw bytes.
+		// With encoding::compact the size is a varint and integer elements are varints, deltas to the previous element if the vector is sorted.
+		// NOTE: This assumes T is trivially copyable / safely writable as raw bytes, other types are (de)serialized element by element.
 		// @tparam T The vector element type.
 		// @param vector The vector to write (when saving) or to fill (when loading).
 		// @return A reference to *this to allow chaining.
@@ -99,10 +190,16 @@ namespace AT::serializer {
 		binary& entry(std::vector<T>& vector) {
 			if (m_option == option::save_to_file) {
 				size_t size = vector.size();
-				m_ostream.write(reinterpret_cast<const char*>(&size), sizeof(size_t));
+				write_size(size);
 				
-				if constexpr (std::is_trivially_copyable_v<T>) 			// For trivially copyable types, write raw bytes
-					m_ostream.write(reinterpret_cast<const char*>(vector.data()), sizeof(T) * size);
+				if constexpr (binary_compact_integer<T>) {
+					if (m_encoding == encoding::compact)
+						write_integers(vector.data(), size);
+					else
+						write_bytes(vector.data(), sizeof(T) * size);
+
+				} else if constexpr (std::is_trivially_copyable_v<T>) 	// For trivially copyable types, write raw bytes
+					write_bytes(vector.data(), sizeof(T) * size);
 
 				else {													// For non-trivially copyable types, serialize each element individually
 					for (auto& element : vector)
@@ -110,11 +207,22 @@ namespace AT::serializer {
 				}
 			} else {
 				size_t vector_size = 0;
-				m_istream.read(reinterpret_cast<char*>(&vector_size), sizeof(size_t));
+				if (!read_size(vector_size) || (std::is_trivially_copyable_v<T> && !has_remaining(vector_size, compact_integers<T>() ? 1 : sizeof(T))))
+					return *this;
+
+				if constexpr (binary_compact_integer<T>) {
+					if (m_encoding == encoding::compact) {
+						std::vector<T> loc_vector(vector_size);
+						if (read_integers(loc_vector.data(), vector_size))
+							vector = std::move(loc_vector);
+						return *this;
+					}
+				}
+
 				vector.resize(vector_size);
 				
 				if constexpr (std::is_trivially_copyable_v<T>) 			// For trivially copyable types, read raw bytes
-					m_istream.read(reinterpret_cast<char*>(vector.data()), sizeof(T) * vector_size);
+					read_bytes(vector.data(), sizeof(T) * vector_size);
 				
 				else {													// For non-trivially copyable types, deserialize each element individually
 					for (auto& element : vector)
@@ -139,42 +247,410 @@ namespace AT::serializer {
 
 			const size_t total_bytes = sizeof(T) * array_size;
 			if (m_option == option::save_to_file) {
-				m_ostream.write(reinterpret_cast<const char*>(array_start), total_bytes);
+				write_bytes(array_start, total_bytes);
 			} else {
 
 				array_start = (T*)malloc(total_bytes);
-				LOG(Trace, "Deserializing [" << total_bytes << "] bytes into [" << (void*)array_start << "]")
-				m_istream.read(reinterpret_cast<char*>(array_start), total_bytes);
+				LOG_CATEGORY(serializer, Trace, "Deserializing [" << total_bytes << "] bytes into [" << (void*)array_start << "]")
+				read_bytes(array_start, total_bytes);
 			}
 
 			return *this;
 		}
 
 
-		// Placeholder for serializing/deserializing a vector with a custom per-element callback.
-		// Currently unimplemented — logs an error and returns immediately.
-		// Intended behavior (when implemented): iterate elements and call vector_function for each element,
-		// allowing custom (de)serialization logic for complex element types.
+		// Zero-copy counterpart of entry(std::vector<T>&) for trivially copyable types, the file layout is the same so both can be mixed.
+		// If saving: writes the size (size_t) followed by the raw element bytes of [span].
+		// If loading: reads the size and points [span] at the elements, into the section data (the mapping with load_mode::mapped).
+		//             Elements that are not aligned for T in the file are copied into the view storage, as are integers of a compact
+		//             section (they are decoded, the layout of entry(std::vector<T>&) is kept).
+		// @tparam T The element type, has to be trivially copyable.
+		// @param span The elements to write (when saving) or the view to set (when loading), empty if the file ends early.
+		// @return A reference to *this to allow chaining.
+		template<typename T>
+		binary& view(std::span<const T>& span) {
+
+			static_assert(std::is_trivially_copyable_v<T>, "view() needs a trivially copyable type, use entry() with a std::vector instead");
+			if (m_option == option::save_to_file) {
+
+				write_size(span.size());
+				if constexpr (binary_compact_integer<T>) {
+					if (m_encoding == encoding::compact) {
+						write_integers(span.data(), span.size());
+						return *this;
+					}
+				}
+				write_bytes(span.data(), span.size_bytes());
+
+			} else {
+
+				size_t size = 0;
+				const void* data = nullptr;
+				if (read_size(size) && has_remaining(size, compact_integers<T>() ? 1 : sizeof(T))) {
+
+					if constexpr (binary_compact_integer<T>) {
+						if (m_encoding == encoding::compact) {
+							T* values = static_cast<T*>(allocate_view_copy(size * sizeof(T)));
+							data = read_integers(values, size) ? values : nullptr;
+						} else
+							data = view_bytes(size * sizeof(T), alignof(T));
+					} else
+						data = view_bytes(size * sizeof(T), alignof(T));
+				}
+				span = data ? std::span<const T>(static_cast<const T*>(data), size) : std::span<const T>{};
+			}
+			return *this;
+		}
+
+
+		// Zero-copy counterpart of entry(std::string&) and entry(std::filesystem::path&), the file layout is the same.
+		// If saving: writes the length (size_t, varint with encoding::compact) followed by the characters.
+		// If loading: reads the length and points [string] at the characters (not null-terminated), see view(std::span<const T>&).
+		// @param string The text to write (when saving) or the view to set (when loading), empty if the file ends early.
+		// @return A reference to *this to allow chaining.
+		binary& view(std::string_view& string);
+
+
+		// Zero-copy counterpart of array(), the file layout is the same.
+		// If saving: writes the array data (sizeof(T) * array_size).
+		// If loading: points [array_start] at the data instead of allocating, see view(std::span<const T>&). nullptr if the file ends early.
+		// @tparam T The element type, has to be trivially copyable.
+		// @param array_start Pointer to the array data (when saving) or the pointer to set (when loading).
+		// @param array_size Number of elements in the array.
+		// @return A reference to *this to allow chaining.
+		template<typename T>
+		binary& array_view(const T*& array_start, size_t array_size) {
+
+			static_assert(std::is_trivially_copyable_v<T>, "array_view() needs a trivially copyable type");
+			if (m_option == option::save_to_file)
+				write_bytes(array_start, sizeof(T) * array_size);
+			else
+				array_start = has_remaining(array_size, sizeof(T)) ? static_cast<const T*>(view_bytes(sizeof(T) * array_size, alignof(T))) : nullptr;
+
+			return *this;
+		}
+
+
+		// Returns the memory the views of this load point into, keep it to use the views after the serializer is destroyed.
+		std::shared_ptr<const view_storage> get_view_storage() const { return m_view_storage; }
+
+
+		// Serializes or deserializes a vector with a custom per-element callback, for element types entry() can not handle as a whole.
+		// If saving: writes the size and calls [vector_function] for every element, it writes the element with the serializer it is given.
+		// If loading: reads the size, resizes [vector] and calls [vector_function] for every element to read it back.
+		// With a [chunk_size] and more elements than that, the elements are split into chunks of [chunk_size] that are encoded
+		// into their own buffers on worker threads and stored behind an index of their sizes, loading decodes the chunks in parallel too.
+		// NOTE: in the chunked layout [vector_function] runs concurrently for different elements (each with its own serializer),
+		//       it may only touch its own element. Views read in it stay valid like the views of the serializer itself.
+		//       An exception thrown by [vector_function] on a worker thread is rethrown on the calling thread.
+		// NOTE: every element has to write at least one byte, a size larger than the rest of the section is rejected as corrupted
+		//       before [vector] is resized.
+		// NOTE: std::vector<bool> can not use the chunked layout, its elements share bytes and loading them concurrently would race.
+		//       It is always saved sequentially, [chunk_size] is ignored.
 		// @tparam T The vector element type.
-		// @param vector The vector to operate on.
+		// @param vector The vector to write (when saving) or to fill (when loading).
 		// @param vector_function A callback that performs (de)serialization per element.
 		//                        Signature: void(AT::serializer::binary&, const u64 iteration)
-		// @return A reference to *this (currently the function returns immediately after logging).
+		// @param chunk_size Elements per chunk when saving, 0 = sequential. Loading uses the layout of the file.
+		// @return A reference to *this to allow chaining.
 		template<typename T>
-		binary& vector(std::vector<T>& vector, std::function<void(AT::serializer::binary&, const u64 iteration)> vector_function) {
+		binary& vector(std::vector<T>& vector, std::function<void(AT::serializer::binary&, const u64 iteration)> vector_function, const size_t chunk_size = 0) {
+
+			if (m_option == option::save_to_file) {
+
+				const size_t size = vector.size();
+				const bool chunked = !std::is_same_v<T, bool> && chunk_size > 0 && size > chunk_size;
+				write_size(size);
+				const u8 layout = chunked ? vector_layout_chunked : vector_layout_sequential;
+				write_bytes(&layout, sizeof(layout));
+
+				if (!chunked) {
+					for (u64 x = 0; x < size; x++)
+						vector_function(*this, x);
+					return *this;
+				}
+
+				std::vector<std::string> chunks((size + chunk_size - 1) / chunk_size);
+				run_parallel(chunks.size(), [&](const size_t chunk) {
+
+					binary chunk_serializer(*this, chunk_tag{});
+					for (u64 x = chunk * chunk_size; x < std::min<u64>((chunk + 1) * chunk_size, size); x++)
+						vector_function(chunk_serializer, x);
+					chunks[chunk] = std::move(chunk_serializer.m_write_buffer);
+				});
+				write_chunks(chunk_size, chunks);
+
+			} else {
+
+				size_t size = 0;
+				u8 layout = 0;
+				if (!read_size(size) || !read_bytes(&layout, sizeof(layout)))
+					return *this;
 
-			LOG(Error, "NOT IMPLEMENTED YET");
+				if (layout == vector_layout_sequential) {
+					if (!has_remaining(size, 1))
+						return *this;
+
+					vector.resize(size);
+					for (u64 x = 0; x < size; x++)
+						vector_function(*this, x);
+					return *this;
+				}
+
+				size_t loc_chunk_size = 0;
+				std::vector<std::span<const char>> chunks{};
+				if (layout != vector_layout_chunked || std::is_same_v<T, bool> || !read_chunks(size, loc_chunk_size, chunks)) {
+					report_corrupted_value(layout);
+					return *this;
+				}
+
+				vector.resize(size);
+				std::vector<std::shared_ptr<view_storage>> chunk_storage(chunks.size());
+				run_parallel(chunks.size(), [&](const size_t chunk) {
+
+					binary chunk_serializer(*this, chunks[chunk]);
+					for (u64 x = chunk * loc_chunk_size; x < std::min<u64>((chunk + 1) * loc_chunk_size, size); x++)
+						vector_function(chunk_serializer, x);
+					chunk_storage[chunk] = chunk_serializer.m_view_storage;
+				});
+				adopt_view_copies(chunk_storage);
+			}
 			return *this;
 		}
 
 
 	private:
 
+		struct chunk_tag {};
+
+		// Serializer of one chunk of vector(), writes into its own buffer and never to the file.
+		binary(const binary& parent, chunk_tag);
+
+		// Deserializer of one chunk of vector(), reads [chunk] of the section of [parent] with a view storage of its own.
+		binary(const binary& parent, const std::span<const char> chunk);
+
+		// Calls [job] for every index in [0, count) on the calling thread and up to hardware_concurrency() - 1 worker threads, the workers
+		// are shared by all serializers and created by the first call. A call from inside a [job] of a worker runs on that worker only.
+		// The first exception thrown by [job] stops the remaining indices and is rethrown once every thread has finished.
+		static void run_parallel(const size_t count, const std::function<void(const size_t index)>& job);
+
+		// Chunk index and data of vector(): [size chunk size][u64 byte size of every chunk][chunks]
+		void write_chunks(const size_t chunk_size, const std::vector<std::string>& chunks);
+
+		// Reads what write_chunks() wrote for [count] elements, [chunks] point into the section.
+		// @return false if the index is corrupted, the section ends early or the chunks are too small for [count] elements
+		bool read_chunks(const size_t count, size_t& chunk_size, std::vector<std::span<const char>>& chunks);
+
+		// Moves the copies made by the chunk deserializers into [m_view_storage], so their views live as long as those of this serializer.
+		void adopt_view_copies(const std::vector<std::shared_ptr<view_storage>>& storages);
+
+		static constexpr u8 					vector_layout_sequential = 0;
+		static constexpr u8 					vector_layout_chunked = 1;
+
+		template<typename T>
+		constexpr bool compact_integers() const {
+
+			if constexpr (binary_compact_integer<T>)
+				return m_encoding == encoding::compact;
+			else
+				return false;
+		}
+
+		// Unsigned type of the same width as the integer or the underlying type of the enum, used for the deltas
+		template<typename T>
+		using compact_unsigned_t = std::make_unsigned_t<typename std::conditional_t<std::is_enum_v<T>, std::underlying_type<T>, std::type_identity<T>>::type>;
+
+		// Zig-zag maps signed values of small magnitude to small unsigned values (0, -1, 1, -2 ... -> 0, 1, 2, 3 ...)
+		static u64 zigzag_encode(const int64 value) { return (static_cast<u64>(value) << 1) ^ static_cast<u64>(value >> 63); }
+
+		static int64 zigzag_decode(const u64 value) { return static_cast<int64>(value >> 1) ^ -static_cast<int64>(value & 1); }
+
+		// Unsigned LEB128: 7 bits per byte, the high bit marks that another byte follows
+		void write_varint(u64 value) {
+
+			char loc_buffer[10];
+			size_t length = 0;
+			for (; value >= 0x80; value >>= 7)
+				loc_buffer[length++] = static_cast<char>((value & 0x7F) | 0x80);
+			loc_buffer[length++] = static_cast<char>(value);
+			write_bytes(loc_buffer, length);
+		}
+
+		// @return false if the section ends inside the varint or it is longer than 10 bytes
+		bool read_varint(u64& value);
+
+		void write_size(const size_t size) {
+
+			if (m_encoding == encoding::compact)
+				write_varint(size);
+			else
+				write_bytes(&size, sizeof(size));
+		}
+
+		bool read_size(size_t& size) {
+
+			u64 loc_size = 0;
+			if (m_encoding == encoding::raw)
+				return read_bytes(&size, sizeof(size));
+			if (!read_varint(loc_size))
+				return false;
+			size = static_cast<size_t>(loc_size);
+			return true;
+		}
+
+		template<typename T>
+		void write_integer(const T value) {
+
+			if constexpr (std::is_enum_v<T>)
+				write_integer(static_cast<std::underlying_type_t<T>>(value));
+			else if constexpr (std::is_signed_v<T>)
+				write_varint(zigzag_encode(static_cast<int64>(value)));
+			else
+				write_varint(static_cast<u64>(value));
+		}
+
+		// @return false if the section ends early or the value does not fit into T, [value] is unchanged then
+		template<typename T>
+		bool read_integer(T& value) {
+
+			if constexpr (std::is_enum_v<T>) {
+
+				std::underlying_type_t<T> loc_value{};
+				if (!read_integer(loc_value))
+					return false;
+				value = static_cast<T>(loc_value);
+				return true;
+
+			} else {
+
+				u64 encoded = 0;
+				if (!read_varint(encoded))
+					return false;
+
+				if constexpr (std::is_signed_v<T>) {
+					const int64 decoded = zigzag_decode(encoded);
+					if (decoded < std::numeric_limits<T>::min() || decoded > std::numeric_limits<T>::max())
+						return report_corrupted_value(encoded);
+					value = static_cast<T>(decoded);
+				} else {
+					if (encoded > std::numeric_limits<T>::max())
+						return report_corrupted_value(encoded);
+					value = static_cast<T>(encoded);
+				}
+				return true;
+			}
+		}
+
+		// Layout byte followed by the values, a sorted (non-decreasing) range stores the first value and the distance to the previous one after it.
+		// The caller writes the count.
+		template<typename T>
+		void write_integers(const T* values, const size_t count) {
+
+			using unsigned_t = compact_unsigned_t<T>;
+			const bool sorted = count > 1 && std::is_sorted(values, values + count);
+			const u8 layout = sorted ? integer_layout_delta : integer_layout_plain;
+			write_bytes(&layout, sizeof(layout));
+			if (count == 0)
+				return;
+
+			write_integer(values[0]);
+			for (size_t x = 1; x < count; x++) {
+				if (sorted)
+					write_varint(static_cast<u64>(static_cast<unsigned_t>(static_cast<unsigned_t>(values[x]) - static_cast<unsigned_t>(values[x - 1]))));
+				else
+					write_integer(values[x]);
+			}
+		}
+
+		// Reads what write_integers() wrote for [count] values into [values].
+		template<typename T>
+		bool read_integers(T* values, const size_t count) {
+
+			using unsigned_t = compact_unsigned_t<T>;
+			u8 layout = 0;
+			if (!read_bytes(&layout, sizeof(layout)))
+				return false;
+			if (layout != integer_layout_plain && layout != integer_layout_delta)
+				return report_corrupted_value(layout);
+			if (count == 0)
+				return true;
+
+			if (!read_integer(values[0]))
+				return false;
+			for (size_t x = 1; x < count; x++) {
+
+				if (layout == integer_layout_plain) {
+					if (!read_integer(values[x]))
+						return false;
+					continue;
+				}
+
+				u64 delta = 0;
+				if (!read_varint(delta))
+					return false;
+				if (delta > std::numeric_limits<unsigned_t>::max())
+					return report_corrupted_value(delta);
+				values[x] = static_cast<T>(static_cast<unsigned_t>(static_cast<unsigned_t>(values[x - 1]) + static_cast<unsigned_t>(delta)));
+			}
+			return true;
+		}
+
+		static constexpr u8 					integer_layout_plain = 0;
+		static constexpr u8 					integer_layout_delta = 1;
+
+		// Logs a value of a compact section that does not fit its type.
+		// @return false
+		bool report_corrupted_value(const u64 value);
+
+		// Memory for [size] bytes in the view storage, aligned for every type.
+		void* allocate_view_copy(const size_t size);
+
+		// Appends [size] bytes to the write buffer, the buffer grows geometrically so thousands of small entries cost no system call.
+		void write_bytes(const void* data, const size_t size) {
+
+			m_write_buffer.append(static_cast<const char*>(data), size);
+			m_unflushed = true;
+		}
+
+		// Finds [m_name] in the container and verifies it, sets [m_section_data] and [m_valid].
+		void open_section(std::ifstream& stream);
+
+		// Returns [size] bytes at [offset] of the file, a pointer into the mapping or a single read into [m_view_storage].
+		// @return nullptr if they can not be read
+		const char* read_file(std::ifstream& stream, const u64 offset, const u64 size);
+
+		// Copies [size] bytes at the read position into [destination] and advances.
+		// @return false if the section ends before, [destination] is unchanged then
+		bool read_bytes(void* destination, const size_t size);
+
+		// Returns [size] bytes at the read position and advances, a pointer into the section if it is aligned to [alignment],
+		// otherwise a copy in [m_view_storage].
+		// @return nullptr if the section ends before
+		const void* view_bytes(const size_t size, const size_t alignment);
+
+		// Checks that [count] elements of [element_size] bytes can still follow, logs a corrupted size otherwise.
+		bool has_remaining(const size_t count, const size_t element_size);
+
+		// Logs the first read past the end of the section.
+		void report_end_of_file(const size_t size);
+
 		std::filesystem::path 		m_filename{};
 		std::string 				m_name{};
 		option 						m_option;
-		std::ofstream 				m_ostream{};
-		std::ifstream 				m_istream{};
+		load_mode 					m_load_mode = load_mode::stream;
+		std::string 				m_write_buffer{};			// The whole file when saving.
+		io::sync_policy 			m_sync_policy = io::sync_policy::none;
+		bool 						m_unflushed = false;
+		bool 						m_chunk = false;			// Serializer of a chunk of vector(), flush() is not possible.
+		u32 						m_section_version = 0;
+		encoding 					m_encoding = default_encoding;
+		bool 						m_valid = false;			// When loading.
+		std::shared_ptr<view_storage> 	m_view_storage{};		// Created when loading, holds the mapping with load_mode::mapped.
+		const char* 				m_section_data = nullptr;	// When loading, into the mapping or the view storage.
+		size_t 						m_section_size = 0;
+		size_t 						m_read_position = 0;
+		bool 						m_reported_end_of_file = false;
+		int 						m_uncaught_exceptions = std::uncaught_exceptions();		// At construction, more in the destructor means it runs during unwinding.
 
 	};
 
@@ -8,6 +8,7 @@
 // Core Language Features
 #include <algorithm>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <stdexcept>
@@ -23,6 +24,7 @@
 #include <sstream>
 #include <regex>
 #include <iomanip>
+#include <charconv>
 
 // Input/Output and Filesystem
 #include <iostream>
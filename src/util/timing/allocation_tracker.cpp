@@ -0,0 +1,121 @@
+#include "util/pch.h"
+
+#include "util/core_config.h"
+
+#include "allocation_tracker.h"
+
+
+namespace AT {
+
+#if PROFILE_ALLOCATIONS
+
+    // constant initialized, so operator new can use it on any thread at any time (thread startup/exit, static initialization) without a guard
+    static constinit thread_local allocation_totals             t_allocations{};
+
+    allocation_totals get_thread_allocations() { return t_allocations; }
+
+
+    static void* tracked_allocate(std::size_t size) {
+
+        t_allocations.count++;
+        t_allocations.bytes += size;
+        if (size == 0)
+            size = 1;
+
+        while (true) {
+
+            if (void* memory = std::malloc(size))
+                return memory;
+
+            const std::new_handler handler = std::get_new_handler();
+            if (!handler)
+                throw std::bad_alloc();
+            handler();
+        }
+    }
+
+
+    static void* tracked_allocate(std::size_t size, const std::align_val_t alignment) {
+
+        t_allocations.count++;
+        t_allocations.bytes += size;
+        const std::size_t loc_alignment = static_cast<std::size_t>(alignment);
+        size = std::max<std::size_t>((size + loc_alignment - 1) & ~(loc_alignment - 1), loc_alignment);          // aligned_alloc needs a multiple of the alignment
+
+        while (true) {
+
+    #if defined(PLATFORM_WINDOWS)
+            if (void* memory = _aligned_malloc(size, loc_alignment))
+    #else
+            if (void* memory = std::aligned_alloc(loc_alignment, size))
+    #endif
+                return memory;
+
+            const std::new_handler handler = std::get_new_handler();
+            if (!handler)
+                throw std::bad_alloc();
+            handler();
+        }
+    }
+
+
+    static void tracked_free_aligned(void* memory) {
+
+    #if defined(PLATFORM_WINDOWS)
+        _aligned_free(memory);
+    #else
+        std::free(memory);
+    #endif
+    }
+
+#else
+
+    allocation_totals get_thread_allocations() { return {}; }
+
+#endif
+
+}
+
+
+#if PROFILE_ALLOCATIONS
+
+// Replaceable allocation functions, every form has to be replaced so each allocation is released by the matching function.
+// The nothrow forms, sized and array deletes forward to the basic ones like the default implementations.
+
+void* operator new(std::size_t size) { return AT::tracked_allocate(size); }
+void* operator new[](std::size_t size) { return AT::tracked_allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return AT::tracked_allocate(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return AT::tracked_allocate(size, alignment); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try { return AT::tracked_allocate(size); }
+    catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try { return AT::tracked_allocate(size); }
+    catch (...) { return nullptr; }
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try { return AT::tracked_allocate(size, alignment); }
+    catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try { return AT::tracked_allocate(size, alignment); }
+    catch (...) { return nullptr; }
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+
+void operator delete(void* memory, std::align_val_t) noexcept { AT::tracked_free_aligned(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { AT::tracked_free_aligned(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { AT::tracked_free_aligned(memory); }
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept { AT::tracked_free_aligned(memory); }
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept { AT::tracked_free_aligned(memory); }
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept { AT::tracked_free_aligned(memory); }
+
+#endif
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "util/data_structures/data_types.h"
+
+// Optional replacement of the global operator new (PROFILE_ALLOCATIONS in core_config.h) that counts the allocations of every thread,
+// the instrumentor attributes them to the profiled scopes
+namespace AT {
+
+    struct allocation_totals {
+        u64                         count = 0;                      // calls of operator new (every form, including new[] and aligned new)
+        u64                         bytes = 0;                      // requested sizes, not including the overhead of the heap
+    };
+
+
+    // Returns the allocations of the calling thread since it started, a scope takes the difference between its begin and end.
+    // @note only allocations through operator new are counted (std::string, containers, make_shared ...), not direct malloc() calls
+    // @return always 0 if PROFILE_ALLOCATIONS is disabled
+    allocation_totals get_thread_allocations();
+
+}
@@ -0,0 +1,612 @@
+#include "util/pch.h"
+
+#include "instrumentor.h"
+
+
+namespace AT {
+
+    static_assert((PROFILE_THREAD_BUFFER_SIZE & (PROFILE_THREAD_BUFFER_SIZE - 1)) == 0, "PROFILE_THREAD_BUFFER_SIZE has to be a power of two");
+    static_assert((PROFILE_COUNTER_BUFFER_SIZE & (PROFILE_COUNTER_BUFFER_SIZE - 1)) == 0, "PROFILE_COUNTER_BUFFER_SIZE has to be a power of two");
+
+    // Single-producer/single-consumer ring, the producer only writes [m_head], the consumer only writes [m_tail], so no lock is needed on either side.
+    template<typename T, size_t capacity>
+    class spsc_ring {
+    public:
+
+        // @return false if the ring is full, the item is not stored
+        bool push(const T& item) {
+
+            const u64 loc_head = m_head.load(std::memory_order_relaxed);
+            if (loc_head - m_tail.load(std::memory_order_acquire) >= capacity)
+                return false;
+
+            m_items[loc_head & (capacity - 1)] = item;
+            m_head.store(loc_head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Calls [function] for every published item and releases them. Must only be called by the consumer.
+        template<typename F>
+        void drain(F&& function) {
+
+            const u64 loc_tail = m_tail.load(std::memory_order_relaxed);
+            const u64 loc_head = m_head.load(std::memory_order_acquire);
+            for (u64 x = loc_tail; x < loc_head; x++)
+                function(m_items[x & (capacity - 1)]);
+
+            m_tail.store(loc_head, std::memory_order_release);
+        }
+
+        size_t size() const { return static_cast<size_t>(m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_relaxed)); }
+
+    private:
+
+        std::array<T, capacity>                                 m_items{};
+        alignas(64) std::atomic<u64>                            m_head = 0;
+        alignas(64) std::atomic<u64>                            m_tail = 0;
+    };
+
+    // Events of one profiled thread, drained by the writer thread.
+    // Events with perf counters are larger and rare, they get their own ring that is only allocated by the first counter scope of the thread.
+    class profile_event_buffer {
+    public:
+
+        explicit profile_event_buffer(const std::string* thread_id)
+            : thread_id(thread_id) {}
+
+        // Must only be called by the owning thread.
+        spsc_ring<instrumentor::counter_event, PROFILE_COUNTER_BUFFER_SIZE>& get_counter_events() {
+
+            if (!m_counter_events_storage) {
+                m_counter_events_storage = std::make_unique<spsc_ring<instrumentor::counter_event, PROFILE_COUNTER_BUFFER_SIZE>>();
+                m_counter_events.store(m_counter_events_storage.get(), std::memory_order_release);
+            }
+            return *m_counter_events_storage;
+        }
+
+        // nullptr until the owning thread recorded its first counter event.
+        spsc_ring<instrumentor::counter_event, PROFILE_COUNTER_BUFFER_SIZE>* find_counter_events() const { return m_counter_events.load(std::memory_order_acquire); }
+
+        size_t size() const {
+
+            const auto* loc_counter_events = find_counter_events();
+            return events.size() + (loc_counter_events ? loc_counter_events->size() : 0);
+        }
+
+        spsc_ring<profile_event, PROFILE_THREAD_BUFFER_SIZE>    events{};
+        const std::string* const                                thread_id;          // formatted once (interned by the instrumentor), written as "tid" of every event
+        std::atomic<bool>                                       orphaned = false;   // set when the owning thread exited, the writer releases the buffer once it is empty
+
+    private:
+
+        std::unique_ptr<spsc_ring<instrumentor::counter_event, PROFILE_COUNTER_BUFFER_SIZE>>   m_counter_events_storage{};
+        std::atomic<spsc_ring<instrumentor::counter_event, PROFILE_COUNTER_BUFFER_SIZE>*>     m_counter_events = nullptr;
+    };
+
+    // Thread-local owner of a buffer, marks it as orphaned when the thread exits so buffered events are not lost
+    struct profile_event_buffer_handle {
+        ~profile_event_buffer_handle() { if (buffer) buffer->orphaned.store(true, std::memory_order_release); }
+
+        std::shared_ptr<profile_event_buffer>                   buffer{};
+    };
+
+    static thread_local profile_event_buffer_handle             t_event_buffer{};
+
+
+    static u64 now_ns() { return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()); }
+
+    // ==================================================================== instrumentor ====================================================================
+
+    void instrumentor::begin_session(const std::string& name, const std::filesystem::path& directory, const std::string& filename, const std::chrono::seconds rolling_window, const trace_format format) {
+        std::unique_lock lock(m_mutex);
+
+        if (m_current_session) {
+            LOG(Error, "Instrumentor::BeginSession(" << name << ") when session [" << m_current_session->name << "] already open");
+            internal_end_session();
+        }
+
+        if (!std::filesystem::exists(directory)) {
+            if (!std::filesystem::create_directory(directory)) {
+                LOG(Error, "Failed to create folder");
+                return;
+            }
+        }
+
+        m_session_path = directory / filename;
+        if (format == trace_format::binary)
+            m_session_path.replace_extension(binary_trace_extension);
+
+        m_encoder = trace_encoder(format);
+        m_rolling_window_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(rolling_window).count(), std::memory_order_relaxed);
+        if (rolling_window.count() > 0) {
+
+            m_rolling_events.reset(PROFILE_ROLLING_MAX_EVENTS);
+            m_rolling_counter_events.reset(PROFILE_ROLLING_MAX_COUNTER_EVENTS);
+        } else {
+
+            m_output_stream.open(m_session_path, std::ios::binary);
+            if (!m_output_stream.is_open()) {
+                LOG(Error, "Instrumentor could not open file: " << filename);
+                return;
+            }
+        }
+
+        m_current_session = new instrumentation_session{name};
+        write_header();
+
+        {   // events that arrived after the previous session was written belong to no session
+            std::lock_guard<std::mutex> collect_lock(m_collect_mutex);
+            std::lock_guard<std::mutex> buffers_lock(m_thread_buffers_mutex);
+            for (const auto& buffer : m_thread_buffers) {
+                buffer->events.drain([](const profile_event&) {});
+                if (auto* counter_events = buffer->find_counter_events())
+                    counter_events->drain([](const counter_event&) {});
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> collect_lock(m_collect_mutex);
+            std::lock_guard<std::mutex> marks_lock(m_frame_marks_mutex);
+            std::lock_guard<std::mutex> stats_lock(m_frame_stats_mutex);
+            m_frame_marks.clear();
+            m_frames_begin_ns = 0;
+            m_next_frame_index = 0;
+            m_pending_frames.clear();
+            m_frame_events.clear();
+            m_frames.clear();
+            m_scope_frame_times.clear();
+            m_latest_frame_events.clear();
+        }
+
+        m_dropped_events.store(0, std::memory_order_relaxed);
+        m_last_budget_dump_ns.store(0, std::memory_order_relaxed);
+        m_frames_over_budget.store(0, std::memory_order_relaxed);
+        m_writer_stop.store(false, std::memory_order_relaxed);
+        m_writer_notified.store(false, std::memory_order_relaxed);
+        m_writer_thread = std::thread(&instrumentor::writer_loop, this);
+        m_session_active.store(true, std::memory_order_release);
+    }
+
+
+    void instrumentor::end_session() {
+        std::unique_lock lock(m_mutex);
+        internal_end_session();
+    }
+
+
+    // allocations of a single scope beyond u32 are clamped, the bytes stay exact
+    static profile_event make_event(const char* name, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end, const allocation_totals& allocations) {
+
+        return profile_event{ name, static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count()),
+                              static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()),
+                              allocations.bytes, static_cast<u32>(std::min<u64>(allocations.count, std::numeric_limits<u32>::max())) };
+    }
+
+
+    void instrumentor::write_profile(const char* name, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end, const allocation_totals& allocations) {
+
+        if (!m_session_active.load(std::memory_order_relaxed))
+            return;
+
+        const profile_event event = make_event(name, start, end, allocations);
+
+        auto& events = get_thread_buffer().events;
+        if (!events.push(event)) {
+            m_dropped_events.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        notify_writer_if_half_full(events.size(), PROFILE_THREAD_BUFFER_SIZE);
+    }
+
+
+    void instrumentor::write_profile(const char* name, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end, const perf_counter_values& counters,
+        const allocation_totals& allocations) {
+
+        if (!m_session_active.load(std::memory_order_relaxed))
+            return;
+
+        const profile_event event = make_event(name, start, end, allocations);
+
+        auto& counter_events = get_thread_buffer().get_counter_events();
+        if (!counter_events.push({ event, counters })) {
+            m_dropped_events.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        notify_writer_if_half_full(counter_events.size(), PROFILE_COUNTER_BUFFER_SIZE);
+    }
+
+
+    void instrumentor::notify_writer_if_half_full(const size_t size, const size_t capacity) {
+
+        // wake the writer early instead of waiting for the interval, only the first thread that notices pays for the notification
+        if (size >= capacity / 2 && !m_writer_notified.load(std::memory_order_relaxed) && !m_writer_notified.exchange(true, std::memory_order_relaxed))
+            m_writer_cv.notify_one();
+    }
+
+
+    std::filesystem::path instrumentor::dump_trace(const std::string& reason) {
+
+        std::unique_lock lock(m_mutex);
+        if (!m_current_session || m_rolling_window_ns.load(std::memory_order_relaxed) == 0) {
+            LOG(Warn, "Instrumentor trace dump [" << reason << "] ignored, no rolling session is active");
+            return {};
+        }
+
+        std::lock_guard<std::mutex> collect_lock(m_collect_mutex);
+        return write_trace_dump(reason);
+    }
+
+
+    void instrumentor::request_trace_dump(const std::string& reason) {
+
+        if (!m_session_active.load(std::memory_order_acquire) || m_rolling_window_ns.load(std::memory_order_relaxed) == 0) {
+            LOG(Warn, "Instrumentor trace dump [" << reason << "] ignored, no rolling session is active");
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_writer_mutex);
+        m_dump_requests.push_back(reason);
+    }
+
+
+    void instrumentor::end_frame(const std::chrono::nanoseconds work_time) {
+
+        if (!m_session_active.load(std::memory_order_acquire))
+            return;
+
+        const u64 now = now_ns();
+        const u64 budget_ns = m_frame_budget_ns.load(std::memory_order_relaxed);
+        const bool over_budget = budget_ns != 0 && static_cast<u64>(work_time.count()) > budget_ns;
+        {
+            std::lock_guard<std::mutex> lock(m_frame_marks_mutex);
+            m_frame_marks.push_back({ now, static_cast<u64>(work_time.count()), over_budget });
+        }
+
+        if (!over_budget)
+            return;
+
+        m_frames_over_budget.fetch_add(1, std::memory_order_relaxed);
+        const int64 rolling_window_ns = m_rolling_window_ns.load(std::memory_order_relaxed);
+        if (rolling_window_ns == 0)
+            return;
+
+        // the following dumps would mostly contain the same events, only one dump per window
+        int64 last_dump = m_last_budget_dump_ns.load(std::memory_order_relaxed);
+        if ((last_dump != 0 && static_cast<int64>(now) - last_dump < rolling_window_ns) || !m_last_budget_dump_ns.compare_exchange_strong(last_dump, static_cast<int64>(now), std::memory_order_relaxed))
+            return;
+
+        std::ostringstream loc_reason{};
+        loc_reason << "frame_budget_" << std::chrono::duration_cast<std::chrono::milliseconds>(work_time).count() << "ms";
+        request_trace_dump(loc_reason.str());
+    }
+
+
+    std::vector<profile_frame> instrumentor::get_frames() const {
+
+        std::lock_guard<std::mutex> lock(m_frame_stats_mutex);
+        return std::vector<profile_frame>(m_frames.begin(), m_frames.end());
+    }
+
+
+    profile_frame instrumentor::get_latest_frame(std::vector<captured_event>& events) const {
+
+        std::lock_guard<std::mutex> lock(m_frame_stats_mutex);
+        events.assign(m_latest_frame_events.begin(), m_latest_frame_events.end());
+        return m_frames.empty() ? profile_frame{} : m_frames.back();
+    }
+
+
+    std::vector<profile_scope_stats> instrumentor::get_scope_stats() const {
+
+        std::vector<profile_scope_stats> loc_stats{};
+        std::vector<u64> loc_times{};
+        std::lock_guard<std::mutex> lock(m_frame_stats_mutex);
+        loc_stats.reserve(m_scope_frame_times.size());
+        for (const auto& [name, frame_times] : m_scope_frame_times) {
+
+            profile_scope_stats& stats = loc_stats.emplace_back();
+            stats.name = name;
+            stats.frames = static_cast<u32>(frame_times.size());
+
+            u64 loc_calls = 0, loc_total = 0, loc_allocations = 0, loc_allocated_bytes = 0;
+            loc_times.clear();
+            for (const auto& frame_time : frame_times) {
+                loc_calls += frame_time.calls;
+                loc_total += frame_time.total_ns;
+                loc_allocations += frame_time.allocations;
+                loc_allocated_bytes += frame_time.allocated_bytes;
+                loc_times.push_back(frame_time.total_ns);
+            }
+
+            // nearest-rank percentile
+            std::sort(loc_times.begin(), loc_times.end());
+            stats.calls_per_frame = static_cast<f64>(loc_calls) / stats.frames;
+            stats.min_ns = loc_times.front();
+            stats.avg_ns = loc_total / stats.frames;
+            stats.max_ns = loc_times.back();
+            stats.p99_ns = loc_times[(loc_times.size() * 99 + 99) / 100 - 1];
+            stats.allocations_per_frame = static_cast<f64>(loc_allocations) / stats.frames;
+            stats.allocated_bytes_per_frame = static_cast<f64>(loc_allocated_bytes) / stats.frames;
+        }
+
+        std::sort(loc_stats.begin(), loc_stats.end(), [](const profile_scope_stats& left, const profile_scope_stats& right) { return left.avg_ns > right.avg_ns; });
+        return loc_stats;
+    }
+
+
+    profile_event_buffer& instrumentor::get_thread_buffer() {
+
+        if (t_event_buffer.buffer)
+            return *t_event_buffer.buffer;
+
+        std::ostringstream loc_thread_id{};
+        loc_thread_id << std::this_thread::get_id();
+
+        std::lock_guard<std::mutex> lock(m_thread_buffers_mutex);
+        t_event_buffer.buffer = std::make_shared<profile_event_buffer>(&*m_thread_ids.insert(loc_thread_id.str()).first);
+        m_thread_buffers.push_back(t_event_buffer.buffer);
+        return *t_event_buffer.buffer;
+    }
+
+
+    void instrumentor::collect_events() {
+
+        std::vector<std::shared_ptr<profile_event_buffer>> loc_buffers{};
+        {
+            std::lock_guard<std::mutex> lock(m_thread_buffers_mutex);
+            loc_buffers = m_thread_buffers;
+        }
+
+        // boundaries are taken before draining, so every scope that closed before the latest boundary is part of this collection
+        take_frame_marks();
+
+        const bool rolling = m_rolling_window_ns.load(std::memory_order_relaxed) > 0;
+        m_write_buffer.clear();
+        for (const auto& buffer : loc_buffers) {
+            buffer->events.drain([this, rolling, &buffer](const profile_event& event) {
+
+                if (m_frames_begin_ns != 0 && event.start_ns >= m_frames_begin_ns)
+                    m_frame_events.push_back({ event, buffer->thread_id });
+
+                if (rolling)                    // the oldest event is overwritten once PROFILE_ROLLING_MAX_EVENTS are kept
+                    m_rolling_events.push({ event, buffer->thread_id });
+                else
+                    m_encoder.append_event(m_write_buffer, event, buffer->thread_id);
+            });
+
+            auto* counter_events = buffer->find_counter_events();
+            if (!counter_events)
+                continue;
+
+            counter_events->drain([this, rolling, &buffer](const counter_event& captured) {
+
+                if (m_frames_begin_ns != 0 && captured.event.start_ns >= m_frames_begin_ns)
+                    m_frame_events.push_back({ captured.event, buffer->thread_id });
+
+                if (rolling)
+                    m_rolling_counter_events.push({ captured.event, captured.counters, buffer->thread_id });
+                else
+                    m_encoder.append_event(m_write_buffer, captured.event, buffer->thread_id, &captured.counters);
+            });
+        }
+
+        if (!m_write_buffer.empty() && m_output_stream.is_open())
+            m_output_stream.write(m_write_buffer.data(), static_cast<std::streamsize>(m_write_buffer.size()));
+
+        evaluate_frames();
+        if (m_frame_events.size() > PROFILE_ROLLING_MAX_EVENTS) {            // the main loop stopped reporting frames
+            m_frame_events.clear();
+            m_frames_begin_ns = now_ns();
+        }
+
+        if (rolling) {
+
+            const u64 window_begin = now_ns() - std::min<u64>(now_ns(), static_cast<u64>(m_rolling_window_ns.load(std::memory_order_relaxed)));
+            m_rolling_events.trim(window_begin);
+            m_rolling_counter_events.trim(window_begin);
+        }
+
+        std::lock_guard<std::mutex> lock(m_thread_buffers_mutex);
+        std::erase_if(m_thread_buffers, [](const std::shared_ptr<profile_event_buffer>& buffer) { return buffer->orphaned.load(std::memory_order_acquire) && buffer->size() == 0; });
+    }
+
+
+    void instrumentor::take_frame_marks() {
+
+        std::vector<frame_mark> loc_marks{};
+        {
+            std::lock_guard<std::mutex> lock(m_frame_marks_mutex);
+            loc_marks.swap(m_frame_marks);
+        }
+
+        for (const frame_mark& mark : loc_marks) {
+
+            if (m_frames_begin_ns == 0) {                                   // first boundary of the session
+                m_frames_begin_ns = mark.time_ns;
+                continue;
+            }
+
+            const u64 start = m_pending_frames.empty() ? m_frames_begin_ns : m_pending_frames.back().start_ns + m_pending_frames.back().duration_ns;
+            m_pending_frames.push_back({ m_next_frame_index++, start, mark.time_ns - start, mark.work_ns, mark.over_budget });
+        }
+    }
+
+
+    void instrumentor::evaluate_frames() {
+
+        while (m_pending_frames.size() >= 2) {
+
+            const profile_frame frame = m_pending_frames.front();
+            m_pending_frames.pop_front();
+            const u64 frame_end = frame.start_ns + frame.duration_ns;
+
+            // events of the frame to the front, the later ones stay for the next frames
+            const auto later_events = std::stable_partition(m_frame_events.begin(), m_frame_events.end(), [frame_end](const captured_event& captured) { return captured.event.start_ns < frame_end; });
+            m_frame_scopes.clear();
+            for (auto it = m_frame_events.begin(); it != later_events; ++it) {
+                if (it->event.start_ns < frame.start_ns)
+                    continue;
+
+                auto [scope, inserted] = m_frame_scopes.try_emplace(std::string_view(it->event.name), scope_frame_time{ frame.index, 0, 0, 0, 0 });
+                scope->second.total_ns += it->event.duration_ns;
+                scope->second.calls++;
+                scope->second.allocations += it->event.allocations;
+                scope->second.allocated_bytes += it->event.allocated_bytes;
+            }
+            m_frames_begin_ns = frame_end;
+
+            std::lock_guard<std::mutex> lock(m_frame_stats_mutex);
+            m_latest_frame_events.clear();
+            std::copy_if(m_frame_events.begin(), later_events, std::back_inserter(m_latest_frame_events), [&frame](const captured_event& captured) { return captured.event.start_ns >= frame.start_ns; });
+            std::sort(m_latest_frame_events.begin(), m_latest_frame_events.end(), [](const captured_event& left, const captured_event& right) {
+                if (left.thread_id != right.thread_id)
+                    return *left.thread_id < *right.thread_id;
+                return (left.event.start_ns != right.event.start_ns) ? left.event.start_ns < right.event.start_ns : left.event.duration_ns > right.event.duration_ns;   // parents first
+            });
+            m_frame_events.erase(m_frame_events.begin(), later_events);
+
+            m_frames.push_back(frame);
+            if (m_frames.size() > PROFILE_FRAME_STATS_WINDOW)
+                m_frames.pop_front();
+
+            for (const auto& [name, frame_time] : m_frame_scopes)
+                m_scope_frame_times[name].push_back(frame_time);
+
+            for (auto it = m_scope_frame_times.begin(); it != m_scope_frame_times.end();) {
+
+                auto& frame_times = it->second;
+                while (!frame_times.empty() && frame_times.front().frame_index + PROFILE_FRAME_STATS_WINDOW <= frame.index)
+                    frame_times.pop_front();
+
+                if (frame_times.empty())
+                    it = m_scope_frame_times.erase(it);
+                else
+                    ++it;
+            }
+        }
+    }
+
+
+    std::filesystem::path instrumentor::write_trace_dump(const std::string& reason) {
+
+        collect_events();
+
+        const auto now = std::time(nullptr);
+        const auto tm = *std::localtime(&now);
+        std::ostringstream loc_name{};
+        loc_name << m_session_path.stem().string() << "_" << std::put_time(&tm, "%Y-%m-%d_%H-%M-%S") << "_";
+        for (const char character : reason)
+            loc_name << ((std::isalnum(static_cast<unsigned char>(character))) ? character : '_');
+        loc_name << "_" << m_dump_index++ << m_session_path.extension().string();
+        const std::filesystem::path path = m_session_path.parent_path() / loc_name.str();
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LOG(Error, "Instrumentor could not open trace dump file: " << path.generic_string());
+            return {};
+        }
+
+        const u64 window_begin = now_ns() - std::min<u64>(now_ns(), static_cast<u64>(m_rolling_window_ns.load(std::memory_order_relaxed)));
+        trace_encoder encoder(m_encoder.get_format());
+        m_write_buffer.clear();
+        encoder.append_header(m_write_buffer);
+        m_rolling_events.for_each([&](const captured_event& captured) {
+            if (captured.event.start_ns + captured.event.duration_ns >= window_begin)
+                encoder.append_event(m_write_buffer, captured.event, captured.thread_id);
+        });
+        m_rolling_counter_events.for_each([&](const captured_counter_event& captured) {
+            if (captured.event.start_ns + captured.event.duration_ns >= window_begin)
+                encoder.append_event(m_write_buffer, captured.event, captured.thread_id, &captured.counters);
+        });
+        encoder.append_footer(m_write_buffer);
+        file.write(m_write_buffer.data(), static_cast<std::streamsize>(m_write_buffer.size()));
+        file.close();
+
+        LOG(Info, "Instrumentor wrote trace dump [" << path.generic_string() << "], reason [" << reason << "]");
+        return path;
+    }
+
+
+    void instrumentor::writer_loop() {
+
+        std::vector<std::string> loc_dump_requests{};
+        while (!m_writer_stop.load(std::memory_order_acquire)) {
+
+            {
+                std::unique_lock<std::mutex> lock(m_writer_mutex);
+                m_writer_cv.wait_for(lock, std::chrono::milliseconds(PROFILE_WRITE_INTERVAL_MS), [this]() {
+                    return m_writer_stop.load(std::memory_order_relaxed) || m_writer_notified.load(std::memory_order_relaxed);
+                });
+                loc_dump_requests.swap(m_dump_requests);
+            }
+
+            m_writer_notified.store(false, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> collect_lock(m_collect_mutex);
+            collect_events();
+            for (const auto& reason : loc_dump_requests)
+                write_trace_dump(reason);
+
+            loc_dump_requests.clear();
+        }
+    }
+
+
+    void instrumentor::write_header() {
+
+        if (!m_output_stream.is_open())
+            return;
+
+        m_write_buffer.clear();
+        m_encoder.append_header(m_write_buffer);
+        m_output_stream.write(m_write_buffer.data(), static_cast<std::streamsize>(m_write_buffer.size()));
+    }
+
+
+    void instrumentor::write_footer() {
+
+        if (!m_output_stream.is_open())
+            return;
+
+        m_write_buffer.clear();
+        m_encoder.append_footer(m_write_buffer);
+        m_output_stream.write(m_write_buffer.data(), static_cast<std::streamsize>(m_write_buffer.size()));
+    }
+
+
+    void instrumentor::internal_end_session() {
+
+        if (!m_current_session)
+            return;
+
+        m_session_active.store(false, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(m_writer_mutex);
+            m_writer_stop.store(true, std::memory_order_release);
+        }
+        m_writer_cv.notify_one();
+        if (m_writer_thread.joinable())
+            m_writer_thread.join();
+
+        {
+            std::lock_guard<std::mutex> collect_lock(m_collect_mutex);
+            collect_events();                                               // everything recorded until now
+        }
+        write_footer();
+        m_output_stream.close();
+        delete m_current_session;
+        m_current_session = nullptr;
+        m_rolling_events = {};
+        m_rolling_counter_events = {};
+        {
+            std::lock_guard<std::mutex> lock(m_writer_mutex);
+            m_dump_requests.clear();
+        }
+
+        const u64 loc_dropped_events = m_dropped_events.load(std::memory_order_relaxed);
+        if (loc_dropped_events > 0)
+            LOG(Warn, "Instrumentor dropped [" << loc_dropped_events << "] events because a thread buffer was full, increase [PROFILE_THREAD_BUFFER_SIZE] / [PROFILE_COUNTER_BUFFER_SIZE] or lower [PROFILE_WRITE_INTERVAL_MS]");
+    }
+
+}
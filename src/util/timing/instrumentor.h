@@ -6,7 +6,9 @@
 #include "util/data_structures/data_types.h"
 #include "util/io/logger.h"
 #include "util/macros.h"
+#include "util/timing/allocation_tracker.h"
 #include "util/timing/stopwatch.h"
+#include "util/timing/trace_format.h"
 
 
 namespace AT {
@@ -86,92 +88,130 @@ namespace AT {
 // 	#define ISOLATED_PROFILER_LOOP(...)
 // #endif
 
-	using float_microseconds = std::chrono::duration<double, std::micro>;
-
-	// Stores the result of a single profiling event.
-	struct profile_result {
-		std::string 				name;    		// Name of the profiled function or block.
-		float_microseconds 			start;          // Timestamp when profiling began.
-		std::chrono::microseconds 	elapsed_time;   // Duration of the profiled section.
-		std::thread::id 			thread_ID;      // Thread on which the profiling occurred.
-	};
-
-
 	// Represents an active profiling session.
 	struct instrumentation_session {
 		std::string 				name; 			// The session's display name.
 	};
 
 
-	// ==================================================================== instrumentor ====================================================================
+	// A frame reported with PROFILER_FRAME_END(), from one frame boundary to the next.
+	struct profile_frame {
+		u64 						index = 0;						// Counted from the first complete frame of the session.
+		u64 						start_ns = 0;					// steady_clock timestamp of the previous frame boundary.
+		u64 						duration_ns = 0;				// Until the next boundary, including the time waiting for the frame limit.
+		u64 						work_ns = 0;					// Time the frame worked, as reported to end_frame().
+		bool 						over_budget = false;			// [work_ns] exceeded the frame budget, see set_frame_budget().
+	};
 
+	// Time a scope took per frame over the frames of the sliding window (PROFILE_FRAME_STATS_WINDOW).
+	// The time of a frame is the sum of all calls that started in it, frames without a call are not part of the statistics.
+	struct profile_scope_stats {
+		std::string 				name{};
+		u32 						frames = 0;						// Frames of the window in which the scope ran.
+		f64 						calls_per_frame = 0.;			// Average over these frames.
+		u64 						min_ns = 0;
+		u64 						avg_ns = 0;
+		u64 						max_ns = 0;
+		u64 						p99_ns = 0;
+		f64 						allocations_per_frame = 0.;		// Calls of operator new per frame (PROFILE_ALLOCATIONS), average over the frames the scope ran in.
+		f64 						allocated_bytes_per_frame = 0.;
+	};
 
+
+	class profile_event_buffer;
+
+	// ==================================================================== instrumentor ====================================================================
+
+	// Every thread appends its events to its own lock-free buffer (PROFILE_THREAD_BUFFER_SIZE events), a writer thread collects
+	// them every PROFILE_WRITE_INTERVAL_MS (or earlier when a buffer is half full) and writes them to the trace file (Chrome-trace JSON or
+	// the compact binary format of trace_format.h).
+	// The instrumented path never locks, allocates (except the first event of a thread) or touches the file.
+	// In a rolling session the events of the last seconds are kept in memory instead and a trace file is only written on request
+	// (dump_trace(), request_trace_dump(), the PROFILE_DUMP_TRACE_KEY hotkey or a frame exceeding the frame budget).
+	// When the main loop reports its frame boundaries (end_frame()) the writer thread also assigns every event to the frame it started in
+	// and keeps per-scope statistics over the last PROFILE_FRAME_STATS_WINDOW frames, see get_scope_stats().
+	// Counter scopes (PROFILE_SCOPE_COUNTERS()) additionally carry the perf counters of the thread, written as args of the event.
+	// With PROFILE_ALLOCATIONS every event also carries the allocations of its thread while the scope was open (allocation_tracker.h).
+	// @note events that do not fit into a full buffer are dropped and counted, see get_dropped_events()
     class instrumentor {
     public:
         DELETE_COPY_CONSTRUCTOR(instrumentor);
 
-        
-		// Begins a new profiling session, opening a JSON output file to record events.
+		// An event together with the thread that recorded it (rolling window, latest frame).
+		struct captured_event {
+			profile_event 			event;
+			const std::string* 		thread_id;						// Interned for the lifetime of the process.
+		};
+
+		// An event of a counter scope, kept apart from the plain events because it is more than twice as large.
+		struct counter_event {
+			profile_event 			event;
+			perf_counter_values 	counters;						// Difference between the end and the begin of the scope.
+		};
+
+		// Begins a new profiling session and starts the writer thread.
 		// @param name The name of the profiling session.
 		// @param directory The directory where the profiling result file will be saved.
-		// @param filename The name of the output file (defaults to "result.json").
-		void begin_session(const std::string& name, const std::filesystem::path& directory, const std::string& filename = "result.json") {
-            std::unique_lock lock(m_mutex);
-            
-            if (m_current_session) {
-                LOG(Error, "Instrumentor::BeginSession(" << name << ") when session [" << m_current_session->name << "] already open");
-                internal_end_session();
-            }
+		// @param filename The name of the output file (defaults to "result.json"), in a rolling session the base name of the trace dumps.
+		// @param rolling_window 0 streams every event into [filename], otherwise only the events of this last period are kept in memory
+		//        (at most PROFILE_ROLLING_MAX_EVENTS) until a trace dump is requested.
+		// @param format of the session file and the trace dumps, binary traces get the extension [binary_trace_extension]
+		void begin_session(const std::string& name, const std::filesystem::path& directory, const std::string& filename = "result.json", const std::chrono::seconds rolling_window = std::chrono::seconds(0),
+			const trace_format format = trace_format::PROFILE_TRACE_FORMAT);
 
-            if (!std::filesystem::exists(directory)) {
-                if (!std::filesystem::create_directory(directory)) {
-                    LOG(Error, "Failed to create folder");
-                    return;
-                }
-            }
+		// Ends the currently active profiling session: stops the writer thread, writes the remaining events and closes the output file.
+		// @note a rolling session writes no file when it ends
+		void end_session();
 
-            std::filesystem::path total_filepath = directory / filename;
-            m_output_stream.open(total_filepath);
-            
-            if (m_output_stream.is_open()) {
-                m_current_session = new instrumentation_session{name};
-                write_header();
-                m_session_active.store(true, std::memory_order_release);
-            } else {
-                LOG(Error, "Instrumentor could not open file: " << filename);
-            }
-        }
+		// Appends a single event to the buffer of the calling thread, the writer thread adds it to the session file.
+		// @param name Name of the scope, has to outlive the session (string literal).
+		// @param start Timestamp when the scope began.
+		// @param end Timestamp when the scope ended.
+		// @param allocations made by the thread between [start] and [end]
+        void write_profile(const char* name, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end, const allocation_totals& allocations = {});
 
-		// Ends the currently active profiling session, if any, and closes the output file.
-		void end_session() {
-			std::unique_lock lock(m_mutex);
-			internal_end_session();
-		}
+		// Same as write_profile(), the event carries the perf counters the scope consumed (PROFILE_COUNTER_BUFFER_SIZE events per thread).
+        void write_profile(const char* name, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end, const perf_counter_values& counters,
+			const allocation_totals& allocations = {});
 
-		// Writes a single profile result into the active profiling session file.
-		// @param result The profiling data to be recorded.
-        void write_profile(const profile_result& result) {
-            // Quick check without locking first
-            if (!m_session_active.load(std::memory_order_acquire)) return;
-            
-            std::stringstream json;
-            json << std::setprecision(3) << std::fixed;
-            json << ",{";
-            json << "\"cat\":\"function\",";
-            json << "\"dur\":" << (result.elapsed_time.count()) << ',';
-            json << "\"name\":\"" << result.name << "\",";
-            json << "\"ph\":\"X\",";
-            json << "\"pid\":0,";
-            json << "\"tid\":" << result.thread_ID << ",";
-            json << "\"ts\":" << result.start.count();
-            json << "}";
-
-            std::shared_lock lock(m_mutex);
-            if (m_current_session && m_output_stream.is_open()) {
-                m_output_stream << json.str();
-                m_output_stream.flush();
-            }
-        }
+		bool is_session_active() const { return m_session_active.load(std::memory_order_relaxed); }
+
+		// Writes the rolling window to <directory>/<filename stem>_<date>_<time>_<reason>_<index>.<extension> from the calling thread.
+		// @return the path of the written trace, empty if no rolling session is active or the file could not be written
+		std::filesystem::path dump_trace(const std::string& reason = "manual");
+
+		// Same as dump_trace(), but the trace is written by the writer thread on its next wake-up so the caller never waits for the file.
+		// Scopes that are still open (e.g. the current frame) are part of the dump if they end until then.
+		void request_trace_dump(const std::string& reason = "manual");
+
+		// Frames with a longer work time than [budget] are flagged as over budget and request a trace dump in a rolling session,
+		// at most one per rolling window.
+		// @param budget 0 disables the check, the default is PROFILE_FRAME_BUDGET_MS
+		void set_frame_budget(const std::chrono::microseconds budget) { m_frame_budget_ns.store(static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(budget).count()), std::memory_order_relaxed); }
+
+		std::chrono::microseconds get_frame_budget() const { return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::nanoseconds(m_frame_budget_ns.load(std::memory_order_relaxed))); }
+
+		// Marks the boundary between two frames, called once per frame by the main loop (application::limit_fps).
+		// The first call of a session only starts the first frame.
+		// @param work_time the time the ending frame worked (without waiting for the frame limit), checked against the frame budget
+		void end_frame(const std::chrono::nanoseconds work_time);
+
+		// Returns the frames of the sliding window, oldest first.
+		// @note a frame is only evaluated once the next frame ended (scopes that close after the boundary still count), so the newest frame is missing
+		std::vector<profile_frame> get_frames() const;
+
+		// Copies the events of the newest evaluated frame (every thread) into [events], ordered by thread and start (parents before their children).
+		// @return the frame, index and duration are 0 if no frame was evaluated yet
+		profile_frame get_latest_frame(std::vector<captured_event>& events) const;
+
+		// Returns the statistics of every scope that ran in the frames of the sliding window, the most expensive (avg) first.
+		std::vector<profile_scope_stats> get_scope_stats() const;
+
+		// Returns the number of frames over the frame budget in the current/last session.
+		u64 get_frames_over_budget() const { return m_frames_over_budget.load(std::memory_order_relaxed); }
+
+		// Returns the number of events that were dropped in the current/last session because a thread buffer was full.
+		u64 get_dropped_events() const { return m_dropped_events.load(std::memory_order_relaxed); }
 
 		// Returns the singleton instance of the instrumentor.
 		// @return A reference to the global instrumentor instance.
@@ -190,39 +230,139 @@ namespace AT {
 			end_session();
 		}
 
+		// Returns the buffer of the calling thread, creates and registers it for the first event of a thread.
+		profile_event_buffer& get_thread_buffer();
+
+		// Wakes the writer before its interval if a thread buffer is half full, only the first thread that notices pays for the notification.
+		void notify_writer_if_half_full(const size_t size, const size_t capacity);
+
+		// Circular buffer of the rolling window, the oldest item is overwritten once [items] is full.
+		template<typename T>
+		struct rolling_buffer {
+
+			void reset(const size_t capacity) {
+				items.assign(capacity, T{});
+				begin = 0;
+				count = 0;
+			}
+
+			void push(const T& item) {
+				items[(begin + count) % items.size()] = item;
+				if (count < items.size())
+					count++;
+				else
+					begin = (begin + 1) % items.size();
+			}
+
+			// Events of different threads are not strictly ordered, an event that ended in the window can stay a little longer.
+			void trim(const u64 window_begin_ns) {
+				while (count > 0 && items[begin].event.start_ns + items[begin].event.duration_ns < window_begin_ns) {
+					begin = (begin + 1) % items.size();
+					count--;
+				}
+			}
+
+			template<typename F>
+			void for_each(F&& function) const {
+				for (size_t x = 0; x < count; x++)
+					function(items[(begin + x) % items.size()]);
+			}
+
+			std::vector<T> 			items{};
+			size_t 					begin = 0;						// Oldest item.
+			size_t 					count = 0;
+		};
+
+		struct captured_counter_event {
+			profile_event 			event;
+			perf_counter_values 	counters;
+			const std::string* 		thread_id;
+		};
+
+		// A frame boundary reported by end_frame().
+		struct frame_mark {
+			u64 					time_ns;
+			u64 					work_ns;
+			bool 					over_budget;
+		};
+
+		// Time and allocations of one scope in one frame.
+		struct scope_frame_time {
+			u64 					frame_index;
+			u64 					total_ns;
+			u32 					calls;
+			u32 					allocations;
+			u64 					allocated_bytes;
+		};
+
+		// Collects the events of every thread buffer and writes them to the output file or appends them to the rolling window.
+		// Buffers of exited threads are released once empty.
+		// @note [m_collect_mutex] has to be held, a thread buffer is drained by one thread at a time
+		void collect_events();
+
+		// Turns the frame boundaries reported since the last collection into pending frames, [m_collect_mutex] has to be held.
+		void take_frame_marks();
+
+		// Evaluates every pending frame that is followed by another one and publishes it to the statistics, [m_collect_mutex] has to be held.
+		void evaluate_frames();
+
+		// Writes the rolling window to a new trace file, [m_collect_mutex] has to be held.
+		std::filesystem::path write_trace_dump(const std::string& reason);
+
+		// Loop of the writer thread.
+		void writer_loop();
+
 		// Writes the JSON header for the profiling session output file.
-		void write_header() {
-            if (m_output_stream.is_open()) {
-                m_output_stream << "{\"otherData\": {},\"traceEvents\":[{}";
-                m_output_stream.flush();
-            }
-        }
+		void write_header();
         
 		// Writes the JSON footer to close the profiling session output file.
-		void write_footer() {
-            if (m_output_stream.is_open()) {
-                m_output_stream << "]}";
-                m_output_stream.flush();
-            }
-        }
+		void write_footer();
         
 		// Internally handles ending a profiling session and releasing associated resources.
-		void internal_end_session() {
-            if (m_current_session) {
-                write_footer();
-                m_output_stream.close();
-                delete m_current_session;
-                m_current_session = nullptr;
-                m_session_active.store(false, std::memory_order_release);
-            }
-        }
+		void internal_end_session();
 
     private:
 	
-		mutable std::shared_mutex 	m_mutex;            			// Synchronization mutex for thread safety.
+		std::mutex 					m_mutex;            			// Guards beginning and ending sessions.
 		instrumentation_session*  	m_current_session = nullptr; 	// Active profiling session.
-		std::ofstream            	m_output_stream;     			// Output stream for writing profiling data.
+		std::filesystem::path 		m_session_path{};				// Session file, the base name of trace dumps in a rolling session.
+		std::ofstream            	m_output_stream;     			// Output stream for writing profiling data, only used by the writer thread while a session is active.
+		std::string 				m_write_buffer;					// Formatted events of one collection, written with a single call.
+		trace_encoder 				m_encoder{};					// Encodes the events of the session file.
 		std::atomic<bool>        	m_session_active = false; 		// Indicates if a session is active.
+		std::atomic<u64> 			m_dropped_events = 0;			// Events that did not fit into a thread buffer.
+
+		std::vector<std::shared_ptr<profile_event_buffer>>	m_thread_buffers{};		// Every thread that recorded an event.
+		std::unordered_set<std::string> 	m_thread_ids{};			// Formatted thread ids, node based so the addresses stay valid.
+		std::mutex 					m_thread_buffers_mutex;			// Taken once per thread (registration) and by the writer.
+		std::mutex 					m_collect_mutex;				// Held while thread buffers are drained and while a trace is dumped.
+
+		std::atomic<int64> 			m_rolling_window_ns = 0;		// 0 = stream into the session file, read by end_frame() and request_trace_dump() on any thread.
+		rolling_buffer<captured_event> 			m_rolling_events{};			// Guarded by [m_collect_mutex] like the following.
+		rolling_buffer<captured_counter_event> 	m_rolling_counter_events{};
+		u32 						m_dump_index = 0;				// Keeps the names of dumps in the same second unique.
+		std::vector<std::string> 	m_dump_requests{};				// Reasons of requested dumps, guarded by [m_writer_mutex].
+		std::atomic<u64> 			m_frame_budget_ns = static_cast<u64>(PROFILE_FRAME_BUDGET_MS) * 1000000;
+		std::atomic<int64> 			m_last_budget_dump_ns = 0;		// steady_clock time of the last dump triggered by the frame budget.
+		std::atomic<u64> 			m_frames_over_budget = 0;
+
+		std::vector<frame_mark> 	m_frame_marks{};				// Reported by end_frame(), guarded by [m_frame_marks_mutex].
+		std::mutex 					m_frame_marks_mutex;
+		u64 						m_frames_begin_ns = 0;			// Events that started earlier belong to no pending frame, 0 = no boundary yet. Guarded by [m_collect_mutex] like the following.
+		u64 						m_next_frame_index = 0;
+		std::deque<profile_frame> 	m_pending_frames{};				// Frames whose events are still collected.
+		std::vector<captured_event> m_frame_events{};				// Collected events that started after [m_frames_begin_ns].
+		std::unordered_map<std::string_view, scope_frame_time> 	m_frame_scopes{};		// Scratch space of evaluate_frames().
+		std::deque<profile_frame> 	m_frames{};						// Sliding window, guarded by [m_frame_stats_mutex] like the following.
+		std::unordered_map<std::string_view, std::deque<scope_frame_time>> 	m_scope_frame_times{};
+		std::vector<captured_event> m_latest_frame_events{};
+		mutable std::mutex 			m_frame_stats_mutex;
+
+		std::thread 				m_writer_thread{};				// Collects the thread buffers while a session is active.
+		std::mutex 					m_writer_mutex;
+		std::condition_variable 	m_writer_cv;
+		std::atomic<bool> 			m_writer_stop = false;
+		std::atomic<bool> 			m_writer_notified = false;		// Set by the first thread buffer that crossed half of its capacity.
 	};
 
 	// ==================================================================== instrumentor_timer ====================================================================
@@ -235,6 +375,9 @@ namespace AT {
 		instrumentor_timer(const char* name)
 			: m_name(name), m_stopped(false) {
 
+		#if PROFILE_ALLOCATIONS
+			m_start_allocations = get_thread_allocations();
+		#endif
 			m_start_timepoint = std::chrono::steady_clock::now();
 		}
 		
@@ -245,14 +388,16 @@ namespace AT {
 				stop();
 		}
 
-		// Stops the timer, calculates elapsed time, and records profiling data.
+		// Stops the timer and records profiling data.
 		void stop() {
 
-			auto end_timepoint = std::chrono::steady_clock::now();
-			auto high_res_start = float_microseconds{ m_start_timepoint.time_since_epoch() };
-			auto elapsed_time = std::chrono::time_point_cast<std::chrono::microseconds>(end_timepoint).time_since_epoch() - std::chrono::time_point_cast<std::chrono::microseconds>(m_start_timepoint).time_since_epoch();
-
-			instrumentor::get().write_profile({ m_name, high_res_start, elapsed_time, std::this_thread::get_id() });
+			const auto end_timepoint = std::chrono::steady_clock::now();
+		#if PROFILE_ALLOCATIONS
+			const allocation_totals end_allocations = get_thread_allocations();
+			instrumentor::get().write_profile(m_name, m_start_timepoint, end_timepoint, allocation_totals{ end_allocations.count - m_start_allocations.count, end_allocations.bytes - m_start_allocations.bytes });
+		#else
+			instrumentor::get().write_profile(m_name, m_start_timepoint, end_timepoint);
+		#endif
 			m_stopped = true;
 		}
 
@@ -260,6 +405,51 @@ namespace AT {
 
 		const char* 											m_name;   			// Name of the timed scope or function.
 		bool 													m_stopped;       	// Indicates whether the timer has been stopped.
+		allocation_totals 										m_start_allocations{};
+		std::chrono::time_point<std::chrono::steady_clock> 		m_start_timepoint; 	// Start time.
+	};
+
+	// Like instrumentor_timer, but also reads the perf counters of the thread (perf_counters.h) at the begin and end of the scope
+	// and records the difference as args of the event. Reading the counters costs a system call on both ends, use it for selected scopes.
+	// @note without any available counter (see read_perf_counters()) a plain event is recorded
+	class instrumentor_counter_timer {
+	public:
+
+		// Constructs an instrumentor_counter_timer, reading the counters and starting timing immediately.
+		// @param name The name of the timed scope or function.
+		instrumentor_counter_timer(const char* name)
+			: m_name(name) {
+
+			m_has_counters = instrumentor::get().is_session_active() && read_perf_counters(m_start_counters);
+		#if PROFILE_ALLOCATIONS
+			m_start_allocations = get_thread_allocations();
+		#endif
+			m_start_timepoint = std::chrono::steady_clock::now();
+		}
+
+		// Destructor. Records the event with the counters consumed by the scope.
+		~instrumentor_counter_timer() {
+
+			const auto end_timepoint = std::chrono::steady_clock::now();
+		#if PROFILE_ALLOCATIONS
+			const allocation_totals end_allocations = get_thread_allocations();
+			const allocation_totals allocations{ end_allocations.count - m_start_allocations.count, end_allocations.bytes - m_start_allocations.bytes };
+		#else
+			const allocation_totals allocations{};
+		#endif
+			perf_counter_values end_counters{};
+			if (m_has_counters && read_perf_counters(end_counters))
+				instrumentor::get().write_profile(m_name, m_start_timepoint, end_timepoint, perf_counter_delta(m_start_counters, end_counters), allocations);
+			else
+				instrumentor::get().write_profile(m_name, m_start_timepoint, end_timepoint, allocations);
+		}
+
+	private:
+
+		const char* 											m_name;   			// Name of the timed scope or function.
+		bool 													m_has_counters = false;
+		perf_counter_values 									m_start_counters{};
+		allocation_totals 										m_start_allocations{};
 		std::chrono::time_point<std::chrono::steady_clock> 		m_start_timepoint; 	// Start time.
 	};
 
@@ -295,6 +485,10 @@ namespace AT {
         #define FUNC_SIG "FUNC_SIG unknown!"
     #endif
 
+    // Pastes [a] and [b] after expanding them, [b] = __LINE__ has to become the line number for the names of the scope macros to differ
+   	#define PROFILE_CONCAT_INNER(a, b)							a##b
+   	#define PROFILE_CONCAT(a, b)								PROFILE_CONCAT_INNER(a, b)
+
     // Creates a scoped profiling timer for a code block.
     //
     // @param name  The name of the profiling scope.
@@ -307,7 +501,7 @@ namespace AT {
     //   - Defines a constexpr name for the profiling scope.
     //   - Instantiates an AT::instrumentor_timer object, which automatically starts timing.
     //   - When the timer goes out of scope, it stops and records the result.
-   	#define PROFILE_SCOPE_LINE(name, line)						constexpr auto fixed_name##line = name;    	AT::instrumentor_timer benchmark_timer##line(fixed_name##line)
+   	#define PROFILE_SCOPE_LINE(name, line)						constexpr auto PROFILE_CONCAT(fixed_name, line) = name;    	AT::instrumentor_timer PROFILE_CONCAT(benchmark_timer, line)(PROFILE_CONCAT(fixed_name, line))
 
     // Begins a new profiling session and writes results to a JSON file.
     //
@@ -318,6 +512,26 @@ namespace AT {
     // Usage example:
     //     PROFILER_SESSION_BEGIN("GameStartup", "profiling", "startup.json");
    	#define PROFILER_SESSION_BEGIN(name, directory, filename) 	AT::instrumentor::get().begin_session(name, directory, filename)
+
+    // Begins a profiling session that only keeps the events of the last [window_seconds] in memory (0 = same as PROFILER_SESSION_BEGIN()).
+    // A trace is written by PROFILER_DUMP_TRACE(), the PROFILE_DUMP_TRACE_KEY hotkey or a frame exceeding PROFILE_FRAME_BUDGET_MS.
+    //
+    // Usage example:
+    //     PROFILER_SESSION_BEGIN_ROLLING("GameStartup", "profiling", "startup.json", 30);
+   	#define PROFILER_SESSION_BEGIN_ROLLING(name, directory, filename, window_seconds)	AT::instrumentor::get().begin_session(name, directory, filename, std::chrono::seconds(window_seconds))
+
+    // Requests a trace of the rolling window, written by the instrumentor writer thread.
+    //
+    // Usage example:
+    //     PROFILER_DUMP_TRACE("level loaded");
+   	#define PROFILER_DUMP_TRACE(reason) 						AT::instrumentor::get().request_trace_dump(reason)
+
+    // Marks the end of a frame and reports its work time (any std::chrono::duration), drives the per-frame statistics of the instrumentor.
+    // A frame over the budget is flagged and requests a trace of the rolling window.
+    //
+    // Usage example:
+    //     PROFILER_FRAME_END(std::chrono::duration<f32>(work_time_seconds));
+   	#define PROFILER_FRAME_END(work_time) 						AT::instrumentor::get().end_frame(std::chrono::duration_cast<std::chrono::nanoseconds>(work_time))
     
 	// Ends the currently active profiling session and closes the profiling result file.
     //
@@ -342,6 +556,25 @@ namespace AT {
     //     }
 	#define PROFILE_FUNCTION()                                	PROFILE_SCOPE(FUNC_SIG)
 
+    #if PROFILE_PERF_COUNTERS
+
+	    // Creates a profiling timer for the current scope that also records cycles, instructions, L1/LLC misses and context switches
+	    // (Linux perf_event_open) as args of the event, costs two system calls per scope.
+	    //
+	    // Usage example:
+	    //     PROFILE_SCOPE_COUNTERS("Physics Step");
+		#define PROFILE_SCOPE_COUNTERS(name)                     	PROFILE_SCOPE_COUNTERS_LINE(name, __LINE__)
+
+	    // Same as PROFILE_SCOPE_LINE() for PROFILE_SCOPE_COUNTERS(), [line] keeps the names of several scopes in one block apart.
+		#define PROFILE_SCOPE_COUNTERS_LINE(name, line)				constexpr auto PROFILE_CONCAT(fixed_name_counters, line) = name;    	AT::instrumentor_counter_timer PROFILE_CONCAT(benchmark_counter_timer, line)(PROFILE_CONCAT(fixed_name_counters, line))
+
+	#else
+		// DISABLED, to enable change [PROFILE_PERF_COUNTERS] in [util/core_config.h]
+		#define PROFILE_SCOPE_COUNTERS(name)                     	PROFILE_SCOPE(name)
+		// DISABLED, to enable change [PROFILE_PERF_COUNTERS] in [util/core_config.h]
+		#define PROFILE_SCOPE_COUNTERS_LINE(name, line)				PROFILE_SCOPE_LINE(name, line)
+	#endif
+
     // ------------------------------------ subsystem: application ------------------------------------ 
     #if PROFILE_APPLICATION
 
@@ -394,11 +627,21 @@ namespace AT {
 	// DISABLED, to enable change [PROFILE] in [util/core_config.h]
 	#define PROFILER_SESSION_BEGIN(name, directory, filename)
 	// DISABLED, to enable change [PROFILE] in [util/core_config.h]
+	#define PROFILER_SESSION_BEGIN_ROLLING(name, directory, filename, window_seconds)
+	// DISABLED, to enable change [PROFILE] in [util/core_config.h]
+	#define PROFILER_DUMP_TRACE(reason)
+	// DISABLED, to enable change [PROFILE] in [util/core_config.h]
+	#define PROFILER_FRAME_END(work_time)
+	// DISABLED, to enable change [PROFILE] in [util/core_config.h]
 	#define PROFILER_SESSION_END()
 	// DISABLED, to enable change [PROFILE] in [util/core_config.h]
 	#define PROFILE_SCOPE(name)
 	// DISABLED, to enable change [PROFILE] in [util/core_config.h]
 	#define PROFILE_FUNCTION()
+	// DISABLED, to enable change [PROFILE] in [util/core_config.h]
+	#define PROFILE_SCOPE_COUNTERS(name)
+	// DISABLED, to enable change [PROFILE] in [util/core_config.h]
+	#define PROFILE_SCOPE_COUNTERS_LINE(name, line)
 
 	// ------------------------------------ subsystem ------------------------------------ 
 
@@ -0,0 +1,151 @@
+#include "util/pch.h"
+
+#if defined(PLATFORM_LINUX)
+    #include <linux/perf_event.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+#include "perf_counters.h"
+
+
+namespace AT {
+
+    static constexpr size_t                                     perf_counter_count = static_cast<size_t>(perf_counter::count);
+
+#if defined(PLATFORM_LINUX)
+
+    // All counters of one thread in a single perf group, so one read() returns every value measured over the same period
+    struct perf_counter_group {
+
+        perf_counter_group() {
+
+            // hardware counters first, a software leader would move the whole group once a hardware counter joins
+            static constexpr std::pair<u32, u64> events[perf_counter_count] = {
+                { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+                { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+                { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+                { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+                { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+            };
+
+            for (size_t x = 0; x < perf_counter_count; x++) {
+
+                const int fd = open_counter(events[x].first, events[x].second);
+                if (fd < 0) {
+                    last_error = errno;
+                    continue;
+                }
+
+                if (leader < 0)
+                    leader = fd;
+                fds[opened] = fd;
+                order[opened++] = static_cast<perf_counter>(x);
+            }
+        }
+
+        ~perf_counter_group() {
+
+            for (size_t x = 0; x < opened; x++)
+                close(fds[x]);
+        }
+
+        // counts the calling thread on every CPU, the kernel part is only included if perf_event_paranoid permits it
+        int open_counter(const u32 type, const u64 config) const {
+
+            perf_event_attr attributes{};
+            attributes.size = sizeof(attributes);
+            attributes.type = type;
+            attributes.config = config;
+            attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attributes.exclude_hv = 1;
+            for (const u64 exclude_kernel : { 0, 1 }) {
+
+                attributes.exclude_kernel = exclude_kernel;
+                const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, leader, 0));
+                if (fd >= 0 || (errno != EACCES && errno != EPERM))
+                    return fd;
+            }
+            return -1;
+        }
+
+        int                                                     leader = -1;
+        size_t                                                  opened = 0;
+        int                                                     last_error = 0;
+        std::array<int, perf_counter_count>                     fds{};
+        std::array<perf_counter, perf_counter_count>            order{};    // counter of every opened fd, the order of the values in a group read
+    };
+
+    static thread_local std::optional<perf_counter_group>       t_perf_counters{};
+
+
+    bool read_perf_counters(perf_counter_values& values) {
+
+        if (!t_perf_counters) {
+
+            t_perf_counters.emplace();
+            static std::once_flag s_logged{};
+            if (t_perf_counters->opened == 0)
+                std::call_once(s_logged, [error = t_perf_counters->last_error]() {
+                    LOG(Warn, "No performance counter could be opened (" << std::strerror(error) << "), check [/proc/sys/kernel/perf_event_paranoid] and the PMU support of the machine");
+                });
+        }
+
+        if (t_perf_counters->opened == 0)
+            return false;
+
+        u64 loc_buffer[3 + perf_counter_count];                 // { nr, time_enabled, time_running, value[nr] }
+        if (read(t_perf_counters->leader, loc_buffer, sizeof(loc_buffer)) <= 0)
+            return false;
+
+        values.time_enabled_ns = loc_buffer[1];
+        values.time_running_ns = loc_buffer[2];
+        values.valid_mask = 0;
+        const size_t count = std::min<size_t>(loc_buffer[0], t_perf_counters->opened);
+        for (size_t x = 0; x < count; x++) {
+
+            const perf_counter counter = t_perf_counters->order[x];
+            values.values[static_cast<size_t>(counter)] = loc_buffer[3 + x];
+            values.valid_mask |= static_cast<u8>(1u << static_cast<u8>(counter));
+        }
+        return true;
+    }
+
+#else
+
+    bool read_perf_counters(perf_counter_values& values) {
+
+        static std::once_flag s_logged{};
+        std::call_once(s_logged, []() { LOG(Warn, "Performance counters are only supported on Linux (perf_event_open)"); });
+        return false;
+    }
+
+#endif
+
+
+    perf_counter_values perf_counter_delta(const perf_counter_values& begin, const perf_counter_values& end) {
+
+        perf_counter_values delta{};
+        delta.valid_mask = begin.valid_mask & end.valid_mask;
+        delta.time_enabled_ns = end.time_enabled_ns - begin.time_enabled_ns;
+        delta.time_running_ns = end.time_running_ns - begin.time_running_ns;
+
+        // the whole group is scheduled together, so the times of the group apply to every counter
+        if (delta.is_scaled() && delta.time_running_ns == 0)
+            delta.valid_mask = 0;
+
+        for (size_t x = 0; x < perf_counter_count; x++) {
+
+            if ((delta.valid_mask & (1u << x)) == 0) {
+                delta.values[x] = 0;
+                continue;
+            }
+
+            delta.values[x] = end.values[x] - begin.values[x];
+            if (delta.is_scaled())
+                delta.values[x] = static_cast<u64>(static_cast<f64>(delta.values[x]) * static_cast<f64>(delta.time_enabled_ns) / static_cast<f64>(delta.time_running_ns));
+        }
+        return delta;
+    }
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "util/data_structures/data_types.h"
+
+// Per-thread hardware/software performance counters (Linux perf_event_open), recorded by PROFILE_SCOPE_COUNTERS()
+namespace AT {
+
+    enum class perf_counter : u8 {
+        cycles,                     // CPU cycles spent by the thread (user and kernel if permitted)
+        instructions,               // retired instructions, instructions / cycles = IPC
+        l1d_misses,                 // L1 data cache read misses
+        llc_misses,                 // last level cache misses
+        context_switches,           // the thread was descheduled (software counter, available without a PMU)
+        count
+    };
+
+    constexpr const char*           perf_counter_names[static_cast<size_t>(perf_counter::count)] = { "cycles", "instructions", "l1d_misses", "llc_misses", "context_switches" };
+
+
+    // Values of every counter, counters that could not be opened (e.g. no PMU in a virtual machine) are not part of [valid_mask]
+    struct perf_counter_values {
+
+        bool is_valid(const perf_counter counter) const { return (valid_mask & (1u << static_cast<u8>(counter))) != 0; }
+
+        u64 get(const perf_counter counter) const { return values[static_cast<size_t>(counter)]; }
+
+        // The kernel multiplexed the counters (more events than hardware counters), the values are scaled estimates.
+        bool is_scaled() const { return time_running_ns < time_enabled_ns; }
+
+        std::array<u64, static_cast<size_t>(perf_counter::count)>  values{};
+        u64                                                         time_enabled_ns = 0;    // how long the counters were enabled / actually counted,
+        u64                                                         time_running_ns = 0;    // they differ if the PMU multiplexed the group
+        u8                                                          valid_mask = 0;
+    };
+
+
+    // Reads the counters of the calling thread, they are opened with perf_event_open() on the first call of every thread and read
+    // with a single system call afterwards.
+    // @note the first thread that finds no counter at all logs why once (not Linux, kernel without perf support, perf_event_paranoid)
+    // @return false if no counter is available, [values] is unchanged then
+    bool read_perf_counters(perf_counter_values& values);
+
+    // @return [end] - [begin] of every counter valid in both. If the group only counted for part of the interval the differences are
+    //         scaled by enabled / running time (is_scaled()), if it did not count at all every counter is invalid.
+    perf_counter_values perf_counter_delta(const perf_counter_values& begin, const perf_counter_values& end);
+
+}
@@ -0,0 +1,310 @@
+#include "util/pch.h"
+
+#include "trace_format.h"
+
+
+namespace AT {
+
+    static constexpr std::string_view                           json_trace_header = "{\"otherData\": {},\"traceEvents\":[{}";
+    static constexpr std::string_view                           json_trace_footer = "]}";
+
+
+    static void append_varint(std::string& output, u64 value) {
+
+        while (value >= 0x80) {
+            output.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        output.push_back(static_cast<char>(value));
+    }
+
+
+    static u64 zigzag_encode(const int64 value) { return (static_cast<u64>(value) << 1) ^ static_cast<u64>(value >> 63); }
+
+    static int64 zigzag_decode(const u64 value) { return static_cast<int64>(value >> 1) ^ -static_cast<int64>(value & 1); }
+
+
+    // appends [nanoseconds] as microseconds with three decimals (the unit of the Chrome trace format)
+    static void append_microseconds(std::string& output, const u64 nanoseconds) {
+
+        char loc_buffer[32];
+        char* end = std::to_chars(loc_buffer, loc_buffer + sizeof(loc_buffer), nanoseconds / 1000).ptr;
+        const u64 fraction = nanoseconds % 1000;
+        *end++ = '.';
+        *end++ = static_cast<char>('0' + fraction / 100);
+        *end++ = static_cast<char>('0' + (fraction / 10) % 10);
+        *end++ = static_cast<char>('0' + fraction % 10);
+        output.append(loc_buffer, end);
+    }
+
+
+    static void append_json_number(std::string& output, const u64 value) {
+
+        char loc_buffer[24];
+        output.append(loc_buffer, std::to_chars(loc_buffer, loc_buffer + sizeof(loc_buffer), value).ptr);
+    }
+
+
+    static void append_json_string(std::string& output, const char* text) {
+
+        for (; *text != '\0'; text++) {
+            if (*text == '"' || *text == '\\')
+                output.push_back('\\');
+            output.push_back(*text);
+        }
+    }
+
+    // ==================================================================== trace_encoder ====================================================================
+
+    void trace_encoder::reset() {
+
+        m_name_ids.clear();
+        m_name_ids_by_content.clear();
+        m_threads.clear();
+    }
+
+
+    void trace_encoder::append_header(std::string& output) const {
+
+        if (m_format == trace_format::json) {
+            output.append(json_trace_header);
+            return;
+        }
+
+        output.append(binary_trace_magic, sizeof(binary_trace_magic));
+        output.append(reinterpret_cast<const char*>(&binary_trace_version), sizeof(binary_trace_version));
+    }
+
+
+    void trace_encoder::append_event(std::string& output, const profile_event& event, const std::string* thread_id, const perf_counter_values* counters) {
+
+        if (counters && counters->valid_mask == 0)
+            counters = nullptr;
+
+        if (m_format == trace_format::json) {
+
+            output.append(",{\"cat\":\"function\",\"dur\":");
+            append_microseconds(output, event.duration_ns);
+            output.append(",\"name\":\"");
+            append_json_string(output, event.name);
+            output.append("\",\"ph\":\"X\",\"pid\":0,\"tid\":");
+            output.append(*thread_id);
+            output.append(",\"ts\":");
+            append_microseconds(output, event.start_ns);
+            if (counters || event.allocations != 0) {
+
+                char separator = '{';
+                output.append(",\"args\":");
+                if (event.allocations != 0) {
+                    output.append("{\"allocations\":");
+                    append_json_number(output, event.allocations);
+                    output.append(",\"allocated_bytes\":");
+                    append_json_number(output, event.allocated_bytes);
+                    separator = ',';
+                }
+
+                for (size_t x = 0; counters && x < static_cast<size_t>(perf_counter::count); x++) {
+                    if (!counters->is_valid(static_cast<perf_counter>(x)))
+                        continue;
+
+                    output.push_back(separator);
+                    output.push_back('"');
+                    output.append(perf_counter_names[x]);
+                    output.append("\":");
+                    append_json_number(output, counters->values[x]);
+                    separator = ',';
+                }
+                output.push_back('}');
+            }
+            output.push_back('}');
+            return;
+        }
+
+        auto name_it = m_name_ids.find(event.name);
+        if (name_it == m_name_ids.end()) {
+
+            const std::string_view name(event.name);
+            auto [content_it, inserted] = m_name_ids_by_content.try_emplace(name, static_cast<u32>(m_name_ids_by_content.size()));
+            if (inserted) {
+                output.push_back(static_cast<char>(trace_record::name));
+                append_varint(output, content_it->second);
+                append_varint(output, name.size());
+                output.append(name);
+            }
+            name_it = m_name_ids.emplace(event.name, content_it->second).first;
+        }
+
+        auto thread_it = m_threads.find(thread_id);
+        if (thread_it == m_threads.end()) {
+
+            const u32 id = static_cast<u32>(m_threads.size());
+            output.push_back(static_cast<char>(trace_record::thread));
+            append_varint(output, id);
+            append_varint(output, thread_id->size());
+            output.append(*thread_id);
+            thread_it = m_threads.emplace(thread_id, thread_state{ id, 0 }).first;
+        }
+
+        if (event.allocations != 0) {
+            output.push_back(static_cast<char>(trace_record::allocations));
+            append_varint(output, event.allocations);
+            append_varint(output, event.allocated_bytes);
+        }
+
+        output.push_back(static_cast<char>(counters ? trace_record::counters : trace_record::event));
+        append_varint(output, thread_it->second.id);
+        append_varint(output, name_it->second);
+        append_varint(output, zigzag_encode(static_cast<int64>(event.start_ns - thread_it->second.previous_start_ns)));
+        append_varint(output, event.duration_ns);
+        thread_it->second.previous_start_ns = event.start_ns;
+        if (!counters)
+            return;
+
+        append_varint(output, counters->valid_mask);
+        for (size_t x = 0; x < static_cast<size_t>(perf_counter::count); x++)
+            if (counters->is_valid(static_cast<perf_counter>(x)))
+                append_varint(output, counters->values[x]);
+    }
+
+
+    void trace_encoder::append_footer(std::string& output) const {
+
+        if (m_format == trace_format::json)
+            output.append(json_trace_footer);
+    }
+
+    // ==================================================================== reader ====================================================================
+
+    static bool read_varint(const char*& cursor, const char* end, u64& value) {
+
+        value = 0;
+        for (u32 shift = 0; cursor < end && shift < 64; shift += 7) {
+
+            const u8 byte = static_cast<u8>(*cursor++);
+            value |= static_cast<u64>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+
+
+    // Decodes every record of a binary trace, names and threads are kept in node based containers so the pointers handed to [callback] stay valid
+    static bool read_trace_records(const std::filesystem::path& path, const std::function<bool(const profile_event&, const std::string&, const perf_counter_values*)>& callback) {
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        constexpr size_t header_size = sizeof(binary_trace_magic) + sizeof(binary_trace_version);
+        if (data.size() < header_size || std::memcmp(data.data(), binary_trace_magic, sizeof(binary_trace_magic)) != 0)
+            return false;
+
+        u32 version = 0;
+        std::memcpy(&version, data.data() + sizeof(binary_trace_magic), sizeof(version));
+        if (version == 0 || version > binary_trace_version)
+            return false;
+
+        std::deque<std::string> names{};
+        std::deque<std::string> threads{};
+        std::vector<u64> previous_starts{};
+        u64 allocations = 0, allocated_bytes = 0;                                   // of the next event
+        const char* cursor = data.data() + header_size;
+        const char* end = data.data() + data.size();
+        while (cursor < end) {
+
+            const trace_record type = static_cast<trace_record>(*cursor++);
+            switch (type) {
+
+                case trace_record::name:
+                case trace_record::thread: {
+                    u64 id = 0, length = 0;
+                    if (!read_varint(cursor, end, id) || !read_varint(cursor, end, length) || static_cast<u64>(end - cursor) < length)
+                        return true;                                                // cut off
+
+                    auto& table = (type == trace_record::name) ? names : threads;
+                    if (id != table.size())
+                        return false;
+
+                    table.emplace_back(cursor, static_cast<size_t>(length));
+                    if (type == trace_record::thread)
+                        previous_starts.push_back(0);
+                    cursor += length;
+                } break;
+
+                case trace_record::event:
+                case trace_record::counters: {
+                    u64 thread_id = 0, name_id = 0, start_delta = 0, duration = 0;
+                    if (!read_varint(cursor, end, thread_id) || !read_varint(cursor, end, name_id) || !read_varint(cursor, end, start_delta) || !read_varint(cursor, end, duration))
+                        return true;                                                // cut off
+
+                    if (thread_id >= threads.size() || name_id >= names.size())
+                        return false;
+
+                    perf_counter_values counters{};
+                    if (type == trace_record::counters) {
+
+                        u64 valid_mask = 0;
+                        if (!read_varint(cursor, end, valid_mask))
+                            return true;
+
+                        counters.valid_mask = static_cast<u8>(valid_mask);
+                        for (size_t x = 0; x < static_cast<size_t>(perf_counter::count); x++)
+                            if (counters.is_valid(static_cast<perf_counter>(x)) && !read_varint(cursor, end, counters.values[x]))
+                                return true;
+                    }
+
+                    const u64 start = previous_starts[thread_id] + static_cast<u64>(zigzag_decode(start_delta));
+                    previous_starts[thread_id] = start;
+                    const profile_event event{ names[name_id].c_str(), start, duration, allocated_bytes, static_cast<u32>(allocations) };
+                    allocations = allocated_bytes = 0;
+                    if (!callback(event, threads[thread_id], (type == trace_record::counters) ? &counters : nullptr))
+                        return true;
+                } break;
+
+                case trace_record::allocations: {
+                    if (!read_varint(cursor, end, allocations) || !read_varint(cursor, end, allocated_bytes))
+                        return true;                                                // cut off
+                } break;
+
+                default: return false;
+            }
+        }
+        return true;
+    }
+
+
+    bool read_binary_trace(const std::filesystem::path& path, const std::function<bool(const trace_event&)>& callback) {
+
+        return read_trace_records(path, [&callback](const profile_event& event, const std::string& thread, const perf_counter_values* counters) {
+            return callback(trace_event{ event.name, thread, event.start_ns, event.duration_ns, counters ? *counters : perf_counter_values{}, event.allocated_bytes, event.allocations });
+        });
+    }
+
+
+    bool convert_binary_trace(const std::filesystem::path& input, const std::filesystem::path& output) {
+
+        std::ofstream file(output, std::ios::trunc);
+        if (!file.is_open())
+            return false;
+
+        trace_encoder encoder(trace_format::json);
+        std::string buffer{};
+        encoder.append_header(buffer);
+        const bool success = read_trace_records(input, [&](const profile_event& event, const std::string& thread, const perf_counter_values* counters) {
+
+            encoder.append_event(buffer, event, &thread, counters);
+            if (buffer.size() >= 1024 * 1024) {
+                file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                buffer.clear();
+            }
+            return true;
+        });
+
+        encoder.append_footer(buffer);
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        return success && file.good();
+    }
+
+}
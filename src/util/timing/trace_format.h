@@ -0,0 +1,105 @@
+#pragma once
+
+#include "util/data_structures/data_types.h"
+#include "util/timing/perf_counters.h"
+
+// Encoding of the profiler traces written by the instrumentor and reading back the binary format
+namespace AT {
+
+    // A single profiled scope, fixed size so it can be copied into the per-thread buffer without allocating
+    struct profile_event {
+        const char*                 name;                           // Name of the profiled function or block, has to outlive the session (string literal).
+        u64                         start_ns;                       // steady_clock timestamp when the scope began, in nanoseconds.
+        u64                         duration_ns;                    // Duration of the profiled section, in nanoseconds.
+        u64                         allocated_bytes;                // Bytes requested from operator new while the scope was open, including nested scopes (PROFILE_ALLOCATIONS).
+        u32                         allocations;                    // Calls of operator new while the scope was open.
+    };
+
+
+    enum class trace_format : u8 {
+        json,                       // Chrome trace JSON (chrome://tracing, ui.perfetto.dev), readable but every event repeats its name
+        binary,                     // compact records described below, convert with convert_binary_trace() or the trace_converter tool
+    };
+
+
+    // Binary layout
+    //  file header:    "ATTRACE" + '\0' (8 bytes) + u32 version
+    //  every record:   u8 type followed by unsigned LEB128 varints
+    //      name        [varint id][varint length][bytes]           emitted before the first event that uses the name
+    //      thread      [varint id][varint length][bytes]           emitted before the first event of the thread
+    //      event       [varint thread id][varint name id][zigzag varint start delta][varint duration]
+    //                  the start is the difference to the start of the previous event of the same thread (absolute for the first one),
+    //                  all times are nanoseconds
+    //      counters    an event followed by [varint valid mask][varint value] for every valid perf_counter in enum order (version 2)
+    //      allocations [varint count][varint bytes]                  emitted before the event or counters record of a scope that allocated (version 3)
+    // @note the file header is written in the byte order of the machine that wrote the trace, all varints are byte order independent
+    constexpr char                  binary_trace_magic[8] = { 'A', 'T', 'T', 'R', 'A', 'C', 'E', '\0' };
+    constexpr u32                   binary_trace_version = 3;           // older traces (without counter or allocation records) are still read
+    constexpr const char*           binary_trace_extension = ".attrace";
+
+    enum class trace_record : u8 {
+        name = 1,
+        thread = 2,
+        event = 3,
+        counters = 4,
+        allocations = 5,
+    };
+
+
+    // Turns profile events into the bytes of a trace file, names and threads are interned per trace (call reset() for a new file)
+    class trace_encoder {
+    public:
+
+        explicit trace_encoder(const trace_format format = trace_format::json)
+            : m_format(format) {}
+
+        trace_format get_format() const { return m_format; }
+
+        // Forgets all interned names and threads, the next output is the start of a new file
+        void reset();
+
+        void append_header(std::string& output) const;
+
+        // @param thread_id formatted thread id, has to stay valid until reset() (the instrumentor interns them for the whole process)
+        // @param counters written as args of the event (JSON) or as a counters record (binary), nullptr or no valid counter = plain event
+        // @note allocations of the event are written as args too (JSON) or as an allocations record in front of the event (binary)
+        void append_event(std::string& output, const profile_event& event, const std::string* thread_id, const perf_counter_values* counters = nullptr);
+
+        void append_footer(std::string& output) const;
+
+    private:
+
+        struct thread_state {
+            u32                                                 id;
+            u64                                                 previous_start_ns;
+        };
+
+        trace_format                                            m_format;
+        std::unordered_map<const char*, u32>                    m_name_ids{};               // by address, the fast path for string literals
+        std::unordered_map<std::string_view, u32>               m_name_ids_by_content{};    // the same name at a different address (e.g. another translation unit)
+        std::unordered_map<const std::string*, thread_state>    m_threads{};
+    };
+
+
+    // One event of a trace read by read_binary_trace()
+    // @note the strings point into the reader and are only valid inside the callback
+    struct trace_event {
+        std::string_view            name{};
+        std::string_view            thread{};
+        u64                         start_ns = 0;
+        u64                         duration_ns = 0;
+        perf_counter_values         counters{};                     // valid_mask is 0 for events without counters
+        u64                         allocated_bytes = 0;
+        u32                         allocations = 0;
+    };
+
+    // Calls [callback] for every event of a binary trace, the callback can return false to stop reading.
+    // @note a record that was cut off at the end of the file (e.g. after a crash) is ignored
+    // @return false if the file could not be opened or is not a valid binary trace
+    bool read_binary_trace(const std::filesystem::path& path, const std::function<bool(const trace_event&)>& callback);
+
+    // Converts a binary trace into the Chrome trace JSON that the instrumentor writes with trace_format::json.
+    // @return false if [input] could not be read or [output] could not be written
+    bool convert_binary_trace(const std::filesystem::path& input, const std::filesystem::path& output);
+
+}
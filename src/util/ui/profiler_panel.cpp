@@ -0,0 +1,246 @@
+#include "util/pch.h"
+
+#include <imgui.h>
+#include <implot.h>
+
+#include "application.h"
+#include "render/renderer.h"
+
+#include "profiler_panel.h"
+
+
+namespace AT::UI {
+
+	// how often the frames and statistics are copied from the instrumentor, every UI frame would make the table unreadable
+	static constexpr f64 		refresh_interval_seconds = 0.25;
+
+	static constexpr f32 		ns_to_ms = 1.f / 1000000.f;
+
+
+	// stable color per scope name, so the same scope is recognizable across frames
+	static ImU32 scope_color(const char* name) {
+
+		const size_t hash = std::hash<std::string_view>{}(name);
+		return ImColor::HSV(static_cast<f32>(hash % 360) / 360.f, 0.45f, 0.75f);
+	}
+
+
+	void profiler_panel::draw(bool* open) {
+
+		PROFILE_APPLICATION_FUNCTION();
+
+		if (!ImGui::Begin("Profiler", open)) {
+			ImGui::End();
+			return;
+		}
+
+		if (!m_pause && ImGui::GetTime() - m_last_refresh >= refresh_interval_seconds) {
+
+			m_last_refresh = ImGui::GetTime();
+			m_frames = instrumentor::get().get_frames();
+			m_frame = instrumentor::get().get_latest_frame(m_frame_events);
+			m_scope_stats = instrumentor::get().get_scope_stats();
+			sort_scope_stats();
+		}
+
+		ImGui::Text("%.1f FPS", ImGui::GetIO().Framerate);
+		ImGui::SameLine();
+		ImGui::TextDisabled("|  frames over budget: %llu  |  dropped events: %llu", static_cast<unsigned long long>(instrumentor::get().get_frames_over_budget()),
+			static_cast<unsigned long long>(instrumentor::get().get_dropped_events()));
+		ImGui::SameLine();
+		ImGui::Checkbox("Pause", &m_pause);
+		ImGui::SameLine();
+		if (ImGui::Button("Dump trace"))
+			PROFILER_DUMP_TRACE("dashboard");
+
+		if (ImGui::CollapsingHeader("Frame times", ImGuiTreeNodeFlags_DefaultOpen))
+			draw_frame_graphs();
+
+		if (ImGui::CollapsingHeader("Latest frame", ImGuiTreeNodeFlags_DefaultOpen))
+			draw_flame_graph();
+
+		if (ImGui::CollapsingHeader("Scopes", ImGuiTreeNodeFlags_DefaultOpen))
+			draw_scope_table();
+
+		ImGui::End();
+	}
+
+
+	void profiler_panel::draw_frame_graphs() {
+
+		const f64 budget_ms = static_cast<f64>(instrumentor::get().get_frame_budget().count()) / 1000.;
+		render::general_performance_metrik& metrik = application::get().get_renderer()->get_general_performance_metrik_ref();
+		const int count = static_cast<int>(metrik.get_array_size());
+
+		// the arrays are ring buffers, [current_index] is the next slot to write and therefore the oldest value
+		if (ImPlot::BeginPlot("##renderer_frame_times", ImVec2(-1, 180))) {
+
+			ImPlot::SetupAxes(nullptr, "ms", ImPlotAxisFlags_NoTickLabels, ImPlotAxisFlags_AutoFit);
+			ImPlot::SetupAxisLimits(ImAxis_X1, 0, count - 1, ImPlotCond_Always);
+			ImPlot::PlotLine("work", metrik.work_time_history, count, 1., 0., 0, metrik.current_index);
+			ImPlot::PlotLine("renderer draw", metrik.renderer_draw_time, count, 1., 0., 0, metrik.current_index);
+			ImPlot::PlotLine("waiting idle", metrik.waiting_idle_time, count, 1., 0., 0, metrik.current_index);
+			if (budget_ms > 0.)
+				ImPlot::PlotInfLines("budget", &budget_ms, 1, ImPlotInfLinesFlags_Horizontal);
+			ImPlot::EndPlot();
+		}
+
+		// frames the instrumentor evaluated, the same ones the scope table is based on
+		m_frame_work_ms.assign(m_frames.size(), 0.f);
+		m_frame_over_budget_ms.assign(m_frames.size(), 0.f);
+		for (size_t x = 0; x < m_frames.size(); x++)
+			(m_frames[x].over_budget ? m_frame_over_budget_ms : m_frame_work_ms)[x] = static_cast<f32>(m_frames[x].work_ns) * ns_to_ms;
+
+		if (ImPlot::BeginPlot("##instrumentor_frames", ImVec2(-1, 120))) {
+
+			ImPlot::SetupAxes(nullptr, "ms", ImPlotAxisFlags_NoTickLabels, ImPlotAxisFlags_AutoFit);
+			ImPlot::SetupAxisLimits(ImAxis_X1, -1, PROFILE_FRAME_STATS_WINDOW, ImPlotCond_Always);
+			ImPlot::PlotBars("frame work", m_frame_work_ms.data(), static_cast<int>(m_frame_work_ms.size()), 1.);
+			ImPlot::PlotBars("over budget", m_frame_over_budget_ms.data(), static_cast<int>(m_frame_over_budget_ms.size()), 1.);
+			if (budget_ms > 0.)
+				ImPlot::PlotInfLines("budget", &budget_ms, 1, ImPlotInfLinesFlags_Horizontal);
+			ImPlot::EndPlot();
+		}
+	}
+
+
+	void profiler_panel::draw_flame_graph() {
+
+		if (m_frame.duration_ns == 0) {
+			ImGui::TextDisabled("No frame evaluated yet (needs an active profiler session and PROFILER_FRAME_END())");
+			return;
+		}
+
+		ImGui::Text("Frame %llu: %.3f ms, work %.3f ms%s", static_cast<unsigned long long>(m_frame.index), static_cast<f32>(m_frame.duration_ns) * ns_to_ms,
+			static_cast<f32>(m_frame.work_ns) * ns_to_ms, m_frame.over_budget ? "  (over budget)" : "");
+
+		ImDrawList* draw_list = ImGui::GetWindowDrawList();
+		const f32 row_height = ImGui::GetTextLineHeightWithSpacing();
+		const f32 width = std::max(ImGui::GetContentRegionAvail().x, 1.f);
+		const f64 pixel_per_ns = width / static_cast<f64>(m_frame.duration_ns);
+		const ImU32 text_color = ImGui::GetColorU32(ImGuiCol_Text);
+
+		// [m_frame_events] is ordered by thread and start, parents before their children
+		for (size_t begin = 0; begin < m_frame_events.size();) {
+
+			const std::string* thread_id = m_frame_events[begin].thread_id;
+			ImGui::TextDisabled("thread %s", thread_id->c_str());
+
+			const ImVec2 origin = ImGui::GetCursorScreenPos();
+			size_t rows = 0;
+			m_open_scopes.clear();
+			size_t end = begin;
+			for (; end < m_frame_events.size() && m_frame_events[end].thread_id == thread_id; end++) {
+
+				const profile_event& event = m_frame_events[end].event;
+				while (!m_open_scopes.empty() && m_open_scopes.back() <= event.start_ns)
+					m_open_scopes.pop_back();
+
+				const size_t depth = m_open_scopes.size();
+				m_open_scopes.push_back(event.start_ns + event.duration_ns);
+				rows = std::max(rows, depth + 1);
+
+				// scopes that close after the frame boundary (e.g. the main loop) are cut at the end of the frame
+				const f32 left = origin.x + static_cast<f32>(static_cast<f64>(event.start_ns - m_frame.start_ns) * pixel_per_ns);
+				const f32 right = std::min(origin.x + width, std::max(left + 1.f, origin.x + static_cast<f32>(static_cast<f64>(event.start_ns + event.duration_ns - m_frame.start_ns) * pixel_per_ns)));
+				const ImVec2 rect_min(left, origin.y + depth * row_height);
+				const ImVec2 rect_max(right, rect_min.y + row_height - 1.f);
+				draw_list->AddRectFilled(rect_min, rect_max, scope_color(event.name));
+				if (rect_max.x - rect_min.x > 20.f) {
+					draw_list->PushClipRect(rect_min, rect_max, true);
+					draw_list->AddText(ImVec2(rect_min.x + 3.f, rect_min.y), text_color, event.name);
+					draw_list->PopClipRect();
+				}
+
+				if (ImGui::IsMouseHoveringRect(rect_min, rect_max))
+					ImGui::SetTooltip("%s\n%.3f ms\n%u allocations, %llu bytes", event.name, static_cast<f32>(event.duration_ns) * ns_to_ms, event.allocations,
+						static_cast<unsigned long long>(event.allocated_bytes));
+			}
+
+			ImGui::Dummy(ImVec2(width, rows * row_height));
+			begin = end;
+		}
+	}
+
+
+	void profiler_panel::draw_scope_table() {
+
+		const ImGuiTableFlags flags = ImGuiTableFlags_Sortable | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY;
+		if (!ImGui::BeginTable("##scopes", 9, flags, ImVec2(0, 300)))
+			return;
+
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("Scope", ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableSetupColumn("Frames", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableSetupColumn("Calls/frame", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableSetupColumn("Min (ms)", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableSetupColumn("Avg (ms)", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+		ImGui::TableSetupColumn("P99 (ms)", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_PreferSortDescending);
+		ImGui::TableSetupColumn("Max (ms)", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_PreferSortDescending);
+		ImGui::TableSetupColumn("Allocs/frame", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_PreferSortDescending);
+		ImGui::TableSetupColumn("Bytes/frame", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_PreferSortDescending);
+		ImGui::TableHeadersRow();
+
+		if (ImGuiTableSortSpecs* sort_specs = ImGui::TableGetSortSpecs(); sort_specs && sort_specs->SpecsDirty) {
+
+			if (sort_specs->SpecsCount > 0) {
+				m_sort_column = sort_specs->Specs[0].ColumnIndex;
+				m_sort_ascending = sort_specs->Specs[0].SortDirection == ImGuiSortDirection_Ascending;
+			}
+			sort_scope_stats();
+			sort_specs->SpecsDirty = false;
+		}
+
+		const u64 budget_ns = static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(instrumentor::get().get_frame_budget()).count());
+		const ImVec4 over_budget_color(0.9f, 0.3f, 0.3f, 1.f);
+		for (const profile_scope_stats& stats : m_scope_stats) {
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();	ImGui::TextUnformatted(stats.name.c_str());
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("%s", stats.name.c_str());
+
+			ImGui::TableNextColumn();	ImGui::Text("%u", stats.frames);
+			ImGui::TableNextColumn();	ImGui::Text("%.2f", stats.calls_per_frame);
+			ImGui::TableNextColumn();	ImGui::Text("%.3f", static_cast<f32>(stats.min_ns) * ns_to_ms);
+			ImGui::TableNextColumn();	ImGui::Text("%.3f", static_cast<f32>(stats.avg_ns) * ns_to_ms);
+			ImGui::TableNextColumn();	ImGui::Text("%.3f", static_cast<f32>(stats.p99_ns) * ns_to_ms);
+			ImGui::TableNextColumn();
+			if (budget_ns != 0 && stats.max_ns > budget_ns)
+				ImGui::TextColored(over_budget_color, "%.3f", static_cast<f32>(stats.max_ns) * ns_to_ms);
+			else
+				ImGui::Text("%.3f", static_cast<f32>(stats.max_ns) * ns_to_ms);
+
+			// includes the allocations of nested scopes, like the times
+			ImGui::TableNextColumn();	ImGui::Text("%.1f", stats.allocations_per_frame);
+			ImGui::TableNextColumn();	ImGui::Text("%.0f", stats.allocated_bytes_per_frame);
+		}
+
+		ImGui::EndTable();
+	}
+
+
+	void profiler_panel::sort_scope_stats() {
+
+		const auto key = [this](const profile_scope_stats& stats) -> f64 {
+			switch (m_sort_column) {
+				case 1:		return static_cast<f64>(stats.frames);
+				case 2:		return stats.calls_per_frame;
+				case 3:		return static_cast<f64>(stats.min_ns);
+				case 5:		return static_cast<f64>(stats.p99_ns);
+				case 6:		return static_cast<f64>(stats.max_ns);
+				case 7:		return stats.allocations_per_frame;
+				case 8:		return stats.allocated_bytes_per_frame;
+				default:
+				case 4:		return static_cast<f64>(stats.avg_ns);
+			}
+		};
+
+		std::sort(m_scope_stats.begin(), m_scope_stats.end(), [&](const profile_scope_stats& left, const profile_scope_stats& right) {
+			if (m_sort_column == 0)
+				return m_sort_ascending ? left.name < right.name : left.name > right.name;
+			return m_sort_ascending ? key(left) < key(right) : key(left) > key(right);
+		});
+	}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "util/timing/instrumentor.h"
+
+
+namespace AT::UI {
+
+	// Window to diagnose hitches without leaving the application:
+	//  - frame-time graphs of the renderer (render::general_performance_metrik) and of the frames reported to the instrumentor
+	//  - flame graph of the latest frame the instrumentor evaluated, one block of rows per thread
+	//  - table of every profiled scope with min/avg/p99/max time and the allocations per frame over PROFILE_FRAME_STATS_WINDOW frames
+	// @note the instrumentor parts need an active profiler session and frames reported with PROFILER_FRAME_END()
+	class profiler_panel {
+	public:
+
+		// Draws the panel as a dockable window, call between ImGui::NewFrame() and ImGui::Render().
+		// @param open set to false when the window is closed, nullptr hides the close button
+		void draw(bool* open = nullptr);
+
+	private:
+
+		void draw_frame_graphs();
+
+		void draw_flame_graph();
+
+		void draw_scope_table();
+
+		// Sorts [m_scope_stats] by the column selected in the table header.
+		void sort_scope_stats();
+
+		bool 											m_pause = false;				// Keeps the displayed frame and statistics.
+		f64 											m_last_refresh = 0.;			// ImGui time of the last copy from the instrumentor.
+		profile_frame 									m_frame{};						// Frame shown in the flame graph.
+		std::vector<instrumentor::captured_event> 		m_frame_events{};
+		std::vector<profile_frame> 						m_frames{};
+		std::vector<profile_scope_stats> 				m_scope_stats{};
+		std::vector<f32> 								m_frame_work_ms{};				// Bars of the instrumentor frames, split by budget.
+		std::vector<f32> 								m_frame_over_budget_ms{};
+		std::vector<u64> 								m_open_scopes{};				// End times of the parents while laying out the flame graph.
+		int16 											m_sort_column = 4;				// Column of profile_scope_stats::avg_ns.
+		bool 											m_sort_ascending = false;
+	};
+
+}
@@ -12,11 +12,24 @@
 #include "util/io/serializer_yaml.h"
 #include "util/io/serializer_binary.h"
 #include "util/timing/stopwatch.h"
+#include "util/timing/instrumentor.h"
+#include "util/io/io.h"
+#include "util/io/log_reader.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_ZLIB
+#define STBI_SUPPORT_ZLIB
+#include <stb_image.h>                                              // only the zlib decoder, used to verify compressed files
 
 #if PLATFORM_WINDOWS
     #include <numeric> 
 #endif
 
+#if defined(PLATFORM_LINUX)
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
 
 // ==============================================================================================================================
 // RANDOM
@@ -595,6 +608,840 @@ TEST_CASE("Logger Stress Test", "[logger][stress]") {
 }
 
 
+TEST_CASE("Logger Message Ordering", "[logger][multithreading]") {
+    std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "logger_order_test";
+    std::filesystem::create_directories(test_dir);
+
+    REQUIRE(AT::logger::init("$C$Z", false, test_dir, "test_order.log"));
+
+    const int num_threads = 8;
+    const int messages_per_thread = 5000;                           // more than one ring buffer can hold, forces the overflow path
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back([i]() {
+            for (int j = 0; j < messages_per_thread; j++)
+                LOG_Info("T" << i << " M" << j);
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    REQUIRE_NOTHROW(AT::logger::shutdown());
+
+    // every message must be present exactly once and in the order it was logged by its thread
+    std::ifstream log_file(test_dir / "test_order.log");
+    std::vector<int> next_expected(num_threads, 0);
+    std::string line;
+    bool in_order = true;
+    while (std::getline(log_file, line)) {
+        int thread_index = -1, message_index = -1;
+        if (std::sscanf(line.c_str(), "T%d M%d", &thread_index, &message_index) != 2)
+            continue;
+
+        if (message_index != next_expected[thread_index])
+            in_order = false;
+        next_expected[thread_index] = message_index + 1;
+    }
+
+    REQUIRE(in_order);
+    for (int i = 0; i < num_threads; i++)
+        REQUIRE(next_expected[i] == messages_per_thread);
+
+    std::filesystem::remove_all(test_dir);                          // Clean up
+}
+
+
+TEST_CASE("Logger File Sink", "[logger]") {
+    std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "logger_file_sink_test";
+    std::filesystem::create_directories(test_dir);
+
+    REQUIRE(AT::logger::init("$L: $C$Z", false, test_dir, "test_file_sink.log"));
+    AT::logger::set_buffer_size(4096);
+    AT::logger::set_buffer_threshold(AT::logger::severity::Warn);
+
+    SECTION("Batched writes") {
+        for (int i = 0; i < 500; i++)
+            LOG_Info("Buffered message " << i);
+
+        REQUIRE_NOTHROW(AT::logger::shutdown());
+
+        const AT::logger::file_sink_stats stats = AT::logger::get_file_sink_stats();
+        REQUIRE(stats.messages_written >= 500);
+        REQUIRE(stats.write_calls < stats.messages_written / 10);
+        REQUIRE(stats.syscalls_avoided > 0);
+
+        std::ifstream log_file(test_dir / "test_file_sink.log");
+        std::stringstream buffer;
+        buffer << log_file.rdbuf();
+        REQUIRE(buffer.str().find("INFO: Buffered message 499") != std::string::npos);
+    }
+
+    SECTION("Flush interval") {
+        AT::logger::set_flush_interval(std::chrono::milliseconds(20));
+        LOG_Info("Message flushed by time");
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+        std::ifstream log_file(test_dir / "test_file_sink.log");    // read before shutdown, the message is below the threshold
+        std::stringstream buffer;
+        buffer << log_file.rdbuf();
+        REQUIRE(buffer.str().find("INFO: Message flushed by time") != std::string::npos);
+
+        AT::logger::set_flush_interval(std::chrono::milliseconds(0));
+        REQUIRE_NOTHROW(AT::logger::shutdown());
+    }
+
+    std::filesystem::remove_all(test_dir);                          // Clean up
+}
+
+
+TEST_CASE("Logger Thread Labels", "[logger][multithreading]") {
+    std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "logger_thread_label_test";
+    std::filesystem::create_directories(test_dir);
+
+    REQUIRE(AT::logger::init("[$Q] $C$Z", false, test_dir, "test_thread_labels.log"));
+
+    std::ostringstream main_id{};
+    main_id << std::this_thread::get_id();
+    LOG_Info("Unlabeled message");
+    AT::logger::register_label_for_thread("first_label");
+    LOG_Info("First labeled message");
+    AT::logger::register_label_for_thread("second_label");                  // override
+    LOG_Info("Second labeled message");
+
+    std::atomic<bool> labeled = false;
+    std::thread worker([&]() {
+        while (!labeled.load())
+            std::this_thread::yield();
+        for (int i = 0; i < 100; i++)
+            LOG_Info("Worker message " << i);
+    });
+    const std::thread::id worker_id = worker.get_id();                      // empty once joined
+    AT::logger::register_label_for_thread("foreign_label", worker_id);       // registered by another thread
+    labeled.store(true);
+    worker.join();
+    AT::logger::unregister_label_for_thread(worker_id);
+
+    AT::logger::unregister_label_for_thread();
+    LOG_Info("Message after unregistering");
+    AT::logger::unregister_label_for_thread();                              // unknown thread, ignored
+
+    std::vector<std::string> short_lived_ids{};                             // the names of exited threads are released by the worker
+    for (int i = 0; i < 32; i++) {
+        std::ostringstream id{};
+        std::thread short_lived([i]() { LOG_Info("Short-lived thread " << i); });
+        id << short_lived.get_id();
+        short_lived.join();
+        short_lived_ids.push_back(id.str());
+    }
+    REQUIRE_NOTHROW(AT::logger::shutdown());
+
+    std::ifstream log_file(test_dir / "test_thread_labels.log");
+    std::stringstream buffer;
+    buffer << log_file.rdbuf();
+    const std::string content = buffer.str();
+    REQUIRE(content.find("[" + main_id.str() + "] Unlabeled message") != std::string::npos);
+    REQUIRE(content.find("[first_label] First labeled message") != std::string::npos);
+    REQUIRE(content.find("[second_label] Second labeled message") != std::string::npos);
+    REQUIRE(content.find("already has label [first_label] registered. Overriding with the label: [second_label]") != std::string::npos);
+    REQUIRE(content.find("[foreign_label] Worker message 0") != std::string::npos);
+    REQUIRE(content.find("[foreign_label] Worker message 99") != std::string::npos);
+    REQUIRE(content.find("[" + main_id.str() + "] Message after unregistering") != std::string::npos);
+    REQUIRE(content.find("Tried to unregister label for unknown thread") != std::string::npos);
+    for (int i = 0; i < 32; i++)
+        REQUIRE(content.find("[" + short_lived_ids[i] + "] Short-lived thread " + std::to_string(i) + "\n") != std::string::npos);
+
+    std::filesystem::remove_all(test_dir);                                  // Clean up
+}
+
+
+TEST_CASE("Logger Call-site Timestamps", "[logger]") {
+    std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "logger_timestamp_test";
+    std::filesystem::create_directories(test_dir);
+
+    auto ms_of_day = [](const std::chrono::system_clock::time_point time_point) -> long long {
+        const std::time_t seconds = std::chrono::system_clock::to_time_t(time_point);
+        const std::tm loc_tm = *std::localtime(&seconds);
+        const long long millis = std::chrono::duration_cast<std::chrono::milliseconds>(time_point.time_since_epoch()).count() % 1000;
+        return ((loc_tm.tm_hour * 60LL + loc_tm.tm_min) * 60LL + loc_tm.tm_sec) * 1000LL + millis;
+    };
+
+    REQUIRE(AT::logger::init("$H:$M:$S.$J $C$Z", false, test_dir, "test_timestamp.log"));
+
+    std::vector<std::pair<long long, long long>> windows{};
+    for (int i = 0; i < 5; i++) {
+        for (int x = 0; x < 10000; x++)                             // backlog the worker has to format first
+            LOG_Trace("Filler message " << x);
+
+        const auto before = std::chrono::system_clock::now();
+        LOG_Info("Timestamp message " << i);
+        const auto after = std::chrono::system_clock::now();
+        windows.emplace_back(ms_of_day(before), ms_of_day(after));
+    }
+
+    REQUIRE_NOTHROW(AT::logger::shutdown());
+
+    std::ifstream log_file(test_dir / "test_timestamp.log");
+    std::string line;
+    int found = 0;
+    while (std::getline(log_file, line)) {
+        const size_t pos = line.find(" Timestamp message ");
+        if (pos == std::string::npos || pos != 12)
+            continue;
+
+        const int index = std::stoi(line.substr(pos + 19));
+        const long long logged = ((std::stoll(line.substr(0, 2)) * 60LL + std::stoll(line.substr(3, 2))) * 60LL + std::stoll(line.substr(6, 2))) * 1000LL + std::stoll(line.substr(9, 3));
+        if (windows[index].second < windows[index].first)           // crossed midnight while logging
+            continue;
+
+        REQUIRE(logged >= windows[index].first);                    // time of the LOG() call, not of the worker processing it
+        REQUIRE(logged <= windows[index].second);
+        found++;
+    }
+    REQUIRE(found == 5);
+
+    std::filesystem::remove_all(test_dir);                          // Clean up
+}
+
+
+TEST_CASE("Logger Format Program", "[logger]") {
+    std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "logger_format_program_test";
+    std::filesystem::create_directories(test_dir);
+
+    REQUIRE(AT::logger::init("$L$X|$C|$I:$G|$K|$Q$Z", false, test_dir, "test_format_program.log"));
+    AT::logger::register_label_for_thread("format_thread");
+
+    const int first_line = __LINE__ + 1;
+    LOG_Info("first");
+    AT::logger::set_format("$L $C [$P] $Y/$O/$D $H:$M:$S.$J$Z");
+    LOG_Warn("second");
+    AT::logger::use_previous_format();
+    LOG_Error("third");
+
+    AT::logger::unregister_label_for_thread();
+    REQUIRE_NOTHROW(AT::logger::shutdown());
+
+    std::ifstream log_file(test_dir / "test_format_program.log");
+    std::stringstream buffer;
+    buffer << log_file.rdbuf();
+    const std::string content = buffer.str();
+
+    REQUIRE(content.find("INFO |first|test_utils.cpp:" + std::to_string(first_line) + "||format_thread\n") != std::string::npos);
+    REQUIRE(content.find("ERROR|third|test_utils.cpp:" + std::to_string(first_line + 4) + "||format_thread\n") != std::string::npos);
+
+    const std::regex second_line(R"(WARN second \[.*\] \d{4}/\d{2}/\d{2} \d{2}:\d{2}:\d{2}\.\d{3}\n)");
+    REQUIRE(std::regex_search(content, second_line));
+
+    std::filesystem::remove_all(test_dir);                          // Clean up
+}
+
+
+TEST_CASE("Logger Deferred Formatting", "[logger]") {
+    std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "logger_deferred_test";
+    std::filesystem::create_directories(test_dir);
+
+    REQUIRE(AT::logger::init("$L: $C$Z", false, test_dir, "test_deferred.log"));
+
+    enum class test_enum : u8 { first = 3 };
+    const std::string long_text(200, 'x');                          // bigger than the inline argument storage
+    const int* pointer = reinterpret_cast<const int*>(0xdead);
+
+    LOG_DEFERRED(Info, "int {} uint {} float {} bool {} char {} str {} enum {}", -42, 7u, 1.5, true, 'c', "text", test_enum::first);
+    LOG_DEFERRED(Warn, "view {} string {} pointer {}", std::string_view("view"), std::string("string"), pointer);
+    LOG_DEFERRED(Error, "long {} end", long_text);
+    LOG_DEFERRED(Debug, "braces {{}} missing {} {}", 1);
+    LOG_DEFERRED(Trace, "no arguments");
+    LOG_Info("normal message");
+    LOG_DEFERRED(Info, "after {}", u64(18446744073709551615ull));
+
+    REQUIRE_NOTHROW(AT::logger::shutdown());
+
+    std::ifstream log_file(test_dir / "test_deferred.log");
+    std::stringstream buffer;
+    buffer << log_file.rdbuf();
+    const std::string content = buffer.str();
+
+    REQUIRE(content.find("INFO: int -42 uint 7 float 1.5 bool true char c str text enum 3\n") != std::string::npos);
+    REQUIRE(content.find("WARN: view view string string pointer 0xdead\n") != std::string::npos);
+    REQUIRE(content.find("ERROR: long " + long_text + " end\n") != std::string::npos);
+    REQUIRE(content.find("DEBUG: braces {} missing 1 {}\n") != std::string::npos);
+    REQUIRE(content.find("TRACE: no arguments\n") != std::string::npos);
+    REQUIRE(content.find("INFO: normal message\nINFO: after 18446744073709551615\n") != std::string::npos);
+
+    std::filesystem::remove_all(test_dir);                          // Clean up
+}
+
+
+TEST_CASE("Logger Categories", "[logger]") {
+    std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "logger_category_test";
+    std::filesystem::create_directories(test_dir);
+
+    REQUIRE(AT::logger::init("$L: $C$Z", false, test_dir, "test_category.log"));
+
+    STATIC_REQUIRE(AT::logger::is_compiled_in(AT::logger::category::general, AT::logger::severity::Error));
+    REQUIRE(AT::logger::get_category_level(AT::logger::category::renderer) == AT::logger::severity::Trace);
+
+    int evaluated = 0;
+    auto count_evaluation = [&evaluated]() { return ++evaluated; };
+
+    AT::logger::set_category_level(AT::logger::category::renderer, AT::logger::severity::Warn);
+    AT::logger::set_category_level(AT::logger::category::general, AT::logger::severity::Info);
+    AT::logger::set_category_level(AT::logger::category::io, AT::logger::severity::Fatal);
+    REQUIRE(AT::logger::get_category_level(AT::logger::category::io) == AT::logger::severity::Error);      // Error and Fatal can not be filtered
+
+    LOG_CATEGORY(renderer, Info, "renderer info " << count_evaluation());
+    LOG_CATEGORY(renderer, Warn, "renderer warn " << count_evaluation());
+    LOG_CATEGORY(serializer, Trace, "serializer trace " << count_evaluation());
+    LOG_CATEGORY(io, Warn, "io warn " << count_evaluation());
+    LOG_CATEGORY(io, Error, "io error " << count_evaluation());
+    LOG(Debug, "general debug " << count_evaluation());
+    LOG(Info, "general info " << count_evaluation());
+    LOG_DEFERRED(Debug, "deferred debug");
+    LOG_DEFERRED(Info, "deferred info");
+
+    REQUIRE(evaluated == 4);                                        // filtered messages are not formatted
+
+    for (u8 x = 0; x < static_cast<u8>(AT::logger::category::count); x++)
+        AT::logger::set_category_level(static_cast<AT::logger::category>(x), AT::logger::severity::Trace);
+
+    REQUIRE_NOTHROW(AT::logger::shutdown());
+
+    std::ifstream log_file(test_dir / "test_category.log");
+    std::stringstream buffer;
+    buffer << log_file.rdbuf();
+    const std::string content = buffer.str();
+
+    REQUIRE(content.find("renderer info") == std::string::npos);
+    REQUIRE(content.find("WARN: renderer warn 1") != std::string::npos);
+    REQUIRE(content.find("TRACE: serializer trace 2") != std::string::npos);
+    REQUIRE(content.find("io warn") == std::string::npos);
+    REQUIRE(content.find("ERROR: io error 3") != std::string::npos);
+    REQUIRE(content.find("general debug") == std::string::npos);
+    REQUIRE(content.find("INFO: general info 4") != std::string::npos);
+    REQUIRE(content.find("deferred debug") == std::string::npos);
+    REQUIRE(content.find("INFO: deferred info") != std::string::npos);
+
+    std::filesystem::remove_all(test_dir);                          // Clean up
+}
+
+
+TEST_CASE("Logger Queue Limit", "[logger]") {
+    std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "logger_queue_limit_test";
+    std::filesystem::create_directories(test_dir);
+
+    auto dropped_trace = []() { return AT::logger::get_queue_stats().dropped[static_cast<u8>(AT::logger::severity::Trace)]; };
+    auto read_log = [&test_dir]() {
+        std::ifstream log_file(test_dir / "test_queue_limit.log");
+        std::stringstream buffer;
+        buffer << log_file.rdbuf();
+        return buffer.str();
+    };
+
+    SECTION("Drop newest") {                                        // without a running worker nothing leaves the queue
+        AT::logger::set_queue_limit(100, AT::logger::overflow_policy::drop_newest);
+        const u64 dropped_before = dropped_trace();
+        for (int i = 0; i < 1000; i++)
+            LOG_Trace("Limited message " << i);
+        LOG_Error("Error is never dropped");
+
+        REQUIRE(dropped_trace() - dropped_before == 900);
+        REQUIRE(AT::logger::get_queue_stats().pending <= 101);
+
+        REQUIRE(AT::logger::init("$L: $C$Z", false, test_dir, "test_queue_limit.log"));
+        REQUIRE_NOTHROW(AT::logger::shutdown());
+
+        const std::string content = read_log();
+        REQUIRE(content.find("TRACE: Limited message 99\n") != std::string::npos);
+        REQUIRE(content.find("TRACE: Limited message 100\n") == std::string::npos);
+        REQUIRE(content.find("ERROR: Error is never dropped") != std::string::npos);
+        REQUIRE(content.find("[LOGGER] Queue limit reached, dropped messages: TRACE [900]") != std::string::npos);
+    }
+
+    SECTION("Drop oldest") {
+        AT::logger::set_queue_limit(100, AT::logger::overflow_policy::drop_oldest);
+        const u64 dropped_before = dropped_trace();
+        for (int i = 0; i < 5000; i++)
+            LOG_Trace("Limited message " << i);
+
+        REQUIRE(dropped_trace() - dropped_before == 4900);
+        REQUIRE(AT::logger::get_queue_stats().pending <= 100);
+
+        REQUIRE(AT::logger::init("$L: $C$Z", false, test_dir, "test_queue_limit.log"));
+        REQUIRE_NOTHROW(AT::logger::shutdown());
+
+        const std::string content = read_log();                     // the newest messages survive, in order
+        size_t position = 0;
+        for (int i = 4900; i < 5000; i++) {
+            position = content.find("TRACE: Limited message " + std::to_string(i) + "\n", position);
+            REQUIRE(position != std::string::npos);
+        }
+        REQUIRE(content.find("TRACE: Limited message 4899\n") == std::string::npos);
+        REQUIRE(content.find("TRACE: Limited message 0\n") == std::string::npos);
+    }
+
+    SECTION("Sample") {
+        AT::logger::set_queue_limit(400, AT::logger::overflow_policy::sample);
+        const u64 dropped_before = dropped_trace();
+        const u64 pending_before = AT::logger::get_queue_stats().pending;
+        for (int i = 0; i < 2000; i++)
+            LOG_Trace("Limited message " << i);
+
+        const u64 kept = AT::logger::get_queue_stats().pending - pending_before;
+        REQUIRE(kept > 300);
+        REQUIRE(kept <= 400);
+        REQUIRE(dropped_trace() - dropped_before == 2000 - kept);
+
+        REQUIRE(AT::logger::init("$L: $C$Z", false, test_dir, "test_queue_limit.log"));
+        REQUIRE_NOTHROW(AT::logger::shutdown());
+    }
+
+    SECTION("Block") {
+        AT::logger::set_queue_limit(64, AT::logger::overflow_policy::block);
+        REQUIRE(AT::logger::init("$L: $C$Z", false, test_dir, "test_queue_limit.log"));
+
+        const u64 dropped_before = dropped_trace();
+        std::atomic<u64> max_pending = 0;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&max_pending, t]() {
+                for (int i = 0; i < 2000; i++) {
+                    LOG_Trace("Thread " << t << " message " << i);
+                    const u64 pending = AT::logger::get_queue_stats().pending;
+                    u64 current = max_pending.load();
+                    while (pending > current && !max_pending.compare_exchange_weak(current, pending)) {}
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        REQUIRE_NOTHROW(AT::logger::shutdown());
+        REQUIRE(dropped_trace() == dropped_before);
+        REQUIRE(max_pending.load() <= 64 + 4);
+
+        const std::string content = read_log();
+        for (int t = 0; t < 4; t++)
+            REQUIRE(content.find("TRACE: Thread " + std::to_string(t) + " message 1999\n") != std::string::npos);
+    }
+
+    AT::logger::set_queue_limit(LOGGER_QUEUE_LIMIT, AT::logger::overflow_policy::block);
+    std::filesystem::remove_all(test_dir);                          // Clean up
+}
+
+
+// Decompresses a gzip file written by io::compress_file_gzip()
+static std::string read_gzip_file(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    const std::string compressed((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    REQUIRE(compressed.size() >= 18);
+    REQUIRE(static_cast<u8>(compressed[0]) == 0x1F);
+    REQUIRE(static_cast<u8>(compressed[1]) == 0x8B);
+
+    int length = 0;                                                 // skip the 10 byte header, the decoder stops before the 8 byte trailer
+    char* data = stbi_zlib_decode_noheader_malloc(compressed.data() + 10, static_cast<int>(compressed.size() - 10), &length);
+    REQUIRE(data != nullptr);
+    std::string result(data, static_cast<size_t>(length));
+    free(data);
+    return result;
+}
+
+
+TEST_CASE("Gzip Compression", "[io]") {
+    std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "gzip_compression_test";
+    std::filesystem::create_directories(test_dir);
+
+    std::string content{};
+    AT::util::random random(42);
+    for (int i = 0; i < 100000; i++)                                // repetitive log-like text and some noise, bigger than one read block
+        content += "[12:00:" + std::to_string(i % 60) + "] INFO frame " + std::to_string(i) + " took " + std::to_string(random.get<int>(0, 20000)) + " us\n";
+
+    std::ofstream(test_dir / "input.log", std::ios::binary) << content;
+    std::ofstream(test_dir / "empty.log", std::ios::binary).close();
+
+    REQUIRE(AT::io::compress_file_gzip(test_dir / "input.log", test_dir / "input.log.gz"));
+    REQUIRE(std::filesystem::file_size(test_dir / "input.log.gz") < content.size() / 3);
+    REQUIRE(read_gzip_file(test_dir / "input.log.gz") == content);
+
+    REQUIRE(AT::io::compress_file_gzip(test_dir / "empty.log", test_dir / "empty.log.gz"));
+    REQUIRE(read_gzip_file(test_dir / "empty.log.gz").empty());
+
+    REQUIRE_FALSE(AT::io::compress_file_gzip(test_dir / "missing.log", test_dir / "missing.log.gz"));
+
+    std::filesystem::remove_all(test_dir);                          // Clean up
+}
+
+
+TEST_CASE("Logger Rotation", "[logger]") {
+    std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "logger_rotation_test";
+    std::filesystem::remove_all(test_dir);
+    std::filesystem::create_directories(test_dir);
+
+    auto get_segments = [&test_dir]() {
+        std::vector<std::filesystem::path> segments{};
+        for (const auto& entry : std::filesystem::directory_iterator(test_dir))
+            if (entry.path().filename() != "test_rotation.log")
+                segments.push_back(entry.path());
+        const size_t timestamp_end = std::string("test_rotation_0000-00-00_00-00-00").size();
+        auto sort_key = [timestamp_end](const std::filesystem::path& segment) {    // [stem]_[date]_[time]_[n] for multiple rotations in one second
+            const std::string name = std::filesystem::path(segment).replace_extension().stem().string();
+            return std::make_pair(name.substr(0, timestamp_end), (name.size() > timestamp_end) ? std::stoi(name.substr(timestamp_end + 1)) : 0);
+        };
+        std::sort(segments.begin(), segments.end(), [&sort_key](const auto& a, const auto& b) { return sort_key(a) < sort_key(b); });
+        return segments;
+    };
+
+    SECTION("Size based with retention and compression") {
+        REQUIRE(AT::logger::init("$C$Z", false, test_dir, "test_rotation.log"));
+        AT::logger::set_rotation({ 4096, std::chrono::seconds(0), 3, true });
+        for (int i = 0; i < 3000; i++)
+            LOG_Info("Rotation message " << i);
+        AT::logger::set_rotation({});
+        REQUIRE_NOTHROW(AT::logger::shutdown());                    // waits for the compressor
+
+        REQUIRE(AT::logger::get_file_sink_stats().rotations >= 10);
+        const auto segments = get_segments();
+        REQUIRE(segments.size() == 3);
+
+        std::string content{};
+        for (const auto& segment : segments) {
+            REQUIRE(segment.extension() == ".gz");
+            content += read_gzip_file(segment);
+        }
+        std::ifstream main_file(test_dir / "test_rotation.log");
+        content += std::string((std::istreambuf_iterator<char>(main_file)), std::istreambuf_iterator<char>());
+
+        std::istringstream lines(content);                          // the kept segments and the main file continue each other
+        std::string line;
+        int previous = -1;
+        while (std::getline(lines, line)) {
+            if (line.rfind("Rotation message ", 0) != 0)
+                continue;
+            const int index = std::stoi(line.substr(17));
+            if (previous >= 0)
+                REQUIRE(index == previous + 1);
+            previous = index;
+        }
+        REQUIRE(previous == 2999);
+    }
+
+    SECTION("Retention only removes segments") {
+        const std::vector<std::string> unrelated{ "test_rotation_2024_backup.log", "test_rotation_2024-01-01_00-00-00_old.log", "test_rotation_1.log", "test_rotation_2024-01-01_00-00-00.txt" };
+        for (const auto& name : unrelated)
+            std::ofstream(test_dir / name) << "keep";
+        std::ofstream(test_dir / "test_rotation_2000-01-01_00-00-00.log") << "oldest segment";
+
+        REQUIRE(AT::logger::init("$C$Z", false, test_dir, "test_rotation.log"));
+        AT::logger::set_rotation({ 4096, std::chrono::seconds(0), 2, false });
+        for (int i = 0; i < 1000; i++)
+            LOG_Info("Rotation message " << i);
+        AT::logger::set_rotation({});
+        REQUIRE_NOTHROW(AT::logger::shutdown());
+
+        REQUIRE(AT::logger::get_file_sink_stats().rotations >= 3);
+        for (const auto& name : unrelated)
+            REQUIRE(std::filesystem::exists(test_dir / name));
+        REQUIRE_FALSE(std::filesystem::exists(test_dir / "test_rotation_2000-01-01_00-00-00.log"));
+        size_t files = 0;
+        for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator(test_dir))
+            files++;
+        REQUIRE(files == unrelated.size() + 2 + 1);                 // the kept segments and the main file
+    }
+
+    SECTION("Time based without compression") {
+        REQUIRE(AT::logger::init("$C$Z", false, test_dir, "test_rotation.log"));
+        AT::logger::set_rotation({ 0, std::chrono::seconds(1), 0, false });
+        LOG_Info("Before rotation");
+        std::this_thread::sleep_for(std::chrono::milliseconds(1300));
+        LOG_Info("After rotation");
+        AT::logger::set_rotation({});
+        REQUIRE_NOTHROW(AT::logger::shutdown());
+
+        REQUIRE(AT::logger::get_file_sink_stats().rotations >= 1);
+        const auto segments = get_segments();
+        REQUIRE(segments.size() >= 1);
+        REQUIRE(segments.front().extension() == ".log");
+
+        std::ifstream segment_file(segments.front());
+        const std::string segment_content((std::istreambuf_iterator<char>(segment_file)), std::istreambuf_iterator<char>());
+        REQUIRE(segment_content.find("Before rotation") != std::string::npos);
+
+        std::ifstream main_file(test_dir / "test_rotation.log");
+        const std::string main_content((std::istreambuf_iterator<char>(main_file)), std::istreambuf_iterator<char>());
+        REQUIRE(main_content.find("After rotation") != std::string::npos);
+        REQUIRE(main_content.find("Log rotated at") != std::string::npos);
+    }
+
+    std::filesystem::remove_all(test_dir);                          // Clean up
+}
+
+
+TEST_CASE("Logger Structured Sink", "[logger]") {
+    std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "logger_structured_test";
+    std::filesystem::remove_all(test_dir);
+    std::filesystem::create_directories(test_dir);
+
+    auto write_and_read = [&test_dir](const AT::logger::structured_format format, const std::filesystem::path& file_name) {
+
+        const auto before = std::chrono::system_clock::now();
+        REQUIRE(AT::logger::init("$L: $C$Z", false, test_dir, "test_structured.log"));
+        REQUIRE(AT::logger::open_structured_sink(test_dir / file_name, format));
+        AT::logger::register_label_for_thread("structured_main");
+
+        LOG_Debug("Debug message");
+        LOG_Info("Quote \" backslash \\ tab \t newline \n end");
+        std::thread worker([]() {
+            AT::logger::register_label_for_thread("structured_worker");
+            for (int i = 0; i < 1000; i++)
+                LOG_Warn("Worker message " << i);
+            AT::logger::unregister_label_for_thread();
+        });
+        worker.join();
+        LOG_Error("Error message");
+        AT::logger::close_structured_sink();
+        LOG_Error("Not in the structured log");
+        AT::logger::unregister_label_for_thread();
+        REQUIRE_NOTHROW(AT::logger::shutdown());
+        const auto after = std::chrono::system_clock::now();
+
+        std::vector<std::string> messages{};
+        REQUIRE(AT::logger::read_structured_log(test_dir / file_name, {}, [&](const AT::logger::log_record& record) {
+            messages.emplace_back(record.message);
+            REQUIRE(record.timestamp >= std::chrono::duration_cast<std::chrono::microseconds>(before.time_since_epoch()).count() - 1000);
+            REQUIRE(record.timestamp <= std::chrono::duration_cast<std::chrono::microseconds>(after.time_since_epoch()).count() + 1000);
+            REQUIRE(record.file_name.find("test_utils.cpp") != std::string_view::npos);
+            REQUIRE(record.line > 0);
+            return true;
+        }));
+        REQUIRE(messages.size() == 1003);
+        REQUIRE(messages[0] == "Debug message");
+        REQUIRE(messages[1] == "Quote \" backslash \\ tab \t newline \n end");
+        REQUIRE(messages.back() == "Error message");
+
+        AT::logger::log_filter filter{};                            // only the messages of the worker thread
+        filter.min_severity = AT::logger::severity::Warn;
+        filter.thread = "structured_worker";
+        filter.message_contains = "message 99";
+        std::vector<std::string> filtered{};
+        REQUIRE(AT::logger::read_structured_log(test_dir / file_name, filter, [&](const AT::logger::log_record& record) {
+            REQUIRE(record.msg_sev == AT::logger::severity::Warn);
+            REQUIRE(record.function_name.size() > 0);
+            filtered.emplace_back(record.message);
+            return true;
+        }));
+        REQUIRE(filtered.size() == 11);                             // 99 and 990 - 999
+        REQUIRE(filtered.front() == "Worker message 99");
+
+        u32 count = 0;                                              // the callback can stop reading
+        REQUIRE(AT::logger::read_structured_log(test_dir / file_name, {}, [&count](const AT::logger::log_record&) { return ++count < 5; }));
+        REQUIRE(count == 5);
+
+        std::ifstream log_file(test_dir / "test_structured.log");   // the text log is unchanged
+        std::stringstream buffer;
+        buffer << log_file.rdbuf();
+        REQUIRE(buffer.str().find("WARN: Worker message 999") != std::string::npos);
+        REQUIRE(buffer.str().find("ERROR: Not in the structured log") != std::string::npos);
+    };
+
+    SECTION("JSON lines") {
+        write_and_read(AT::logger::structured_format::json_lines, "structured.jsonl");
+
+        std::ifstream json_file(test_dir / "structured.jsonl");
+        std::string first_line{};
+        std::getline(json_file, first_line);
+        REQUIRE(first_line.rfind("{\"timestamp\":", 0) == 0);
+        REQUIRE(first_line.find("\"severity\":\"DEBUG\"") != std::string::npos);
+        REQUIRE(first_line.find("\"thread\":\"structured_main\"") != std::string::npos);
+    }
+
+    SECTION("Binary") {
+        write_and_read(AT::logger::structured_format::binary, "structured.atlog");
+
+        const auto full_size = std::filesystem::file_size(test_dir / "structured.atlog");
+        std::filesystem::resize_file(test_dir / "structured.atlog", full_size - 3);     // record cut off by a crash
+        u32 count = 0;
+        REQUIRE(AT::logger::read_structured_log(test_dir / "structured.atlog", {}, [&count](const AT::logger::log_record&) { count++; return true; }));
+        REQUIRE(count == 1002);
+    }
+
+    REQUIRE_FALSE(AT::logger::read_structured_log(test_dir / "missing.jsonl", {}, [](const AT::logger::log_record&) { return true; }));
+
+    std::filesystem::remove_all(test_dir);                          // Clean up
+}
+
+
+TEST_CASE("Logger Sinks", "[logger][multithreading]") {
+    std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "logger_sink_test";
+    std::filesystem::remove_all(test_dir);
+    std::filesystem::create_directories(test_dir);
+
+    auto read_file = [](const std::filesystem::path& path) {
+        std::ifstream file(path);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        return buffer.str();
+    };
+
+    REQUIRE(AT::logger::init("$L: $C$Z", false, test_dir, "test_sinks.log"));
+
+    SECTION("Severity filter, file sinks and removal") {
+        auto memory = std::make_shared<AT::logger::memory_sink>(3);
+        memory->set_min_severity(AT::logger::severity::Warn);
+        auto file = std::make_shared<AT::logger::file_sink>(test_dir / "sink" / "file_sink.log");
+        auto rotating = std::make_shared<AT::logger::rotating_file_sink>(test_dir / "rotating.log", AT::logger::rotation_settings{ 1024, std::chrono::seconds(0), 0, false });
+        REQUIRE(file->is_open());
+        REQUIRE(rotating->is_open());
+
+        AT::logger::add_sink(memory);
+        AT::logger::add_sink(file, true);
+        AT::logger::add_sink(rotating);
+        for (int i = 0; i < 100; i++)
+            LOG_Info("Info message " << i);
+        LOG_Warn("Warn message 1");
+        LOG_Warn("Warn message 2");
+        LOG_Error("Error message");
+        LOG_Warn("Warn message 3");
+        AT::logger::remove_sink(file);
+        AT::logger::remove_sink(file);                                      // not added anymore
+        LOG_Info("After removal");
+        REQUIRE_NOTHROW(AT::logger::shutdown());
+
+        const std::vector<std::string> messages = memory->get_messages();   // the last 3 messages at or above Warn
+        REQUIRE(messages.size() == 3);
+        REQUIRE(messages[0] == "WARN: Warn message 2\n");
+        REQUIRE(messages[1] == "ERROR: Error message\n");
+        REQUIRE(messages[2] == "WARN: Warn message 3\n");
+        memory->clear();
+        REQUIRE(memory->get_messages().empty());
+
+        const std::string file_content = read_file(test_dir / "sink" / "file_sink.log");
+        REQUIRE(file_content.find("INFO: Info message 0\n") != std::string::npos);
+        REQUIRE(file_content.find("WARN: Warn message 3\n") != std::string::npos);
+        REQUIRE(file_content.find("After removal") == std::string::npos);
+
+        REQUIRE(rotating->get_stats().rotations >= 1);
+        REQUIRE(read_file(test_dir / "rotating.log").find("After removal") != std::string::npos);
+        REQUIRE(read_file(test_dir / "test_sinks.log").find("Tried to remove a sink that was not added") != std::string::npos);
+    }
+
+    SECTION("A slow sink does not stall the others") {
+        std::mutex gate_mutex{};
+        std::condition_variable gate_cv{};
+        bool gate_open = false;
+        std::vector<std::string> slow_messages{};
+        std::vector<std::string> slow_threads{};
+        auto slow = std::make_shared<AT::logger::callback_sink>([&](const AT::logger::sink_entry& entry) {
+            std::unique_lock<std::mutex> lock(gate_mutex);
+            gate_cv.wait(lock, [&] { return gate_open; });                 // blocks until the other sinks got everything
+            slow_messages.emplace_back(entry.message);
+            slow_threads.emplace_back(entry.thread);
+        });
+        auto memory = std::make_shared<AT::logger::memory_sink>(LOGGER_SINK_QUEUE_LIMIT * 4);
+
+        AT::logger::register_label_for_thread("sink_thread");
+        AT::logger::add_sink(slow, true);
+        AT::logger::add_sink(memory);
+        const int message_count = LOGGER_SINK_QUEUE_LIMIT * 2 + 100;        // the sink thread takes one batch before it blocks
+        for (int i = 0; i < message_count; i++)
+            LOG_Info("Sink message " << i);
+        LOG_Error("Sink error");
+
+        const auto start = std::chrono::steady_clock::now();             // the memory sink is written by the logger worker
+        while (memory->get_messages().size() < static_cast<size_t>(message_count + 1) && std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        CHECK(memory->get_messages().size() == static_cast<size_t>(message_count + 1));     // CHECK, the gate has to be opened
+        CHECK(slow->get_dropped_messages() > 0);
+
+        {
+            std::lock_guard<std::mutex> lock(gate_mutex);
+            gate_open = true;
+        }
+        gate_cv.notify_all();
+        AT::logger::unregister_label_for_thread();
+        REQUIRE_NOTHROW(AT::logger::shutdown());
+
+        REQUIRE(slow_messages.size() + slow->get_dropped_messages() == static_cast<size_t>(message_count + 1));
+        REQUIRE(slow_messages.front() == "Sink message 0");
+        REQUIRE(slow_messages.back() == "Sink error");                     // Error is never dropped
+        REQUIRE(slow_threads.front() == "sink_thread");
+    }
+
+    std::filesystem::remove_all(test_dir);                                  // Clean up
+}
+
+
+TEST_CASE("Logger Crash Ring", "[logger]") {
+    std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "logger_crash_ring_test";
+    std::filesystem::remove_all(test_dir);
+    std::filesystem::create_directories(test_dir);
+
+    auto read_crash_ring = [&test_dir]() {
+        std::ifstream log_file(test_dir / "test_crash_ring.log");
+        std::vector<std::string> lines{};
+        std::string line;
+        bool inside = false;
+        while (std::getline(log_file, line)) {
+            if (line.find("crash ring, the last messages") != std::string::npos)
+                inside = true;
+            else if (line.find("end of crash ring") != std::string::npos)
+                inside = false;
+            else if (inside)
+                lines.push_back(line);
+        }
+        return lines;
+    };
+
+    REQUIRE(AT::logger::init("$C$Z", false, test_dir, "test_crash_ring.log"));
+    AT::logger::set_buffer_size(1024 * 1024);
+    AT::logger::set_buffer_threshold(AT::logger::severity::Error);     // everything below Error stays in the buffer of the logger
+    AT::logger::register_label_for_thread("crash_thread");
+
+    for (int i = 0; i < LOGGER_CRASH_RING_SIZE + 50; i++)
+        LOG_Info("Crash ring message " << i);
+    LOG_Warn(std::string(LOGGER_CRASH_RECORD_SIZE + 100, 'x'));
+    LOG_DEFERRED(Debug, "deferred {} message", 42);
+
+    SECTION("Dump from the calling thread") {
+        AT::logger::dump_crash_ring();
+
+        const std::vector<std::string> lines = read_crash_ring();
+        REQUIRE(lines.size() == LOGGER_CRASH_RING_SIZE);
+        REQUIRE(lines.front().find("] [INFO] [crash_thread] test_utils.cpp:") != std::string::npos);
+        REQUIRE(lines.front().find("Crash ring message 52") != std::string::npos);      // the oldest messages were replaced
+        REQUIRE(lines[lines.size() - 3].find("Crash ring message " + std::to_string(LOGGER_CRASH_RING_SIZE + 49)) != std::string::npos);
+        REQUIRE(lines[lines.size() - 2].find(std::string(LOGGER_CRASH_RECORD_SIZE, 'x')) != std::string::npos);
+        REQUIRE(lines[lines.size() - 2].find(std::string(LOGGER_CRASH_RECORD_SIZE + 1, 'x')) == std::string::npos);
+        REQUIRE(lines.back().find("[DEBUG] [crash_thread]") != std::string::npos);
+        REQUIRE(lines.back().find("deferred {} message") != std::string::npos);
+    }
+
+#if defined(PLATFORM_LINUX)
+    SECTION("Dump from a signal handler") {
+        const pid_t child = fork();
+        if (child == 0) {                                                   // the queued messages only exist in memory of the child
+            signal(SIGSEGV, [](int) { AT::logger::dump_crash_ring(); _exit(3); });
+            raise(SIGSEGV);
+            _exit(0);
+        }
+
+        int status = 0;
+        REQUIRE(child > 0);
+        REQUIRE(waitpid(child, &status, 0) == child);
+        REQUIRE(WIFEXITED(status));
+        REQUIRE(WEXITSTATUS(status) == 3);
+
+        const std::vector<std::string> lines = read_crash_ring();
+        REQUIRE(lines.size() == LOGGER_CRASH_RING_SIZE);
+        REQUIRE(lines[lines.size() - 3].find("Crash ring message " + std::to_string(LOGGER_CRASH_RING_SIZE + 49)) != std::string::npos);
+    }
+#endif
+
+    AT::logger::unregister_label_for_thread();
+    REQUIRE_NOTHROW(AT::logger::shutdown());
+    std::filesystem::remove_all(test_dir);                                  // Clean up
+}
+
+
 TEST_CASE("Logger Exception Handling", "[logger][exception]") {
     std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "logger_exception_test";
     std::filesystem::create_directories(test_dir);
@@ -1089,6 +1936,706 @@ TEST_CASE("Binary Serializer - Mixed Data", "[serializer][binary]") {
     REQUIRE(loaded_path == test_path);
 }
 
+TEST_CASE("Binary Serializer - Buffered Writer", "[serializer][binary]") {
+    const std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "test_buffered_writer";
+    std::filesystem::remove_all(test_dir);
+    std::filesystem::create_directory(test_dir);
+    const std::filesystem::path test_file = test_dir / "test_buffered.bin";
+
+    std::vector<u32> test_values(5000);
+    for (size_t x = 0; x < test_values.size(); x++)
+        test_values[x] = static_cast<u32>(x * 3);
+
+    const auto load_values = [&test_file]() {
+        std::vector<u32> loaded_values;
+        AT::serializer::binary serializer(test_file, "buffered", AT::serializer::option::load_from_file);
+        u64 count = 0;
+        serializer.entry(count);
+        loaded_values.resize(count);
+        for (auto& value : loaded_values)
+            serializer.entry(value);
+        return loaded_values;
+    };
+
+    SECTION("Nothing is written before flush") {
+        {
+            AT::serializer::binary serializer(test_file, "buffered", AT::serializer::option::save_to_file);
+            serializer.set_encoding(AT::serializer::binary::encoding::raw);         // the size check below assumes full width integers
+            u64 count = test_values.size();
+            serializer.entry(count);
+            for (auto& value : test_values)                                         // thousands of small entries
+                serializer.entry(value);
+            REQUIRE_FALSE(std::filesystem::exists(test_file));
+        }
+        REQUIRE(std::filesystem::file_size(test_file) >= sizeof(u64) + test_values.size() * sizeof(u32));
+        REQUIRE(load_values() == test_values);
+    }
+
+    SECTION("The previous file stays intact until the new one is complete") {
+        {
+            u64 count = 1;
+            u32 value = 99;
+            AT::serializer::binary(test_file, "buffered", AT::serializer::option::save_to_file).entry(count).entry(value);
+        }
+        {
+            AT::serializer::binary serializer(test_file, "buffered", AT::serializer::option::save_to_file);
+            serializer.set_sync_policy(AT::io::sync_policy::file_and_directory);
+            u64 count = test_values.size();
+            serializer.entry(count);
+            for (size_t x = 0; x < test_values.size() / 2; x++)
+                serializer.entry(test_values[x]);
+            REQUIRE(load_values() == std::vector<u32>{ 99 });
+
+            for (size_t x = test_values.size() / 2; x < test_values.size(); x++)
+                serializer.entry(test_values[x]);
+            REQUIRE(serializer.flush());
+            REQUIRE(load_values() == test_values);
+        }
+        REQUIRE(load_values() == test_values);                                      // the destructor had nothing left to write
+
+        size_t files = 0;
+        for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator(test_dir))
+            files++;
+        REQUIRE(files == 1);                                                        // no temporary file left behind
+    }
+
+    SECTION("An exception while saving keeps the previous file") {
+        {
+            u64 count = 1;
+            u32 value = 99;
+            AT::serializer::binary(test_file, "buffered", AT::serializer::option::save_to_file).entry(count).entry(value);
+        }
+        try {
+            AT::serializer::binary serializer(test_file, "buffered", AT::serializer::option::save_to_file);
+            u64 count = test_values.size();
+            serializer.entry(count);
+            serializer.vector(test_values, [&test_values](AT::serializer::binary& element_serializer, const u64 x) {
+                if (x == 100)
+                    throw std::runtime_error("serialization failed");
+                element_serializer.entry(test_values[x]);
+            });
+            FAIL("the callback should have thrown");
+        } catch (const std::runtime_error&) {}
+
+        REQUIRE(load_values() == std::vector<u32>{ 99 });                          // the half written section was not flushed by the destructor
+    }
+
+    SECTION("Concurrent saves of the same file") {
+        std::vector<std::string> contents;
+        for (char x = 0; x < 8; x++)
+            contents.emplace_back(1 << 20, static_cast<char>('a' + x));
+
+        std::vector<std::thread> threads;
+        std::atomic<u32> succeeded{ 0 };
+        for (const auto& content : contents)
+            threads.emplace_back([&test_file, &content, &succeeded]() {
+                for (int x = 0; x < 5; x++)
+                    succeeded += AT::io::write_file_atomic(test_file, content.data(), content.size()) ? 1 : 0;
+            });
+        for (auto& thread : threads)
+            thread.join();
+        REQUIRE(succeeded == contents.size() * 5);
+
+        std::ifstream file(test_file, std::ios::binary);
+        const std::string result((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        REQUIRE(std::find(contents.begin(), contents.end(), result) != contents.end());    // one complete save, never a mix
+
+        size_t files = 0;
+        for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator(test_dir))
+            files++;
+        REQUIRE(files == 1);
+    }
+
+#if defined(PLATFORM_LINUX)
+    SECTION("The permissions of the replaced file are kept") {
+        const char first[] = "first";
+        REQUIRE(AT::io::write_file_atomic(test_file, first, sizeof(first)));
+        REQUIRE((std::filesystem::status(test_file).permissions() & std::filesystem::perms::all) == std::filesystem::perms(0644));
+
+        std::filesystem::permissions(test_file, std::filesystem::perms(0600));
+        const char second[] = "second";
+        REQUIRE(AT::io::write_file_atomic(test_file, second, sizeof(second)));
+        REQUIRE((std::filesystem::status(test_file).permissions() & std::filesystem::perms::all) == std::filesystem::perms(0600));
+    }
+#endif
+
+    SECTION("Failed write") {
+        u32 value = 1;
+        AT::serializer::binary serializer(test_dir / "missing_directory" / "test.bin", "buffered", AT::serializer::option::save_to_file);
+        serializer.entry(value);
+        REQUIRE_FALSE(serializer.flush());
+        REQUIRE_FALSE(std::filesystem::exists(test_dir / "missing_directory"));
+    }
+
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST_CASE("Binary Serializer - Memory Mapped", "[serializer][binary]") {
+    std::filesystem::path test_file = std::filesystem::temp_directory_path() / "test_mapped.bin";
+    
+    if (std::filesystem::exists(test_file))
+        std::filesystem::remove(test_file);
+
+    u64 test_count = 12345;
+    std::vector<f32> test_vertices(10000);
+    for (size_t x = 0; x < test_vertices.size(); x++)
+        test_vertices[x] = static_cast<f32>(x) * 0.5f;
+    std::string test_name = "cache entry";
+    std::filesystem::path test_path = "/some/path";
+    u8 test_flag = 1;                                                               // puts the following data at an odd offset
+    std::vector<u64> test_ids = { 1, 2, 3, 4 };
+    u32 test_array[] = { 7, 8, 9 };
+    u32* test_array_pointer = test_array;
+
+    {
+        AT::serializer::binary(test_file, "mapped_data", AT::serializer::option::save_to_file)
+            .entry(test_count)
+            .entry(test_vertices)
+            .entry(test_name)
+            .entry(test_path)
+            .entry(test_flag)
+            .entry(test_ids)
+            .array(test_array_pointer, 3);
+    }
+
+    SECTION("entry() reads from the mapping") {
+        u64 loaded_count = 0;
+        std::vector<f32> loaded_vertices;
+        std::string loaded_name;
+        std::filesystem::path loaded_path;
+        u8 loaded_flag = 0;
+        std::vector<u64> loaded_ids;
+        u32* loaded_array = nullptr;
+        AT::serializer::binary(test_file, "mapped_data", AT::serializer::option::load_from_file, AT::serializer::binary::load_mode::mapped)
+            .entry(loaded_count)
+            .entry(loaded_vertices)
+            .entry(loaded_name)
+            .entry(loaded_path)
+            .entry(loaded_flag)
+            .entry(loaded_ids)
+            .array(loaded_array, 3);
+
+        REQUIRE(loaded_count == test_count);
+        REQUIRE(loaded_vertices == test_vertices);
+        REQUIRE(loaded_name == test_name);
+        REQUIRE(loaded_path == test_path);
+        REQUIRE(loaded_flag == test_flag);
+        REQUIRE(loaded_ids == test_ids);
+        REQUIRE(loaded_array != nullptr);
+        REQUIRE(std::equal(test_array, test_array + 3, loaded_array));
+        free(loaded_array);
+    }
+
+    SECTION("view() points into the mapping") {
+        for (const auto mode : { AT::serializer::binary::load_mode::mapped, AT::serializer::binary::load_mode::stream }) {
+
+            u64 loaded_count = 0;
+            std::span<const f32> vertices;
+            std::string_view name, path;
+            u8 loaded_flag = 0;
+            std::span<const u64> ids;
+            const u32* array = nullptr;
+            std::shared_ptr<const AT::serializer::binary::view_storage> storage;
+            {
+                AT::serializer::binary serializer(test_file, "mapped_data", AT::serializer::option::load_from_file, mode);
+                serializer.entry(loaded_count).view(vertices).view(name).view(path).entry(loaded_flag).view(ids).array_view(array, 3);
+                storage = serializer.get_view_storage();
+            }                                                                       // the views outlive the serializer
+
+            REQUIRE(loaded_count == test_count);
+            REQUIRE(std::equal(vertices.begin(), vertices.end(), test_vertices.begin(), test_vertices.end()));
+            REQUIRE(name == test_name);
+            REQUIRE(path == test_path.generic_string());
+            REQUIRE(loaded_flag == test_flag);
+            REQUIRE(std::equal(ids.begin(), ids.end(), test_ids.begin(), test_ids.end()));
+            REQUIRE(array != nullptr);
+            REQUIRE(std::equal(test_array, test_array + 3, array));
+
+            const AT::io::mapped_file& mapping = storage->mapping;
+            const auto in_mapping = [&mapping](const void* pointer) { return pointer >= mapping.data() && pointer < mapping.data() + mapping.size(); };
+            if (mode == AT::serializer::binary::load_mode::mapped) {
+                CHECK(in_mapping(vertices.data()));
+                CHECK(in_mapping(name.data()));
+                CHECK_FALSE(in_mapping(ids.data()));                               // unaligned after the flag, copied
+                CHECK(storage->copies.size() == 2);
+            } else {
+                CHECK_FALSE(mapping.is_open());
+                CHECK(storage->copies.size() == 3);                                 // the section, ids and array are unaligned in it
+            }
+        }
+    }
+
+    SECTION("Truncated file") {
+        std::filesystem::resize_file(test_file, std::filesystem::file_size(test_file) - 20);
+        u64 loaded_count = 0;
+        std::vector<f32> loaded_vertices;
+        std::span<const u64> ids;
+        u8 loaded_flag = 0;
+        std::string loaded_name, loaded_path;
+        AT::serializer::binary serializer(test_file, "mapped_data", AT::serializer::option::load_from_file, AT::serializer::binary::load_mode::mapped);
+        serializer
+            .entry(loaded_count)
+            .entry(loaded_vertices)
+            .entry(loaded_name)
+            .entry(loaded_path)
+            .entry(loaded_flag)
+            .view(ids);
+        REQUIRE_FALSE(serializer.is_valid());                                       // the section is rejected as a whole
+        REQUIRE(loaded_count == 0);
+        REQUIRE(loaded_vertices.empty());
+        REQUIRE(ids.empty());
+    }
+
+    SECTION("Saving while the file is mapped") {
+        std::span<const f32> vertices;
+        u64 loaded_count = 0;
+        std::shared_ptr<const AT::serializer::binary::view_storage> storage;
+        {
+            AT::serializer::binary serializer(test_file, "mapped_data", AT::serializer::option::load_from_file, AT::serializer::binary::load_mode::mapped);
+            serializer.entry(loaded_count).view(vertices);
+            storage = serializer.get_view_storage();
+        }
+
+        u64 new_count = 99;
+        AT::serializer::binary saver(test_file, "mapped_data", AT::serializer::option::save_to_file);
+        saver.entry(new_count);
+#if defined(PLATFORM_WINDOWS)
+        REQUIRE_FALSE(saver.flush());                                               // a file with a live view can not be replaced
+        storage.reset();
+        REQUIRE(saver.flush());
+#else
+        REQUIRE(saver.flush());
+        REQUIRE(std::equal(vertices.begin(), vertices.end(), test_vertices.begin(), test_vertices.end()));     // the mapping keeps the old content
+#endif
+
+        u64 reloaded_count = 0;
+        AT::serializer::binary(test_file, "mapped_data", AT::serializer::option::load_from_file).entry(reloaded_count);
+        REQUIRE(reloaded_count == new_count);
+    }
+
+    SECTION("Missing file") {
+        u64 loaded_count = 7;
+        std::span<const f32> vertices;
+        AT::serializer::binary(std::filesystem::temp_directory_path() / "test_mapped_missing.bin", "mapped_data", AT::serializer::option::load_from_file, AT::serializer::binary::load_mode::mapped)
+            .entry(loaded_count)
+            .view(vertices);
+        REQUIRE(loaded_count == 7);
+        REQUIRE(vertices.empty());
+    }
+}
+
+TEST_CASE("Binary Serializer - Container", "[serializer][binary]") {
+    std::filesystem::path test_file = std::filesystem::temp_directory_path() / "test_container.bin";
+
+    if (std::filesystem::exists(test_file))
+        std::filesystem::remove(test_file);
+
+    std::vector<u32> test_mesh = { 1, 2, 3, 4, 5 };
+    std::string test_settings = "vsync=1";
+    f64 test_time = 12.5;
+
+    const auto save_section = [&test_file](const std::string& name, const u32 version, auto& value) {
+        AT::serializer::binary serializer(test_file, name, AT::serializer::option::save_to_file);
+        serializer.set_encoding(AT::serializer::binary::encoding::raw).set_section_version(version).entry(value);
+        return serializer.flush();
+    };
+
+    REQUIRE(save_section("mesh", 3, test_mesh));
+    REQUIRE(save_section("settings", 1, test_settings));
+    REQUIRE(save_section("time", 7, test_time));
+
+    SECTION("CRC-32C") {
+        const char check[] = "123456789";
+        REQUIRE(AT::io::crc32c(0, check, 9) == 0xE3069283u);
+        REQUIRE(AT::io::crc32c(AT::io::crc32c(0, check, 4), check + 4, 5) == 0xE3069283u);
+        REQUIRE(AT::io::crc32c(0, nullptr, 0) == 0u);
+    }
+
+    SECTION("Every section is read on its own") {
+        for (const auto mode : { AT::serializer::binary::load_mode::stream, AT::serializer::binary::load_mode::mapped }) {
+            std::vector<u32> loaded_mesh;
+            std::string loaded_settings;
+            f64 loaded_time = 0.0;
+
+            AT::serializer::binary time(test_file, "time", AT::serializer::option::load_from_file, mode);
+            time.entry(loaded_time);
+            AT::serializer::binary mesh(test_file, "mesh", AT::serializer::option::load_from_file, mode);
+            mesh.entry(loaded_mesh);
+            AT::serializer::binary settings(test_file, "settings", AT::serializer::option::load_from_file, mode);
+            settings.entry(loaded_settings);
+
+            REQUIRE(loaded_time == test_time);
+            REQUIRE(loaded_mesh == test_mesh);
+            REQUIRE(loaded_settings == test_settings);
+            REQUIRE(time.get_section_version() == 7);
+            REQUIRE(mesh.get_section_version() == 3);
+            REQUIRE(settings.get_section_version() == 1);
+            REQUIRE((time.is_valid() && mesh.is_valid() && settings.is_valid()));
+        }
+    }
+
+    SECTION("Replacing a section keeps the others") {
+        std::vector<u32> new_mesh(1000, 42);
+        REQUIRE(save_section("mesh", 4, new_mesh));
+
+        std::vector<u32> loaded_mesh;
+        std::string loaded_settings;
+        AT::serializer::binary mesh(test_file, "mesh", AT::serializer::option::load_from_file);
+        mesh.entry(loaded_mesh);
+        AT::serializer::binary(test_file, "settings", AT::serializer::option::load_from_file).entry(loaded_settings);
+        REQUIRE(loaded_mesh == new_mesh);
+        REQUIRE(mesh.get_section_version() == 4);
+        REQUIRE(loaded_settings == test_settings);
+    }
+
+    SECTION("A missing section is not valid") {
+        u32 value = 5;
+        AT::serializer::binary serializer(test_file, "missing", AT::serializer::option::load_from_file);
+        serializer.entry(value);
+        REQUIRE_FALSE(serializer.is_valid());
+        REQUIRE(value == 5);
+    }
+
+    SECTION("A corrupted byte is detected") {
+        std::string content;
+        {
+            std::ifstream file(test_file, std::ios::binary);
+            content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        const size_t mesh_offset = content.find(std::string(reinterpret_cast<const char*>(test_mesh.data()), test_mesh.size() * sizeof(u32)));
+        REQUIRE(mesh_offset != std::string::npos);
+        content[mesh_offset + 2] ^= 0x10;
+        {
+            std::ofstream file(test_file, std::ios::binary | std::ios::trunc);
+            file.write(content.data(), static_cast<std::streamsize>(content.size()));
+        }
+
+        std::vector<u32> loaded_mesh;
+        std::string loaded_settings;
+        AT::serializer::binary mesh(test_file, "mesh", AT::serializer::option::load_from_file);
+        mesh.entry(loaded_mesh);
+        AT::serializer::binary(test_file, "settings", AT::serializer::option::load_from_file).entry(loaded_settings);
+        REQUIRE_FALSE(mesh.is_valid());
+        REQUIRE(loaded_mesh.empty());
+        REQUIRE(loaded_settings == test_settings);                                  // only the damaged section is rejected
+
+
+        content[AT::serializer::binary_container_header_size + sizeof(u32)] ^= 0x01;  // the name of the first section in the table
+        {
+            std::ofstream file(test_file, std::ios::binary | std::ios::trunc);
+            file.write(content.data(), static_cast<std::streamsize>(content.size()));
+        }
+        loaded_settings.clear();
+        AT::serializer::binary settings(test_file, "settings", AT::serializer::option::load_from_file, AT::serializer::binary::load_mode::mapped);
+        settings.entry(loaded_settings);
+        REQUIRE_FALSE(settings.is_valid());
+        REQUIRE(loaded_settings.empty());
+    }
+
+    SECTION("Files without a section table") {
+        {
+            std::ofstream file(test_file, std::ios::binary | std::ios::trunc);
+            const size_t size = test_mesh.size();
+            file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+            file.write(reinterpret_cast<const char*>(test_mesh.data()), static_cast<std::streamsize>(test_mesh.size() * sizeof(u32)));
+        }
+
+        std::vector<u32> loaded_mesh;
+        AT::serializer::binary serializer(test_file, "any name", AT::serializer::option::load_from_file);
+        serializer.entry(loaded_mesh);
+        REQUIRE(serializer.is_valid());
+        REQUIRE(serializer.get_section_version() == 0);
+        REQUIRE(loaded_mesh == test_mesh);
+    }
+
+    std::filesystem::remove(test_file);
+}
+
+TEST_CASE("Binary Serializer - Compact Encoding", "[serializer][binary]") {
+    std::filesystem::path test_file = std::filesystem::temp_directory_path() / "test_compact.bin";
+
+    if (std::filesystem::exists(test_file))
+        std::filesystem::remove(test_file);
+
+    enum class test_state : u16 { idle = 3, running = 300 };
+
+    u64 test_count = 42;
+    int32 test_offset = -5;
+    int64 test_min = std::numeric_limits<int64>::min();
+    u64 test_max = std::numeric_limits<u64>::max();
+    test_state test_enum = test_state::running;
+    std::string test_name = "compact";
+    f32 test_float = 1.5f;
+    std::vector<u64> test_timestamps(2000);                                         // sorted, stored as deltas
+    for (size_t x = 0; x < test_timestamps.size(); x++)
+        test_timestamps[x] = 1'700'000'000'000ull + x * 16;
+    std::vector<int64> test_signed = { 5, -3, 1000, -70000, 0 };                    // unsorted, zig-zag varints
+    std::vector<int32> test_sorted_signed = { std::numeric_limits<int32>::min(), -1, 0, std::numeric_limits<int32>::max() };
+    std::vector<std::string> test_strings = { "a", "bc", "" };
+
+    const auto save = [&](const AT::serializer::binary::encoding encoding) {
+        AT::serializer::binary serializer(test_file, "state", AT::serializer::option::save_to_file);
+        serializer.set_encoding(encoding)
+            .entry(test_count)
+            .entry(test_offset)
+            .entry(test_min)
+            .entry(test_max)
+            .entry(test_enum)
+            .entry(test_name)
+            .entry(test_float)
+            .entry(test_timestamps)
+            .entry(test_signed)
+            .entry(test_sorted_signed)
+            .entry(test_strings);
+        REQUIRE(serializer.flush());
+        return std::filesystem::file_size(test_file);
+    };
+
+    SECTION("Round trip and size") {
+        const auto raw_size = save(AT::serializer::binary::encoding::raw);
+        const auto compact_size = save(AT::serializer::binary::encoding::compact);
+        REQUIRE(compact_size * 4 < raw_size);
+
+        for (const auto mode : { AT::serializer::binary::load_mode::stream, AT::serializer::binary::load_mode::mapped }) {
+            u64 loaded_count = 0;
+            int32 loaded_offset = 0;
+            int64 loaded_min = 0;
+            u64 loaded_max = 0;
+            test_state loaded_enum = test_state::idle;
+            std::string loaded_name;
+            f32 loaded_float = 0.f;
+            std::vector<u64> loaded_timestamps;
+            std::vector<int64> loaded_signed;
+            std::vector<int32> loaded_sorted_signed;
+            std::vector<std::string> loaded_strings;
+
+            AT::serializer::binary serializer(test_file, "state", AT::serializer::option::load_from_file, mode);
+            serializer
+                .entry(loaded_count)
+                .entry(loaded_offset)
+                .entry(loaded_min)
+                .entry(loaded_max)
+                .entry(loaded_enum)
+                .entry(loaded_name)
+                .entry(loaded_float)
+                .entry(loaded_timestamps)
+                .entry(loaded_signed)
+                .entry(loaded_sorted_signed)
+                .entry(loaded_strings);
+
+            REQUIRE(serializer.get_encoding() == AT::serializer::binary::encoding::compact);
+            REQUIRE(loaded_count == test_count);
+            REQUIRE(loaded_offset == test_offset);
+            REQUIRE(loaded_min == test_min);
+            REQUIRE(loaded_max == test_max);
+            REQUIRE(loaded_enum == test_enum);
+            REQUIRE(loaded_name == test_name);
+            REQUIRE(loaded_float == test_float);
+            REQUIRE(loaded_timestamps == test_timestamps);
+            REQUIRE(loaded_signed == test_signed);
+            REQUIRE(loaded_sorted_signed == test_sorted_signed);
+            REQUIRE(loaded_strings == test_strings);
+        }
+    }
+
+    SECTION("view() decodes compact integers") {
+        save(AT::serializer::binary::encoding::compact);
+        u64 loaded_count = 0;
+        int32 loaded_offset = 0;
+        int64 loaded_min = 0;
+        u64 loaded_max = 0;
+        test_state loaded_enum = test_state::idle;
+        std::string_view name;
+        f32 loaded_float = 0.f;
+        std::span<const u64> timestamps;
+        std::span<const int64> signed_values;
+
+        AT::serializer::binary serializer(test_file, "state", AT::serializer::option::load_from_file, AT::serializer::binary::load_mode::mapped);
+        serializer.entry(loaded_count).entry(loaded_offset).entry(loaded_min).entry(loaded_max).entry(loaded_enum)
+            .view(name).entry(loaded_float).view(timestamps).view(signed_values);
+
+        REQUIRE(name == test_name);
+        REQUIRE(std::equal(timestamps.begin(), timestamps.end(), test_timestamps.begin(), test_timestamps.end()));
+        REQUIRE(std::equal(signed_values.begin(), signed_values.end(), test_signed.begin(), test_signed.end()));
+    }
+
+    SECTION("A value too large for the type is rejected") {
+        {
+            u32 value = 70000;
+            AT::serializer::binary serializer(test_file, "state", AT::serializer::option::save_to_file);
+            serializer.set_encoding(AT::serializer::binary::encoding::compact).entry(value);
+        }
+        u16 loaded = 7;
+        AT::serializer::binary(test_file, "state", AT::serializer::option::load_from_file).entry(loaded);
+        REQUIRE(loaded == 7);
+    }
+
+    std::filesystem::remove(test_file);
+}
+
+TEST_CASE("Binary Serializer - Vector Callback", "[serializer][binary]") {
+    std::filesystem::path test_file = std::filesystem::temp_directory_path() / "test_vector_callback.bin";
+
+    if (std::filesystem::exists(test_file))
+        std::filesystem::remove(test_file);
+
+    struct test_element {
+        std::string name;
+        std::vector<u32> values;
+        f64 weight = 0.0;
+        bool operator==(const test_element&) const = default;
+    };
+
+    std::vector<test_element> test_elements(1000);
+    for (size_t x = 0; x < test_elements.size(); x++) {
+        test_elements[x].name = "element_" + std::to_string(x);
+        test_elements[x].values.assign(x % 7, static_cast<u32>(x));
+        test_elements[x].weight = static_cast<f64>(x) * 0.25;
+    }
+
+    const auto save = [&](const size_t chunk_size, const AT::serializer::binary::encoding encoding) {
+        u32 marker = 0xABCD;
+        AT::serializer::binary serializer(test_file, "elements", AT::serializer::option::save_to_file);
+        serializer.set_encoding(encoding)
+            .vector(test_elements, [&](AT::serializer::binary& element_serializer, const u64 x) {
+                element_serializer.entry(test_elements[x].name).entry(test_elements[x].values).entry(test_elements[x].weight);
+            }, chunk_size)
+            .entry(marker);                                                         // entries after the vector are not shifted by the chunks
+        REQUIRE(serializer.flush());
+    };
+
+    const auto load = [&test_file](const AT::serializer::binary::load_mode mode) {
+        std::vector<test_element> loaded;
+        u32 marker = 0;
+        AT::serializer::binary(test_file, "elements", AT::serializer::option::load_from_file, mode)
+            .vector(loaded, [&loaded](AT::serializer::binary& element_serializer, const u64 x) {
+                element_serializer.entry(loaded[x].name).entry(loaded[x].values).entry(loaded[x].weight);
+            })
+            .entry(marker);
+        CHECK(marker == 0xABCD);
+        return loaded;
+    };
+
+    SECTION("Sequential") {
+        save(0, AT::serializer::binary::encoding::raw);
+        REQUIRE(load(AT::serializer::binary::load_mode::stream) == test_elements);
+    }
+
+    SECTION("Chunked") {
+        for (const auto encoding : { AT::serializer::binary::encoding::raw, AT::serializer::binary::encoding::compact }) {
+            save(64, encoding);
+            REQUIRE(load(AT::serializer::binary::load_mode::stream) == test_elements);
+            REQUIRE(load(AT::serializer::binary::load_mode::mapped) == test_elements);
+        }
+    }
+
+    SECTION("A vector smaller than one chunk is sequential") {
+        test_elements.resize(10);
+        save(64, AT::serializer::binary::encoding::raw);
+        REQUIRE(load(AT::serializer::binary::load_mode::mapped) == test_elements);
+    }
+
+    SECTION("Empty vector") {
+        test_elements.clear();
+        save(64, AT::serializer::binary::encoding::raw);
+        REQUIRE(load(AT::serializer::binary::load_mode::stream).empty());
+    }
+
+    SECTION("A corrupted size is rejected before the vector is resized") {
+        for (const size_t chunk_size : { size_t(0), size_t(64) }) {
+            save(chunk_size, AT::serializer::binary::encoding::raw);
+
+            // the element count is the first size_t of the only section, which ends the file
+            std::fstream file(test_file, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekg(0, std::ios::end);
+            const auto file_size = static_cast<size_t>(file.tellg());
+            std::string content(file_size, '\0');
+            file.seekg(0);
+            file.read(content.data(), static_cast<std::streamsize>(file_size));
+            const size_t crc_offset = content.find("elements") + std::string("elements").size() + sizeof(u32) + 1 + sizeof(u64) * 2;
+            u64 count_offset = 0;
+            std::memcpy(&count_offset, content.data() + crc_offset - sizeof(u64) * 2, sizeof(count_offset));
+            size_t real_count = 0;
+            std::memcpy(&real_count, content.data() + count_offset, sizeof(real_count));
+            REQUIRE(real_count == test_elements.size());
+
+            // a valid checksum over the corrupted data, so only vector() can notice
+            const size_t huge_count = size_t(1) << 60;
+            std::memcpy(content.data() + count_offset, &huge_count, sizeof(huge_count));
+            const u32 crc = AT::io::crc32c(0, content.data() + count_offset, file_size - count_offset);
+            std::memcpy(content.data() + crc_offset, &crc, sizeof(crc));
+            const u32 table_crc = AT::io::crc32c(0, content.data() + AT::serializer::binary_container_header_size, crc_offset + sizeof(u32) - AT::serializer::binary_container_header_size);
+            std::memcpy(content.data() + AT::serializer::binary_container_header_size - sizeof(u32), &table_crc, sizeof(table_crc));
+            file.seekp(0);
+            file.write(content.data(), static_cast<std::streamsize>(file_size));
+            file.close();
+
+            std::vector<test_element> loaded;
+            u32 calls = 0;
+            AT::serializer::binary serializer(test_file, "elements", AT::serializer::option::load_from_file);
+            serializer.vector(loaded, [&calls](AT::serializer::binary&, const u64) { calls++; });
+            REQUIRE(serializer.is_valid());                                         // the checksums match, vector() rejected the size
+            REQUIRE(loaded.empty());
+            REQUIRE(calls == 0);
+        }
+    }
+
+    SECTION("An exception of a worker reaches the caller") {
+        AT::serializer::binary serializer(test_file, "elements", AT::serializer::option::save_to_file);
+        REQUIRE_THROWS_AS(serializer.vector(test_elements, [](AT::serializer::binary& element_serializer, const u64 x) {
+            if (x == 500)
+                throw std::runtime_error("element 500");
+            u64 value = x;
+            element_serializer.entry(value);
+        }, 64), std::runtime_error);
+    }
+
+    SECTION("Nested chunked vectors") {
+        std::vector<std::vector<u32>> nested(32);
+        for (size_t x = 0; x < nested.size(); x++)
+            for (u32 y = 0; y < 200; y++)
+                nested[x].push_back(static_cast<u32>(x * 1000 + y));
+
+        const auto serialize = [](AT::serializer::binary& serializer, std::vector<std::vector<u32>>& outer) {
+            serializer.vector(outer, [&outer](AT::serializer::binary& outer_serializer, const u64 x) {
+                outer_serializer.vector(outer[x], [&inner = outer[x]](AT::serializer::binary& inner_serializer, const u64 y) {
+                    inner_serializer.entry(inner[y]);
+                }, 16);                                                             // runs on the thread of the outer chunk
+            }, 4);
+        };
+        {
+            AT::serializer::binary serializer(test_file, "nested", AT::serializer::option::save_to_file);
+            serialize(serializer, nested);
+        }
+        std::vector<std::vector<u32>> loaded;
+        AT::serializer::binary serializer(test_file, "nested", AT::serializer::option::load_from_file);
+        serialize(serializer, loaded);
+        REQUIRE(loaded == nested);
+    }
+
+    SECTION("Views of the chunks outlive the serializer") {
+        save(64, AT::serializer::binary::encoding::raw);
+        std::vector<std::pair<std::string_view, std::span<const u32>>> views;
+        std::shared_ptr<const AT::serializer::binary::view_storage> storage;
+        {
+            AT::serializer::binary serializer(test_file, "elements", AT::serializer::option::load_from_file, AT::serializer::binary::load_mode::stream);
+            serializer.vector(views, [&views](AT::serializer::binary& element_serializer, const u64 x) {
+                f64 weight = 0.0;
+                element_serializer.view(views[x].first).view(views[x].second).entry(weight);
+            });
+            storage = serializer.get_view_storage();
+        }
+
+        REQUIRE(views.size() == test_elements.size());
+        for (size_t x = 0; x < views.size(); x++) {
+            REQUIRE(views[x].first == test_elements[x].name);
+            REQUIRE(std::equal(views[x].second.begin(), views[x].second.end(), test_elements[x].values.begin(), test_elements[x].values.end()));
+        }
+    }
+
+    std::filesystem::remove(test_file);
+}
+
 // ==============================================================================================================================
 // STOPWATCH
 // ==============================================================================================================================
@@ -1185,6 +2732,510 @@ TEST_CASE("Stopwatch functionality", "[stopwatch][timing]") {
     }
 }
 
+TEST_CASE("Instrumentor Thread Buffers", "[instrumentor][multithreading]") {
+
+    const std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "instrumentor_test";
+    std::filesystem::remove_all(test_dir);
+
+    const int num_threads = 4;
+    const int events_per_thread = 3000;                             // more than half a thread buffer, the writer is woken early
+    AT::instrumentor::get().begin_session("test", test_dir, "trace.json", std::chrono::seconds(0), AT::trace_format::json);
+    {
+        std::vector<std::thread> threads;
+        for (int x = 0; x < num_threads; x++) {
+            threads.emplace_back([]() {
+                for (int y = 0; y < events_per_thread; y++)
+                    AT::instrumentor_timer timer("scope \"quoted\"");
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+    }
+    AT::instrumentor_timer("after threads exited").stop();
+    AT::instrumentor::get().end_session();
+    AT::instrumentor_timer("outside of a session").stop();
+
+    std::ifstream file(test_dir / "trace.json");
+    REQUIRE(file.good());
+    const std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    auto count = [&content](const std::string& pattern) {
+        size_t result = 0;
+        for (size_t pos = content.find(pattern); pos != std::string::npos; pos = content.find(pattern, pos + pattern.size()))
+            result++;
+        return result;
+    };
+
+    CHECK(AT::instrumentor::get().get_dropped_events() == 0);
+    CHECK(content.rfind("{\"otherData\": {},\"traceEvents\":[{}", 0) == 0);
+    CHECK(content.substr(content.size() - 2) == "]}");
+    CHECK(count("\"ph\":\"X\"") == num_threads * events_per_thread + 1);
+    CHECK(count("\"name\":\"scope \\\"quoted\\\"\"") == num_threads * events_per_thread);
+    CHECK(count("after threads exited") == 1);
+    CHECK(count("outside of a session") == 0);
+
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST_CASE("Instrumentor Rolling Capture", "[instrumentor]") {
+
+    const std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "instrumentor_rolling_test";
+    std::filesystem::remove_all(test_dir);
+
+    auto read_file = [](const std::filesystem::path& path) {
+        std::ifstream file(path);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    };
+
+    auto list_dumps = [&test_dir]() {
+        std::vector<std::filesystem::path> dumps;
+        for (const auto& entry : std::filesystem::directory_iterator(test_dir))
+            dumps.push_back(entry.path());
+        return dumps;
+    };
+
+    CHECK(AT::instrumentor::get().dump_trace("no session").empty());
+
+    AT::instrumentor::get().begin_session("test", test_dir, "rolling.json", std::chrono::seconds(1), AT::trace_format::json);
+    const auto now = std::chrono::steady_clock::now();
+    AT::instrumentor::get().write_profile("outside of the window", now - std::chrono::seconds(5), now - std::chrono::seconds(4));
+    for (int x = 0; x < 100; x++)
+        AT::instrumentor_timer timer("inside of the window");
+
+    SECTION("Dump from the calling thread") {
+
+        const std::filesystem::path dump = AT::instrumentor::get().dump_trace("manual dump");
+        REQUIRE_FALSE(dump.empty());
+        CHECK(dump.filename().string().rfind("rolling_", 0) == 0);
+        CHECK(dump.filename().string().find("_manual_dump_") != std::string::npos);
+
+        const std::string content = read_file(dump);
+        CHECK(content.rfind("{\"otherData\": {},\"traceEvents\":[{}", 0) == 0);
+        CHECK(content.substr(content.size() - 2) == "]}");
+        CHECK(content.find("outside of the window") == std::string::npos);
+        size_t count = 0;
+        for (size_t pos = content.find("inside of the window"); pos != std::string::npos; pos = content.find("inside of the window", pos + 1))
+            count++;
+        CHECK(count == 100);
+    }
+
+    SECTION("Frame budget requests a dump from the writer thread") {
+
+        AT::instrumentor::get().set_frame_budget(std::chrono::milliseconds(10));
+        AT::instrumentor::get().end_frame(std::chrono::milliseconds(5));
+        AT::instrumentor::get().end_frame(std::chrono::milliseconds(20));
+        AT::instrumentor::get().end_frame(std::chrono::milliseconds(30));          // same window, no second dump
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (list_dumps().empty() && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(3 * PROFILE_WRITE_INTERVAL_MS));
+        const auto dumps = list_dumps();
+        REQUIRE(dumps.size() == 1);
+        CHECK(dumps.front().filename().string().find("_frame_budget_20ms_") != std::string::npos);
+        CHECK(read_file(dumps.front()).find("inside of the window") != std::string::npos);
+        AT::instrumentor::get().set_frame_budget(std::chrono::milliseconds(PROFILE_FRAME_BUDGET_MS));
+    }
+
+    AT::instrumentor::get().end_session();
+    CHECK_FALSE(std::filesystem::exists(test_dir / "rolling.json"));               // a rolling session only writes dumps
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST_CASE("Instrumentor Binary Trace", "[instrumentor]") {
+
+    const std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "instrumentor_binary_test";
+    std::filesystem::remove_all(test_dir);
+
+    const int num_threads = 3;
+    const int events_per_thread = 2001;
+    static const char* names[] = { "void renderer::draw_frame(f32)", "void application::limit_fps()", "name \"with\" quotes" };
+    AT::instrumentor::get().begin_session("test", test_dir, "trace.json", std::chrono::seconds(0), AT::trace_format::binary);
+    {
+        std::vector<std::thread> threads;
+        for (int x = 0; x < num_threads; x++) {
+            threads.emplace_back([]() {
+                for (int y = 0; y < events_per_thread; y++)
+                    AT::instrumentor_timer timer(names[y % 3]);
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+    }
+    AT::instrumentor::get().end_session();
+
+    const std::filesystem::path trace = test_dir / "trace.attrace";
+    REQUIRE(std::filesystem::exists(trace));
+    CHECK_FALSE(std::filesystem::exists(test_dir / "trace.json"));
+
+    std::map<std::string, int> events_per_name;
+    std::map<std::string, u64> previous_start_per_thread;
+    bool ordered = true;
+    REQUIRE(AT::read_binary_trace(trace, [&](const AT::trace_event& event) {
+        events_per_name[std::string(event.name)]++;
+        u64& previous_start = previous_start_per_thread[std::string(event.thread)];
+        ordered &= event.start_ns >= previous_start;                                // sequential scopes of one thread
+        previous_start = event.start_ns;
+        return true;
+    }));
+    CHECK(ordered);
+    CHECK(previous_start_per_thread.size() == num_threads);
+    REQUIRE(events_per_name.size() == 3);
+    for (const auto* name : names)
+        CHECK(events_per_name[name] == num_threads * events_per_thread / 3);
+
+    // the converter produces the same JSON as a json session
+    const std::filesystem::path converted = test_dir / "converted.json";
+    REQUIRE(AT::convert_binary_trace(trace, converted));
+    std::ifstream file(converted);
+    const std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    CHECK(json.rfind("{\"otherData\": {},\"traceEvents\":[{}", 0) == 0);
+    CHECK(json.substr(json.size() - 2) == "]}");
+    size_t count = 0;
+    for (size_t pos = json.find("\"ph\":\"X\""); pos != std::string::npos; pos = json.find("\"ph\":\"X\"", pos + 1))
+        count++;
+    CHECK(count == num_threads * events_per_thread);
+    CHECK(json.find("\"name\":\"name \\\"with\\\" quotes\"") != std::string::npos);
+    CHECK(std::filesystem::file_size(trace) * 10 < std::filesystem::file_size(converted));
+
+    // a trace that was cut off is read up to the last complete record
+    std::filesystem::resize_file(trace, std::filesystem::file_size(trace) - 3);
+    int events_after_cut = 0;
+    CHECK(AT::read_binary_trace(trace, [&](const AT::trace_event&) { events_after_cut++; return true; }));
+    CHECK(events_after_cut == num_threads * events_per_thread - 1);
+
+    CHECK_FALSE(AT::read_binary_trace(converted, [](const AT::trace_event&) { return true; }));
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST_CASE("Instrumentor Frame Statistics", "[instrumentor]") {
+
+    const std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "instrumentor_frame_test";
+    std::filesystem::remove_all(test_dir);
+
+    // frames are evaluated by the writer thread once the following frame ended
+    const auto wait_for_frames = [](const size_t count) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (AT::instrumentor::get().get_frames().size() < count && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return AT::instrumentor::get().get_frames();
+    };
+
+    AT::instrumentor::get().begin_session("test", test_dir, "frames.json", std::chrono::seconds(0), AT::trace_format::json);
+    AT::instrumentor::get().set_frame_budget(std::chrono::milliseconds(20));
+    AT::instrumentor_timer("before the first frame").stop();
+    AT::instrumentor::get().end_frame(std::chrono::milliseconds(0));
+
+    SECTION("Per-scope statistics and budget") {
+
+        const int num_frames = 21;
+        for (int x = 0; x < num_frames; x++) {
+            {
+                AT::instrumentor_timer frame_timer("frame");
+                for (int y = 0; y < 2; y++) {
+                    AT::instrumentor_timer timer("inner");
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+            AT::instrumentor::get().end_frame(std::chrono::milliseconds(x == 10 ? 50 : 5));
+        }
+
+        const auto frames = wait_for_frames(num_frames - 1);
+        REQUIRE(frames.size() == num_frames - 1);                                  // the last frame waits for the next boundary
+        for (size_t x = 0; x < frames.size(); x++) {
+            CHECK(frames[x].index == x);
+            CHECK(frames[x].over_budget == (x == 10));
+            CHECK(frames[x].duration_ns >= 2000000);
+            if (x > 0)
+                CHECK(frames[x].start_ns == frames[x - 1].start_ns + frames[x - 1].duration_ns);
+        }
+        CHECK(AT::instrumentor::get().get_frames_over_budget() == 1);
+
+        const auto stats = AT::instrumentor::get().get_scope_stats();
+        REQUIRE(stats.size() == 2);                                                 // the scope before the first frame belongs to no frame
+        CHECK(stats[0].name == "frame");
+        CHECK(stats[1].name == "inner");
+        for (const auto& scope : stats) {
+            CHECK(scope.frames == num_frames - 1);
+            CHECK(scope.min_ns >= 2000000);
+            CHECK(scope.min_ns <= scope.avg_ns);
+            CHECK(scope.avg_ns <= scope.p99_ns);
+            CHECK(scope.p99_ns <= scope.max_ns);
+        }
+        CHECK(stats[0].calls_per_frame == 1.);
+        CHECK(stats[1].calls_per_frame == 2.);
+        CHECK(stats[0].avg_ns >= stats[1].avg_ns);
+
+        std::vector<AT::instrumentor::captured_event> latest_events;
+        const auto latest = AT::instrumentor::get().get_latest_frame(latest_events);
+        CHECK(latest.index == frames.back().index);
+        REQUIRE(latest_events.size() == 3);
+        CHECK(std::string(latest_events[0].event.name) == "frame");                   // parent first
+        CHECK(std::string(latest_events[1].event.name) == "inner");
+        CHECK(std::string(latest_events[2].event.name) == "inner");
+        CHECK(latest_events[1].event.start_ns < latest_events[2].event.start_ns);
+        for (const auto& captured : latest_events) {
+            CHECK(captured.thread_id == latest_events[0].thread_id);
+            CHECK(captured.event.start_ns >= latest.start_ns);
+            CHECK(captured.event.start_ns < latest.start_ns + latest.duration_ns);
+        }
+    }
+
+    SECTION("Sliding window") {
+
+        const int num_frames = PROFILE_FRAME_STATS_WINDOW + 50;
+        for (int x = 0; x < num_frames; x++) {
+            if (x % 2 == 0)
+                AT::instrumentor_timer("every second frame").stop();
+            if (x < 10)
+                AT::instrumentor_timer("only at the beginning").stop();
+            AT::instrumentor::get().end_frame(std::chrono::microseconds(100));
+        }
+
+        std::vector<AT::profile_frame> frames;
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        do {
+            frames = wait_for_frames(PROFILE_FRAME_STATS_WINDOW);
+        } while ((frames.empty() || frames.back().index < num_frames - 2) && std::chrono::steady_clock::now() < deadline);
+
+        REQUIRE(frames.size() == PROFILE_FRAME_STATS_WINDOW);
+        CHECK(frames.back().index == num_frames - 2);
+        CHECK(frames.front().index == num_frames - 1 - PROFILE_FRAME_STATS_WINDOW);
+
+        const auto stats = AT::instrumentor::get().get_scope_stats();
+        REQUIRE(stats.size() == 1);
+        CHECK(stats[0].name == "every second frame");
+        CHECK(stats[0].frames == PROFILE_FRAME_STATS_WINDOW / 2);
+        CHECK(stats[0].calls_per_frame == 1.);
+    }
+
+    AT::instrumentor::get().set_frame_budget(std::chrono::milliseconds(PROFILE_FRAME_BUDGET_MS));
+    AT::instrumentor::get().end_session();
+    CHECK(AT::instrumentor::get().get_frames().size() > 0);                          // still queryable after the session ended
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST_CASE("Instrumentor Perf Counters", "[instrumentor]") {
+
+    const std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "instrumentor_counters_test";
+    std::filesystem::remove_all(test_dir);
+
+    // machines without a PMU (e.g. most virtual machines) or with a strict perf_event_paranoid only provide some or none of the counters
+    AT::perf_counter_values probe{};
+    const bool has_counters = AT::read_perf_counters(probe);
+    const auto record_scopes = []() {
+        for (int x = 0; x < 4; x++) {
+            PROFILE_SCOPE_COUNTERS("counter scope");
+            AT::instrumentor_timer timer("plain scope");
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));                 // at least one context switch
+        }
+    };
+    const auto read_file = [](const std::filesystem::path& path) {
+        std::ifstream file(path);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    };
+    const auto count_of = [](const std::string& text, const std::string& pattern) {
+        size_t count = 0;
+        for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1))
+            count++;
+        return count;
+    };
+
+    SECTION("Delta") {
+        AT::perf_counter_values begin{}, end{};
+        begin.values = { 10, 20, 0, 0, 1 };
+        begin.valid_mask = 0b10011;
+        end.values = { 15, 50, 0, 0, 3 };
+        end.valid_mask = 0b10001;
+        const AT::perf_counter_values delta = AT::perf_counter_delta(begin, end);
+        CHECK(delta.valid_mask == 0b10001);
+        CHECK(delta.get(AT::perf_counter::cycles) == 5);
+        CHECK(delta.get(AT::perf_counter::instructions) == 0);
+        CHECK(delta.is_valid(AT::perf_counter::context_switches));
+        CHECK(delta.get(AT::perf_counter::context_switches) == 2);
+        CHECK_FALSE(delta.is_valid(AT::perf_counter::instructions));
+        CHECK_FALSE(delta.is_scaled());
+    }
+
+    SECTION("Multiplexed delta") {
+        AT::perf_counter_values begin{}, end{};
+        begin.values = { 100, 200, 0, 0, 0 };
+        begin.valid_mask = end.valid_mask = 0b00011;
+        begin.time_enabled_ns = 1000;
+        begin.time_running_ns = 1000;
+        end.values = { 150, 300, 0, 0, 0 };
+        end.time_enabled_ns = 2000;
+        end.time_running_ns = 1250;                                                 // counted a quarter of the interval
+        const AT::perf_counter_values delta = AT::perf_counter_delta(begin, end);
+        CHECK(delta.is_scaled());
+        CHECK(delta.get(AT::perf_counter::cycles) == 200);
+        CHECK(delta.get(AT::perf_counter::instructions) == 400);
+
+        end.time_running_ns = 1000;                                                 // never scheduled, nothing to scale
+        const AT::perf_counter_values not_counted = AT::perf_counter_delta(begin, end);
+        CHECK(not_counted.valid_mask == 0);
+        CHECK(not_counted.get(AT::perf_counter::cycles) == 0);
+    }
+
+    SECTION("JSON session") {
+        AT::instrumentor::get().begin_session("test", test_dir, "trace.json", std::chrono::seconds(0), AT::trace_format::json);
+        record_scopes();
+        AT::instrumentor::get().end_session();
+
+        const std::string json = read_file(test_dir / "trace.json");
+        CHECK(count_of(json, "\"name\":\"counter scope\"") == 4);
+        CHECK(count_of(json, "\"name\":\"plain scope\"") == 4);
+        CHECK(count_of(json, "\"args\":{") == (has_counters ? 4 : 0));
+        if (has_counters && probe.is_valid(AT::perf_counter::context_switches))
+            CHECK(count_of(json, "\"context_switches\":") == 4);
+    }
+
+    SECTION("Binary session and converter") {
+        AT::instrumentor::get().begin_session("test", test_dir, "trace.json", std::chrono::seconds(0), AT::trace_format::binary);
+        record_scopes();
+        AT::instrumentor::get().end_session();
+
+        int counter_events = 0, plain_events = 0, events_with_counters = 0;
+        REQUIRE(AT::read_binary_trace(test_dir / "trace.attrace", [&](const AT::trace_event& event) {
+            (event.name == "counter scope" ? counter_events : plain_events)++;
+            if (event.counters.valid_mask != 0) {
+                events_with_counters++;
+                CHECK(event.name == "counter scope");
+                CHECK(event.counters.valid_mask == probe.valid_mask);
+            }
+            return true;
+        }));
+        CHECK(counter_events == 4);
+        CHECK(plain_events == 4);
+        CHECK(events_with_counters == (has_counters ? 4 : 0));
+
+        REQUIRE(AT::convert_binary_trace(test_dir / "trace.attrace", test_dir / "converted.json"));
+        CHECK(count_of(read_file(test_dir / "converted.json"), "\"args\":{") == (has_counters ? 4 : 0));
+    }
+
+    SECTION("Rolling dump") {
+        AT::instrumentor::get().begin_session("test", test_dir, "trace.json", std::chrono::seconds(10), AT::trace_format::json);
+        record_scopes();
+        const std::filesystem::path dump = AT::instrumentor::get().dump_trace("counters");
+        AT::instrumentor::get().end_session();
+
+        REQUIRE_FALSE(dump.empty());
+        const std::string json = read_file(dump);
+        CHECK(count_of(json, "\"name\":\"counter scope\"") == 4);
+        CHECK(count_of(json, "\"args\":{") == (has_counters ? 4 : 0));
+    }
+
+    SECTION("Several scopes in one block") {
+        AT::instrumentor::get().begin_session("test", test_dir, "trace.json", std::chrono::seconds(0), AT::trace_format::json);
+        {
+            PROFILE_SCOPE_COUNTERS("first counter scope");
+            PROFILE_SCOPE_COUNTERS("second counter scope");
+            PROFILE_SCOPE("first plain scope");
+            PROFILE_SCOPE("second plain scope");
+        }
+        AT::instrumentor::get().end_session();
+
+        const std::string json = read_file(test_dir / "trace.json");
+        CHECK(count_of(json, "\"name\":\"first counter scope\"") == 1);
+        CHECK(count_of(json, "\"name\":\"second counter scope\"") == 1);
+        CHECK(count_of(json, "\"name\":\"first plain scope\"") == 1);
+        CHECK(count_of(json, "\"name\":\"second plain scope\"") == 1);
+    }
+
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST_CASE("Instrumentor Allocation Tracking", "[instrumentor]") {
+
+    const std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "instrumentor_allocation_test";
+    std::filesystem::remove_all(test_dir);
+
+    constexpr u32 expected_allocations = PROFILE_ALLOCATIONS ? 1 : 0;
+    constexpr u64 expected_bytes = PROFILE_ALLOCATIONS ? 1000 * sizeof(u64) : 0;
+    std::vector<std::vector<u64>> kept;                                             // keeps the allocations observable
+    kept.reserve(64);
+    const auto allocating_scope = [&kept]() {
+        AT::instrumentor_timer timer("allocating scope");
+        kept.emplace_back(1000);
+        AT::instrumentor_timer("nested").stop();                                    // attributed to the scope and every parent
+    };
+    const auto read_file = [](const std::filesystem::path& path) {
+        std::ifstream file(path);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    };
+
+    SECTION("Thread totals") {
+        const AT::allocation_totals before = AT::get_thread_allocations();
+        kept.emplace_back(10);
+        const AT::allocation_totals after = AT::get_thread_allocations();
+        CHECK(after.count - before.count == expected_allocations);
+        CHECK(after.bytes - before.bytes == (PROFILE_ALLOCATIONS ? 10 * sizeof(u64) : 0));
+    }
+
+    SECTION("JSON and binary trace") {
+        for (const auto format : { AT::trace_format::json, AT::trace_format::binary }) {
+
+            AT::instrumentor::get().begin_session("test", test_dir, "trace.json", std::chrono::seconds(0), format);
+            AT::instrumentor_timer("warm up").stop();                               // the first event of a thread allocates its buffer
+            allocating_scope();
+            AT::instrumentor::get().end_session();
+
+            if (format == AT::trace_format::json) {
+                const std::string json = read_file(test_dir / "trace.json");
+                const std::string args = ",\"args\":{\"allocations\":" + std::to_string(expected_allocations) + ",\"allocated_bytes\":" + std::to_string(expected_bytes) + "}}";
+                const size_t scope = json.find("\"name\":\"allocating scope\"");
+                REQUIRE(scope != std::string::npos);
+                if (PROFILE_ALLOCATIONS)
+                    CHECK(json.find(args, scope) != std::string::npos);
+                CHECK(json.find("\"args\"") == json.rfind("\"args\""));              // only the allocating scope has args
+                continue;
+            }
+
+            std::map<std::string, std::pair<u32, u64>> allocations_per_name;
+            REQUIRE(AT::read_binary_trace(test_dir / "trace.attrace", [&](const AT::trace_event& event) {
+                allocations_per_name[std::string(event.name)] = { event.allocations, event.allocated_bytes };
+                return true;
+            }));
+            CHECK(allocations_per_name["allocating scope"] == std::pair<u32, u64>(expected_allocations, expected_bytes));
+            CHECK(allocations_per_name["nested"] == std::pair<u32, u64>(0, 0));
+            CHECK(allocations_per_name["warm up"] == std::pair<u32, u64>(0, 0));
+
+            REQUIRE(AT::convert_binary_trace(test_dir / "trace.attrace", test_dir / "converted.json"));
+            CHECK((read_file(test_dir / "converted.json").find("\"allocations\":1,") != std::string::npos) == (PROFILE_ALLOCATIONS != 0));
+        }
+    }
+
+    SECTION("Frame statistics") {
+        AT::instrumentor::get().begin_session("test", test_dir, "frames.json", std::chrono::seconds(0), AT::trace_format::json);
+        AT::instrumentor_timer("warm up").stop();
+        AT::instrumentor::get().end_frame(std::chrono::milliseconds(0));
+
+        const int num_frames = 11;
+        for (int x = 0; x < num_frames; x++) {
+            allocating_scope();
+            AT::instrumentor::get().end_frame(std::chrono::milliseconds(1));
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (AT::instrumentor::get().get_frames().size() < num_frames - 1 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        const auto stats = AT::instrumentor::get().get_scope_stats();
+        AT::instrumentor::get().end_session();
+
+        REQUIRE(stats.size() == 2);
+        for (const auto& scope : stats) {
+            const bool allocating = scope.name == "allocating scope";
+            CHECK(scope.allocations_per_frame == (allocating ? expected_allocations : 0.));
+            CHECK(scope.allocated_bytes_per_frame == (allocating ? static_cast<f64>(expected_bytes) : 0.));
+        }
+    }
+
+    std::filesystem::remove_all(test_dir);
+}
+
 // ==============================================================================================================================
 // DELETION QUEUE
 // ==============================================================================================================================
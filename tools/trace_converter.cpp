@@ -0,0 +1,25 @@
+#include "util/pch.h"
+#include "util/timing/trace_format.h"
+
+// Converts binary profiler traces (trace_format::binary) into Chrome trace JSON for chrome://tracing or ui.perfetto.dev
+//
+// usage: trace_converter <trace.attrace> [output.json]     (the output defaults to the input with the extension .json)
+
+int main(int argc, char* argv[]) {
+
+    if (argc < 2 || argc > 3) {
+        std::printf("usage: %s <trace%s> [output.json]\n", argv[0], AT::binary_trace_extension);
+        return 1;
+    }
+
+    const std::filesystem::path input = argv[1];
+    const std::filesystem::path output = (argc == 3) ? std::filesystem::path(argv[2]) : std::filesystem::path(input).replace_extension(".json");
+    if (!AT::convert_binary_trace(input, output)) {
+        std::fprintf(stderr, "could not convert [%s] to [%s]\n", input.string().c_str(), output.string().c_str());
+        return 1;
+    }
+
+    std::printf("converted [%s] (%llu bytes) to [%s] (%llu bytes)\n", input.string().c_str(), static_cast<unsigned long long>(std::filesystem::file_size(input)),
+        output.string().c_str(), static_cast<unsigned long long>(std::filesystem::file_size(output)));
+    return 0;
+}